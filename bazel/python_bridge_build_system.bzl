@@ -30,13 +30,16 @@ def python_bridge_include_copts():
     "3rd_party/base64/include", 
   ], is_system=True)
 
-def python_bridge_copts(is_3rd_party=False):
+# The free-threaded build (PEP 703) doesn't support the limited API.
+def python_bridge_copts(is_3rd_party=False, is_free_threaded=False):
   if is_3rd_party:
     return [
       "-std=c++11",
     ]
-  return [
-      "-DPy_LIMITED_API",
+  limited_api_copts = [] if is_free_threaded else [
+      "-DPy_LIMITED_API=0x03050000",
+  ]
+  return limited_api_copts + [
       "-Wall",
       "-Wextra",
       "-Werror",
@@ -48,7 +51,19 @@ def python_bridge_copts(is_3rd_party=False):
       "-Wno-noexcept-type",
       "-Wvla",
       "-std=c++11",
-  ]
+  ] + select({
+      "//bazel:usdt_enabled": ["-DPYTHON_BRIDGE_TRACER_USDT"],
+      "//conditions:default": [],
+  }) + select({
+      # Only the module's init function is exported; see
+      # PYTHON_BRIDGE_TRACER_DEFINE_MODULE.
+      "//bazel:release_enabled": [
+          "-fvisibility=hidden",
+          "-fvisibility-inlines-hidden",
+          "-flto=thin",
+      ],
+      "//conditions:default": [],
+  })
 
 
 def python_bridge_include_prefix(path):
@@ -69,19 +84,22 @@ def python_bridge_cc_library(name,
                      data = [],
                      is_3rd_party = False,
                      strip_include_prefix = None):
-  for version, tag in [("3", ""), ("27", "m"), ("27", "mu")]:
-    suffix = version + tag
+  # (suffix, cpython headers) of each python the library is built for; the
+  # "t" suffix is the free-threaded build.
+  for suffix, cpython in [("3", "3"), ("3t", "313"), ("27m", "27"), ("27mu", "27")]:
     external_deps_prime = external_deps + [
-      "@com_github_python_cpython%s//:cpython_header_lib" % version,
+      "@com_github_python_cpython%s//:cpython_header_lib" % cpython,
       "@vendored_pyconfig%s//:pyconfig_lib" % suffix,
     ]
     name_prime = name + "_py" + suffix
     deps_prime = [dep + "_py" + suffix for dep in deps]
+    is_free_threaded = suffix.endswith("t")
     native.cc_library(
         name = name_prime,
         srcs = srcs + private_hdrs,
         hdrs = hdrs,
-        copts = python_bridge_include_copts() + python_bridge_copts(is_3rd_party) + copts,
+        copts = python_bridge_include_copts() +
+                python_bridge_copts(is_3rd_party, is_free_threaded) + copts,
         linkopts = linkopts,
         includes = includes,
         deps = external_deps_prime + deps_prime,
@@ -92,6 +110,52 @@ def python_bridge_cc_library(name,
         strip_include_prefix = strip_include_prefix,
     )
 
+def python_bridge_static_tracer_module(
+        name,
+        tracer_factory,
+        tracer_factory_header,
+        python_suffix = "3",
+        deps = [],
+        visibility = None):
+  """Makes name.so, a python module with the same functions as bridge_tracer
+  whose load_tracer(config, scope_manager=None, **options) makes tracers with
+  a C++ opentracing::TracerFactory linked in statically instead of loading a
+  plugin.
+
+  Build with --config=release_static to let ThinLTO devirtualize calls into
+  the tracer.
+
+  Args:
+    name: the module's name
+    tracer_factory: the qualified name of the opentracing::TracerFactory
+      subclass, e.g. opentracing::mocktracer::MockTracerFactory
+    tracer_factory_header: the header that declares tracer_factory
+    python_suffix: the suffix of the python build to target, e.g. 3 or 3t
+    deps: the libraries that implement the tracer
+  """
+  native.genrule(
+      name = name + "_src",
+      srcs = [Label("//bazel:static_tracer_module.cpp.tpl")],
+      outs = [name + "_module.cpp"],
+      cmd = ("sed -e 's|%{module_name}|" + name + "|g' " +
+             "-e 's|%{tracer_factory}|" + tracer_factory + "|g' " +
+             "-e 's|%{tracer_factory_header}|" + tracer_factory_header + "|g' " +
+             "$< > $@"),
+  )
+  native.cc_binary(
+      name = name + ".so",
+      srcs = [name + "_module.cpp"],
+      copts = python_bridge_include_copts() +
+              python_bridge_copts(is_free_threaded = python_suffix.endswith("t")),
+      linkshared = True,
+      linkstatic = 1,
+      visibility = visibility,
+      deps = [
+          Label("//:bridge_tracer_lib_py" + python_suffix),
+          Label("//:module_interface_py" + python_suffix),
+      ] + deps,
+  )
+
 def python_bridge_cc_binary(
         name,
         args = [],
@@ -166,3 +230,25 @@ def python_bridge_test(
         deps = external_deps + deps,
     )
 
+
+def python_bridge_binary(
+        name,
+        args = [],
+        srcs = [],
+        main = None,
+        data = [],
+        visibility = None,
+        external_deps = [],
+        python_version = "PY3",
+        deps = []):
+  native.py_binary(
+        name = name,
+        args = args,
+        srcs = srcs,
+        main = main,
+        python_version = python_version,
+        data = data,
+        visibility = visibility,
+        stamp = 1,
+        deps = external_deps + deps,
+    )
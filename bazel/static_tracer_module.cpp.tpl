@@ -0,0 +1,105 @@
+// Generated by python_bridge_static_tracer_module from
+// bazel/static_tracer_module.cpp.tpl.
+//
+// A bridge module with the C++ tracer made by %{tracer_factory} linked in
+// statically, so that spans are created without going through a
+// dynamically loaded plugin.
+#include <Python.h>
+
+#include "python_bridge_tracer/module.h"
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+#include "%{tracer_factory_header}"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// loadTracer
+//--------------------------------------------------------------------------------------------------
+static PyObject* loadTracer(PyObject* self, PyObject* args, PyObject* keywords) noexcept try {
+  static char* keyword_names[] = {const_cast<char*>("config"),
+                                  const_cast<char*>("scope_manager"), nullptr};
+  PythonObjectWrapper named_keywords;
+  PythonObjectWrapper option_keywords;
+  if (!splitTracerOptions(keywords, keyword_names, named_keywords, option_keywords)) {
+    return nullptr;
+  }
+  const char* config = nullptr;
+  PyObject* scope_manager = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, named_keywords, "s|O:load_tracer",
+                                  keyword_names, &config, &scope_manager) == 0) {
+    return nullptr;
+  }
+  TracerOptions options;
+  if (!parseTracerOptions(option_keywords, options)) {
+    return nullptr;
+  }
+  %{tracer_factory} tracer_factory;
+  std::string error_message;
+  auto tracer_maybe = tracer_factory.MakeTracer(config, error_message);
+  if (!tracer_maybe) {
+    if (error_message.empty()) {
+      error_message = tracer_maybe.error().message();
+    }
+    PyErr_Format(PyExc_RuntimeError, "failed to make tracer: %s",
+                 error_message.c_str());
+    return nullptr;
+  }
+  return makeTracer(self, std::move(*tracer_maybe), scope_manager, options);
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to load tracer: %s", e.what());
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// noopTracer
+//--------------------------------------------------------------------------------------------------
+static PyObject* noopTracer(PyObject* self, PyObject* args, PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("scope_manager"), nullptr};
+  PyObject* scope_manager = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "|O:noop_tracer", keyword_names,
+        &scope_manager) == 0) {
+    return nullptr;
+  }
+  return makeNoopTracer(self, scope_manager);
+}
+
+//--------------------------------------------------------------------------------------------------
+// flush
+//--------------------------------------------------------------------------------------------------
+void flush(opentracing::Tracer& /*tracer*/,
+           std::chrono::microseconds /*timeout*/) noexcept {
+  // Flushing isn't part of the OpenTracing API; tracers that need it should
+  // be bridged with a hand-written module.
+}
+
+//--------------------------------------------------------------------------------------------------
+// ModuleMethods
+//--------------------------------------------------------------------------------------------------
+static PyMethodDef ModuleMethods[] = {
+    {"load_tracer", reinterpret_cast<PyCFunction>(loadTracer),
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("makes a tracer from a configuration of %{tracer_factory}; "
+               "additional keyword arguments are tracer options")},
+    {"noop_tracer", reinterpret_cast<PyCFunction>(noopTracer),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("makes a tracer that does nothing")},
+    {nullptr, nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// execModule
+//--------------------------------------------------------------------------------------------------
+static int execModule(PyObject* module) noexcept {
+  return setupClasses(module) ? 0 : -1;
+}
+} // namespace python_bridge_tracer
+
+//--------------------------------------------------------------------------------------------------
+// PyInit_%{module_name}
+//--------------------------------------------------------------------------------------------------
+extern "C" {
+PYTHON_BRIDGE_TRACER_DEFINE_MODULE(%{module_name}) {
+  using namespace python_bridge_tracer;
+  PYTHON_BRIDGE_TRACER_MODULE_RETURN(makeModule(
+      "%{module_name}", "bridge a statically linked c++ tracer", ModuleMethods,
+      execModule));
+}
+} // extern "C"
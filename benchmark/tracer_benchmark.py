@@ -0,0 +1,49 @@
+import os
+import sys
+import timeit
+import opentracing
+
+for pyversion in os.listdir('binary'):
+    sys.path.append('binary/' + pyversion)
+import bridge_tracer
+
+MOCKTRACER_LIBRARY = 'external/io_opentracing_cpp/mocktracer/libmocktracer_plugin.so'
+NUMBER = 100000
+
+def make_tracers():
+    result = [
+        ('opentracing.Tracer', opentracing.Tracer()),
+        ('bridge_tracer.noop_tracer', bridge_tracer.noop_tracer()),
+    ]
+    if os.path.exists(MOCKTRACER_LIBRARY):
+        config = '{ "output_file" : "%s" }' % os.devnull
+        result.append(('mocktracer sample_rate=0',
+                       bridge_tracer.load_tracer(MOCKTRACER_LIBRARY, config, sample_rate=0.0)))
+        result.append(('mocktracer',
+                       bridge_tracer.load_tracer(MOCKTRACER_LIBRARY, config)))
+    return result
+
+def start_span(tracer):
+    span = tracer.start_span('abc', tags={'component': 'benchmark'})
+    span.set_tag('abc', 123)
+    span.finish()
+
+def start_active_span(tracer):
+    with tracer.start_active_span('abc') as scope:
+        scope.span.set_tag('abc', 123)
+
+def uninstrumented(tracer):
+    pass
+
+def report(name, function, tracer):
+    seconds = min(timeit.repeat(lambda: function(tracer), number=NUMBER, repeat=3))
+    print('%-28s %-20s %8.1f ns/op' % (name, function.__name__, seconds / NUMBER * 1.0e9))
+
+def main():
+    report('none', uninstrumented, None)
+    for name, tracer in make_tracers():
+        report(name, start_span, tracer)
+        report(name, start_active_span, tracer)
+
+if __name__ == '__main__':
+    main()
@@ -27,4 +27,54 @@ if [[ "$1" == "clang_tidy" ]]; then
 elif [[ "$1" == "test" ]]; then
   bazel test $BAZEL_TEST_OPTIONS -c dbg //...
   exit 0
+elif [[ "$1" == "test_usdt" ]]; then
+  bazel test $BAZEL_TEST_OPTIONS -c dbg --define usdt=enabled \
+        --test_env=EXPECT_USDT_PROBES=1 \
+        //test:tracer_test_py3
+  exit 0
+elif [[ "$1" == "test_free_threaded" ]]; then
+  # Requires a free-threaded python3.13t with the opentracing package. The
+  # GIL is left enabled by default so that the test catches the module
+  # re-enabling it.
+  bazel build $BAZEL_OPTIONS -c dbg //binary/py3t:bridge_tracer.so \
+        @io_opentracing_cpp//mocktracer:libmocktracer_plugin.so \
+        //tools:shm_ring_dump
+  TEST_DIR=`mktemp -d`
+  mkdir -p "$TEST_DIR/binary/py3t" \
+           "$TEST_DIR/external/io_opentracing_cpp/mocktracer" \
+           "$TEST_DIR/tools"
+  cp bazel-bin/binary/py3t/bridge_tracer.so "$TEST_DIR/binary/py3t"
+  cp bazel-bin/external/io_opentracing_cpp/mocktracer/libmocktracer_plugin.so \
+     "$TEST_DIR/external/io_opentracing_cpp/mocktracer"
+  cp bazel-bin/tools/shm_ring_dump "$TEST_DIR/tools"
+  cd "$TEST_DIR"
+  python3.13t "${SRC_DIR}/test/tracer_test.py"
+  exit 0
+elif [[ "$1" == "benchmark" ]]; then
+  bazel run $BAZEL_OPTIONS -c opt //benchmark:tracer_benchmark_py3
+  exit 0
+elif [[ "$1" == "release_benchmark" ]]; then
+  # Builds the release configuration with profiles gathered by running the
+  # benchmark and reports its ns/op against the default optimized build.
+  export PATH=/usr/lib/llvm-6.0/bin:$PATH
+  export CC=clang
+  PROFILE_DIR=`mktemp -d`
+  bazel run $BAZEL_OPTIONS -c opt //benchmark:tracer_benchmark_py3 \
+        | tee "$PROFILE_DIR/default.txt"
+  bazel run $BAZEL_OPTIONS --config=release \
+        --fdo_instrument="$PROFILE_DIR/raw" \
+        //benchmark:tracer_benchmark_py3 > /dev/null
+  llvm-profdata merge -output="$PROFILE_DIR/bridge_tracer.profdata" \
+        "$PROFILE_DIR"/raw/*.profraw
+  bazel run $BAZEL_OPTIONS --config=release \
+        --fdo_optimize="$PROFILE_DIR/bridge_tracer.profdata" \
+        //benchmark:tracer_benchmark_py3 | tee "$PROFILE_DIR/release.txt"
+  echo "default -> release:"
+  paste -d '|' "$PROFILE_DIR/default.txt" "$PROFILE_DIR/release.txt" | \
+    awk -F '|' '{
+      n = split($1, before, " "); m = split($2, after, " ");
+      printf "%s %8.1f -> %8.1f ns/op (%+.1f%%)\n", substr($1, 1, 49),
+             before[n - 1], after[m - 1],
+             100 * (after[m - 1] - before[n - 1]) / before[n - 1] }'
+  exit 0
 fi
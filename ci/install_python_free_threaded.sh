@@ -0,0 +1,22 @@
+#!/bin/bash
+
+set -e
+
+[ -z "${PYTHON_VERSION}" ] && export PYTHON_VERSION="3.13.0"
+
+apt-get update 
+apt-get install --no-install-recommends --no-install-suggests -y \
+         wget \
+         ca-certificates \
+         build-essential \
+         libssl-dev \
+         zlib1g-dev \
+         libffi-dev
+wget https://www.python.org/ftp/python/${PYTHON_VERSION}/Python-${PYTHON_VERSION}.tgz
+tar xzf Python-${PYTHON_VERSION}.tgz
+cd Python-${PYTHON_VERSION}
+# Installs python3.13t alongside the system's python.
+./configure --disable-gil
+make -j$(nproc)
+make altinstall
+python3.13t -m pip install opentracing
@@ -7,13 +7,20 @@
 #include <Python.h>
 #include <opentracing/tracer.h>
 
+#include "python_bridge_tracer/tracer_options.h"
 #include "python_bridge_tracer/version.h"
 
+// Keeps the module's init function visible when the rest of the module is
+// compiled with -fvisibility=hidden.
+#define PYTHON_BRIDGE_TRACER_EXPORT [[gnu::visibility("default")]]
+
 #ifdef PYTHON_BRIDGE_TRACER_PY3
-#define PYTHON_BRIDGE_TRACER_DEFINE_MODULE(NAME) PyMODINIT_FUNC PyInit_##NAME() noexcept
+#define PYTHON_BRIDGE_TRACER_DEFINE_MODULE(NAME) \
+  PyMODINIT_FUNC PyInit_##NAME PYTHON_BRIDGE_TRACER_EXPORT() noexcept
 #define PYTHON_BRIDGE_TRACER_MODULE_RETURN(VALUE) return VALUE
 #else
-#define PYTHON_BRIDGE_TRACER_DEFINE_MODULE(NAME) PyMODINIT_FUNC init##NAME() noexcept
+#define PYTHON_BRIDGE_TRACER_DEFINE_MODULE(NAME) \
+  PyMODINIT_FUNC init##NAME PYTHON_BRIDGE_TRACER_EXPORT() noexcept
 #define PYTHON_BRIDGE_TRACER_MODULE_RETURN(VALUE) do { (void)(VALUE); return; } while (false)
 #endif
 
@@ -26,11 +33,51 @@ opentracing::Tracer& extractTracer(PyObject* tracer_object) noexcept;
 
 /**
  * Make an OpenTracing python tracer from a C++ tracer and a scope manager
+ * @param module the module whose classes to use, i.e. the self argument of a
+ * module function
+ * @param tracer the C++ tracer
+ * @param scope_manager a scope manager object
+ * @return the OpenTracing python tracer object
+ */
+PyObject* makeTracer(PyObject* module, std::shared_ptr<opentracing::Tracer> tracer,
+                     PyObject* scope_manager) noexcept;
+
+/**
+ * Make an OpenTracing python tracer from a C++ tracer and a scope manager
+ * using the classes of the module made by the three-argument makeModule.
+ *
+ * Kept for modules written against earlier versions of the bridge; it only
+ * supports a single interpreter. New modules should pass their module.
+ * @param tracer the C++ tracer
+ * @param scope_manager a scope manager object
+ * @return the OpenTracing python tracer object
+ */
+PyObject* makeTracer(std::shared_ptr<opentracing::Tracer> tracer,
+                     PyObject* scope_manager) noexcept;
+
+/**
+ * Make an OpenTracing python tracer from a C++ tracer, a scope manager and
+ * bridge options
+ * @param module the module whose classes to use
  * @param tracer the C++ tracer
  * @param scope_manager a scope manager object
+ * @param options options for the bridge
  * @return the OpenTracing python tracer object
  */
-PyObject* makeTracer(std::shared_ptr<opentracing::Tracer> tracer, PyObject* scope_manager) noexcept;
+PyObject* makeTracer(PyObject* module,
+                     std::shared_ptr<opentracing::Tracer> tracer,
+                     PyObject* scope_manager,
+                     const TracerOptions& options) noexcept;
+
+/**
+ * Make an OpenTracing python tracer that does nothing. Every span it starts is
+ * the same preallocated no-op span and calls return without converting their
+ * arguments.
+ * @param module the module whose classes to use
+ * @param scope_manager a scope manager object or nullptr to use the default
+ * @return the OpenTracing python tracer object
+ */
+PyObject* makeNoopTracer(PyObject* module, PyObject* scope_manager) noexcept;
 
 /**
  * An extension method not part of the official OpenTracing API but commonly
@@ -54,5 +101,36 @@ bool setupClasses(
     const std::vector<PyMethodDef>& tracer_extension_methods = {},
     const std::vector<PyGetSetDef>& tracer_extension_getsets = {}) noexcept;
 
-PyObject* makeModule(const char* name, const char* doc, PyMethodDef* methods) noexcept;
+/**
+ * Make the module's definition.
+ *
+ * With python 3, the module uses multi-phase initialization (PEP 489) and
+ * keeps its classes in per-module state so that it can be imported by several
+ * interpreters, including ones with their own GIL, and the definition is
+ * returned to be executed by the import system. With python 2, the module is
+ * created and executed immediately.
+ * @param name the module's name
+ * @param doc the module's docstring
+ * @param methods the module's functions
+ * @param exec a function that sets up the module's classes, returning 0 if
+ * successful and -1 with an exception set otherwise
+ * @return the module definition or module
+ */
+PyObject* makeModule(const char* name, const char* doc, PyMethodDef* methods,
+                     int (*exec)(PyObject* module)) noexcept;
+
+/**
+ * Make the module with single-phase initialization. The caller sets up its
+ * classes with setupClasses.
+ *
+ * Kept for modules written against earlier versions of the bridge; such a
+ * module can only be imported by a single interpreter and its tracers are
+ * made with the two-argument makeTracer.
+ * @param name the module's name
+ * @param doc the module's docstring
+ * @param methods the module's functions
+ * @return the module
+ */
+PyObject* makeModule(const char* name, const char* doc,
+                     PyMethodDef* methods) noexcept;
 } // namespace python_bridge_tracer
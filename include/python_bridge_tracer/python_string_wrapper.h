@@ -13,13 +13,23 @@ class PythonStringWrapper {
  public:
   PythonStringWrapper() noexcept = default;
 
-  PythonStringWrapper(PyObject* object) noexcept;
+  /**
+   * @param object the python string
+   * @param max_length if non-zero, only the string's first max_length
+   * characters are accessed
+   */
+  PythonStringWrapper(PyObject* object, size_t max_length = 0) noexcept;
 
    /**
     * @return true if an error occurred.
     */
   bool error() const noexcept { return data_ == nullptr; }
 
+  /**
+   * @return true if the string was longer than max_length.
+   */
+  bool truncated() const noexcept { return truncated_; }
+
   operator opentracing::string_view() const noexcept {
     return opentracing::string_view{data_, static_cast<size_t>(length_)};
   }
@@ -28,5 +38,6 @@ class PythonStringWrapper {
   PythonObjectWrapper utf8_;
   char* data_{nullptr};
   Py_ssize_t length_{0};
+  bool truncated_{false};
 };
 }  // namespace python_bridge_tracer
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Python.h>
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+namespace python_bridge_tracer {
+/**
+ * Options that control how the bridge translates calls to the C++ tracer.
+ */
+struct TracerOptions {
+  /**
+   * Prefixes (matched case-insensitively) of the carrier keys used by the
+   * tracer for propagation. If non-empty, only matching keys are passed to
+   * the tracer when it iterates over a carrier.
+   */
+  std::vector<std::string> propagation_key_prefixes;
+
+  /**
+   * Probability with which a span without any references is sampled. Spans
+   * that aren't sampled are replaced with a no-op span and their children
+   * inherit the decision.
+   */
+  double sample_rate = 1.0;
+
+  /**
+   * Operations for which spans are never sampled.
+   */
+  std::vector<std::string> denied_operations;
+
+  /**
+   * Maximum number of spans per second sampled for an operation, up to
+   * 1000000.
+   */
+  std::vector<std::pair<std::string, double>> operation_rate_limits;
+
+  /**
+   * If non-zero, spans are finished on a native worker thread through a queue
+   * that holds up to this many spans. Spans finished while the queue is full
+   * are finished synchronously.
+   */
+  size_t export_queue_size = 0;
+
+  /**
+   * If non-zero, every overhead_sample_interval-th call of each span and
+   * propagation operation on a thread is timed. See Tracer.overhead.
+   */
+  size_t overhead_sample_interval = 0;
+
+  /**
+   * If non-zero, the durations and errors of finished spans are aggregated
+   * per operation name for up to this many distinct operations. See
+   * Tracer.red_metrics.
+   */
+  size_t red_metrics_max_operations = 0;
+
+  /**
+   * If non-zero, finished spans are buffered by trace, up to this many spans,
+   * and only traces chosen by the tail sampling rules reach the tracer. A
+   * trace is kept if one of its spans is tagged as an error.
+   */
+  size_t tail_sampling_max_spans = 0;
+
+  /**
+   * If non-zero, traces whose local root span takes at least this many
+   * seconds, up to 3600, are kept by tail sampling.
+   */
+  double tail_sampling_min_duration = 0;
+
+  /**
+   * Traces with a span of one of these operations are kept by tail sampling.
+   */
+  std::vector<std::string> tail_sampling_operations;
+
+  /**
+   * If non-zero, a span keeps at most this many log records; older records
+   * are dropped to make room for newer ones and the number dropped is set as
+   * the span's dropped_logs tag when it finishes.
+   */
+  size_t max_logs_per_span = 0;
+
+  /**
+   * If non-zero, the total size of the keys and values of the log records
+   * kept by a span is bounded by this many bytes, with each record counted as
+   * at least one byte. Records are dropped as with max_logs_per_span.
+   */
+  size_t max_log_bytes_per_span = 0;
+
+  /**
+   * If non-zero, string tag and log values longer than this are cut to this
+   * length and value_truncation_marker is appended. The length of a str is
+   * counted in characters and that of bytes in bytes. Only the kept prefix of
+   * a str is encoded.
+   */
+  size_t max_value_length = 0;
+
+  /**
+   * Appended to values truncated by max_value_length.
+   */
+  std::string value_truncation_marker = "...";
+
+  /**
+   * If true, spans are registered from when they start until they finish so
+   * that spans that are never finished can be found. See Tracer.live_spans.
+   */
+  bool track_live_spans = false;
+};
+
+/**
+ * Parse tracer options from a python dictionary of keyword arguments.
+ * @param options a dictionary of options or nullptr
+ * @param tracer_options the parsed options
+ * @return true if successful
+ */
+bool parseTracerOptions(PyObject* options, TracerOptions& tracer_options) noexcept;
+
+/**
+ * Separate the keyword arguments of a function that accepts tracer options as
+ * additional keyword arguments.
+ * @param keywords the function's keyword arguments or nullptr
+ * @param keyword_names the null-terminated names of the function's own
+ * keyword arguments
+ * @param named_keywords set to a dictionary of the function's own keyword
+ * arguments; left empty if keywords is nullptr
+ * @param option_keywords set to a dictionary of the remaining keyword
+ * arguments, to be passed to parseTracerOptions
+ * @return true if successful
+ */
+bool splitTracerOptions(PyObject* keywords, char** keyword_names,
+                        PythonObjectWrapper& named_keywords,
+                        PythonObjectWrapper& option_keywords) noexcept;
+} // namespace python_bridge_tracer
@@ -12,8 +12,30 @@ struct TypeDescription {
   void* dealloc = nullptr;
   void* methods = nullptr;
   void* getset = nullptr;
+  void* call = nullptr;
+  void* descr_get = nullptr;
+  void* iter = nullptr;
+  void* iternext = nullptr;
+
+  // Instances of a class with a traverse function are tracked by the garbage
+  // collector and must be allocated with newPythonGcObject.
+  void* traverse = nullptr;
+  void* clear = nullptr;
+
+  // Only used with python 3.
+  void* await = nullptr;
 };
 
+/**
+ * Check if an object is an instance of a class made with the given dealloc
+ * function. Unlike comparing types, this recognizes the class's instances from
+ * every interpreter the module is loaded into.
+ * @param object the object to check
+ * @param dealloc the class's dealloc function
+ * @return true if object is an instance of the class
+ */
+bool hasDealloc(PyObject* object, void* dealloc) noexcept;
+
 #ifdef PYTHON_BRIDGE_TRACER_PY3
 PyObject* makeTypeImpl(const TypeDescription& type_description) noexcept;
 
@@ -42,25 +64,26 @@ PyObject* makeType(const TypeDescription& type_description) noexcept {
       nullptr,                         /* tp_as_sequence */
       nullptr,                         /* tp_as_mapping */
       nullptr,                         /* tp_hash */
-      nullptr,                         /* tp_call */
+      reinterpret_cast<ternaryfunc>(type_description.call),  /* tp_call */
       nullptr,                         /* tp_str */
       nullptr,                         /* tp_getattro */
       nullptr,                         /* tp_setattro */
       nullptr,                         /* tp_as_buffer */
-      Py_TPFLAGS_DEFAULT,        /* tp_flags */
+      Py_TPFLAGS_DEFAULT |
+        (type_description.traverse != nullptr ? Py_TPFLAGS_HAVE_GC : 0),  /* tp_flags */
       static_cast<char*>(type_description.doc),      /* tp_doc */
-      nullptr,                         /* tp_traverse */
-      nullptr,                         /* tp_clear */
+      reinterpret_cast<traverseproc>(type_description.traverse),  /* tp_traverse */
+      reinterpret_cast<inquiry>(type_description.clear),  /* tp_clear */
       nullptr,                         /* tp_richcompare */
       0,                         /* tp_weaklistoffset */
-      nullptr,                         /* tp_iter */
-      nullptr,                         /* tp_iternext */
+      reinterpret_cast<getiterfunc>(type_description.iter),  /* tp_iter */
+      reinterpret_cast<iternextfunc>(type_description.iternext),  /* tp_iternext */
       static_cast<PyMethodDef*>(type_description.methods),  /* tp_methods */
       nullptr,                         /* tp_members */
       static_cast<PyGetSetDef*>(type_description.getset),   /* tp_getset */
       nullptr,                         /* tp_base */
       nullptr,                         /* tp_dict */
-      nullptr,                         /* tp_descr_get */
+      reinterpret_cast<descrgetfunc>(type_description.descr_get),  /* tp_descr_get */
       nullptr,                         /* tp_descr_set */
       0,                         /* tp_dictoffset */
       nullptr,                         /* tp_init */
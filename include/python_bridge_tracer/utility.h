@@ -44,6 +44,19 @@ T* newPythonObject(PyObject* type) {
   return reinterpret_cast<T*>(result);
 }
 
+/**
+ * Construct a new python object of a class with a traverse function. The
+ * object must be passed to PyObject_GC_Track once its members are set and freed
+ * with PyObject_GC_Del.
+ * @param type the python class of the object
+ * @return the newly constructed object.
+ */
+template <class T>
+T* newPythonGcObject(PyObject* type) {
+  auto result = _PyObject_GC_New(reinterpret_cast<PyTypeObject*>(type));
+  return reinterpret_cast<T*>(result);
+}
+
 /**
  * Import and lookup an attriburte from a module.
  * @param module_name the module to import
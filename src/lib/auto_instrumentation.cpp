@@ -0,0 +1,571 @@
+#include "auto_instrumentation.h"
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "object_mutex.h"
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/python_string_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+#include "span.h"
+#include "tracer.h"
+
+namespace python_bridge_tracer {
+const char* const AutoInstrumentationCapsuleName =
+    "python_bridge_tracer.auto_instrumentation";
+
+const char* const ToolName = "python_bridge_tracer";
+
+// The code flags of generators, coroutines and async generators
+// (CO_GENERATOR, CO_COROUTINE and CO_ASYNC_GENERATOR).
+const long SuspendableCodeFlags = 0x20 | 0x80 | 0x200;
+
+//--------------------------------------------------------------------------------------------------
+// AutoInstrumentation
+//--------------------------------------------------------------------------------------------------
+namespace {
+struct ActiveCall {
+  PyObject* code;
+  PyObject* scope;
+  PyObject* span;
+};
+
+struct AutoInstrumentation {
+  ~AutoInstrumentation() noexcept {
+    for (auto& code : instrumented_code) {
+      Py_DECREF(code.first);
+    }
+    for (auto& thread_calls : active_calls) {
+      for (auto& active_call : thread_calls.second) {
+        Py_XDECREF(active_call.scope);
+        Py_XDECREF(active_call.span);
+      }
+    }
+  }
+
+  // Borrowed so that the tracer, which owns the instrumentation, isn't kept
+  // alive by it. Reset when the instrumentation is stopped.
+  PyObject* tracer;
+  PythonObjectWrapper monitoring;
+  PythonObjectWrapper disable;
+  int tool_id;
+  long py_start_event;
+  long py_return_event;
+  long py_unwind_event;
+  std::unordered_set<std::string> qualified_names;
+
+  // The code objects of the traced functions seen so far, mapped to their
+  // operation names. Holds a reference to each code object so that their
+  // addresses stay unique. Guarded by mutex since functions can start on
+  // several threads at once when the GIL is disabled.
+  ObjectMutex mutex;
+  std::unordered_map<PyObject*, std::string> instrumented_code;
+
+  // The traced calls in progress on each thread, innermost last. The scope
+  // and span are null if the span couldn't be started. Kept here rather than
+  // in thread local storage so that stopping can finish them.
+  std::unordered_map<std::thread::id, std::vector<ActiveCall>> active_calls;
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// getAutoInstrumentation
+//--------------------------------------------------------------------------------------------------
+static AutoInstrumentation& getAutoInstrumentation(PyObject* capsule) noexcept {
+  return *static_cast<AutoInstrumentation*>(
+      PyCapsule_GetPointer(capsule, AutoInstrumentationCapsuleName));
+}
+
+//--------------------------------------------------------------------------------------------------
+// deleteAutoInstrumentation
+//--------------------------------------------------------------------------------------------------
+static void deleteAutoInstrumentation(PyObject* capsule) noexcept {
+  delete &getAutoInstrumentation(capsule);
+}
+
+//--------------------------------------------------------------------------------------------------
+// callMethod
+//--------------------------------------------------------------------------------------------------
+static PyObject* callMethod(PyObject* object, const char* name,
+                            PyObject* args) noexcept {
+  if (args == nullptr) {
+    return nullptr;
+  }
+  PythonObjectWrapper args_wrapper{args};
+  PythonObjectWrapper method = PyObject_GetAttrString(object, name);
+  if (method.error()) {
+    return nullptr;
+  }
+  return PyObject_CallObject(method, args_wrapper);
+}
+
+//--------------------------------------------------------------------------------------------------
+// reportError
+//--------------------------------------------------------------------------------------------------
+static PyObject* reportError(PyObject* code) noexcept {
+  // Exceptions raised by a callback would propagate into the traced function,
+  // so report them as unraisable instead.
+  PyErr_WriteUnraisable(code);
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getQualifiedName
+//--------------------------------------------------------------------------------------------------
+static bool getQualifiedName(PyObject* code, std::string& result) {
+  // The frame of the function being started is the current frame when the
+  // PY_START callback runs.
+  auto globals = PyEval_GetGlobals();
+  if (globals == nullptr) {
+    PyErr_Format(PyExc_RuntimeError, "no frame is executing");
+    return false;
+  }
+  auto module_name = PyDict_GetItemString(globals, "__name__");
+  if (module_name == nullptr) {
+    PyErr_Format(PyExc_RuntimeError, "__name__ isn't set in globals");
+    return false;
+  }
+  PythonObjectWrapper qualname = PyObject_GetAttrString(code, "co_qualname");
+  if (qualname.error()) {
+    return false;
+  }
+  PythonStringWrapper module_name_str{module_name};
+  if (module_name_str.error()) {
+    return false;
+  }
+  PythonStringWrapper qualname_str{qualname};
+  if (qualname_str.error()) {
+    return false;
+  }
+  opentracing::string_view module_name_view = module_name_str;
+  opentracing::string_view qualname_view = qualname_str;
+  result.assign(module_name_view.data(), module_name_view.size());
+  result.append(1, '.');
+  result.append(qualname_view.data(), qualname_view.size());
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// isSuspendable
+//--------------------------------------------------------------------------------------------------
+static bool isSuspendable(PyObject* code, bool& result) noexcept {
+  PythonObjectWrapper flags_object = PyObject_GetAttrString(code, "co_flags");
+  if (flags_object.error()) {
+    return false;
+  }
+  long flags;
+  if (!toLong(flags_object, flags)) {
+    return false;
+  }
+  result = (flags & SuspendableCodeFlags) != 0;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// startCall
+//--------------------------------------------------------------------------------------------------
+static PyObject* startCall(AutoInstrumentation& instrumentation, PyObject* code,
+                           const std::string& operation_name) noexcept try {
+  auto thread_id = std::this_thread::get_id();
+  PythonObjectWrapper tracer;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{instrumentation.mutex};
+    if (instrumentation.tracer == nullptr) {
+      Py_RETURN_NONE;
+    }
+    Py_INCREF(instrumentation.tracer);
+    tracer = instrumentation.tracer;
+    // Reserve first so that every PY_START pushes exactly one call to be
+    // popped by its PY_RETURN or PY_UNWIND.
+    auto& active_calls = instrumentation.active_calls[thread_id];
+    active_calls.reserve(active_calls.size() + 1);
+  }
+  PythonObjectWrapper span;
+  auto scope = startActiveScope(tracer, operation_name, nullptr, span);
+  {
+    std::lock_guard<ObjectMutex> lock_guard{instrumentation.mutex};
+    instrumentation.active_calls[thread_id].push_back(
+        ActiveCall{code, scope, span.release()});
+  }
+  if (scope == nullptr) {
+    return reportError(code);
+  }
+  Py_RETURN_NONE;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "%s", e.what());
+  return reportError(code);
+}
+
+//--------------------------------------------------------------------------------------------------
+// instrumentCode
+//--------------------------------------------------------------------------------------------------
+static PyObject* instrumentCode(AutoInstrumentation& instrumentation,
+                                PyObject* code) noexcept try {
+  std::string qualified_name;
+  if (!getQualifiedName(code, qualified_name)) {
+    return reportError(code);
+  }
+  bool is_suspendable;
+  if (!isSuspendable(code, is_suspendable)) {
+    return reportError(code);
+  }
+  if (is_suspendable ||
+      instrumentation.qualified_names.count(qualified_name) == 0) {
+    Py_INCREF(instrumentation.disable);
+    return instrumentation.disable;
+  }
+  PythonObjectWrapper result = callMethod(
+      instrumentation.monitoring, "set_local_events",
+      Py_BuildValue("iOl", instrumentation.tool_id, code,
+                    instrumentation.py_return_event));
+  if (result.error()) {
+    return reportError(code);
+  }
+  std::unique_lock<ObjectMutex> lock{instrumentation.mutex};
+  auto emplace_result = instrumentation.instrumented_code.emplace(
+      code, std::move(qualified_name));
+  if (emplace_result.second) {
+    Py_INCREF(code);
+  }
+  // Elements aren't erased until the instrumentation is destroyed so the
+  // operation name stays valid after unlocking.
+  const auto& operation_name = emplace_result.first->second;
+  lock.unlock();
+  return startCall(instrumentation, code, operation_name);
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "%s", e.what());
+  return reportError(code);
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishCall
+//--------------------------------------------------------------------------------------------------
+static PyObject* finishCall(AutoInstrumentation& instrumentation,
+                            PyObject* code, PyObject* exception) noexcept {
+  PythonObjectWrapper scope;
+  PythonObjectWrapper span;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{instrumentation.mutex};
+    auto iter = instrumentation.active_calls.find(std::this_thread::get_id());
+    // PY_UNWIND is a global event, so it's also received for the frames of
+    // untraced functions.
+    if (iter == instrumentation.active_calls.end() || iter->second.empty() ||
+        iter->second.back().code != code) {
+      Py_RETURN_NONE;
+    }
+    scope = iter->second.back().scope;
+    span = iter->second.back().span;
+    iter->second.pop_back();
+  }
+  if (scope.error()) {
+    Py_RETURN_NONE;
+  }
+  bool was_finished;
+  if (exception == nullptr) {
+    was_finished = finishActiveScope(scope, span, Py_None, Py_None);
+  } else {
+    was_finished = finishActiveScope(
+        scope, span, reinterpret_cast<PyObject*>(Py_TYPE(exception)),
+        exception);
+  }
+  if (!was_finished) {
+    return reportError(code);
+  }
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// onStart
+//--------------------------------------------------------------------------------------------------
+static PyObject* onStart(PyObject* capsule, PyObject* args) noexcept {
+  auto code = PyTuple_GetItem(args, 0);
+  if (code == nullptr) {
+    return nullptr;
+  }
+  auto& instrumentation = getAutoInstrumentation(capsule);
+  std::unique_lock<ObjectMutex> lock{instrumentation.mutex};
+  auto iter = instrumentation.instrumented_code.find(code);
+  if (iter == instrumentation.instrumented_code.end()) {
+    lock.unlock();
+    return instrumentCode(instrumentation, code);
+  }
+  const auto& operation_name = iter->second;
+  lock.unlock();
+  return startCall(instrumentation, code, operation_name);
+}
+
+//--------------------------------------------------------------------------------------------------
+// onReturn
+//--------------------------------------------------------------------------------------------------
+static PyObject* onReturn(PyObject* capsule, PyObject* args) noexcept {
+  auto code = PyTuple_GetItem(args, 0);
+  if (code == nullptr) {
+    return nullptr;
+  }
+  return finishCall(getAutoInstrumentation(capsule), code, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// onUnwind
+//--------------------------------------------------------------------------------------------------
+static PyObject* onUnwind(PyObject* capsule, PyObject* args) noexcept {
+  auto code = PyTuple_GetItem(args, 0);
+  if (code == nullptr) {
+    return nullptr;
+  }
+  auto exception = PyTuple_GetItem(args, 2);
+  if (exception == nullptr) {
+    return nullptr;
+  }
+  return finishCall(getAutoInstrumentation(capsule), code, exception);
+}
+
+static PyMethodDef StartCallback = {"on_start",
+                                    reinterpret_cast<PyCFunction>(onStart),
+                                    METH_VARARGS, nullptr};
+
+static PyMethodDef ReturnCallback = {"on_return",
+                                     reinterpret_cast<PyCFunction>(onReturn),
+                                     METH_VARARGS, nullptr};
+
+static PyMethodDef UnwindCallback = {"on_unwind",
+                                     reinterpret_cast<PyCFunction>(onUnwind),
+                                     METH_VARARGS, nullptr};
+
+//--------------------------------------------------------------------------------------------------
+// getEvent
+//--------------------------------------------------------------------------------------------------
+static bool getEvent(PyObject* events, const char* name,
+                     long& result) noexcept {
+  PythonObjectWrapper event = PyObject_GetAttrString(events, name);
+  if (event.error()) {
+    return false;
+  }
+  return toLong(event, result);
+}
+
+//--------------------------------------------------------------------------------------------------
+// registerCallback
+//--------------------------------------------------------------------------------------------------
+static bool registerCallback(AutoInstrumentation& instrumentation, long event,
+                             PyObject* callback) noexcept {
+  PythonObjectWrapper result =
+      callMethod(instrumentation.monitoring, "register_callback",
+                 Py_BuildValue("ilO", instrumentation.tool_id, event, callback));
+  return !result.error();
+}
+
+//--------------------------------------------------------------------------------------------------
+// registerCallbacks
+//--------------------------------------------------------------------------------------------------
+static bool registerCallbacks(AutoInstrumentation& instrumentation,
+                              PyObject* capsule) noexcept {
+  const std::pair<long, PyMethodDef*> callbacks[] = {
+      {instrumentation.py_start_event, &StartCallback},
+      {instrumentation.py_return_event, &ReturnCallback},
+      {instrumentation.py_unwind_event, &UnwindCallback}};
+  for (auto& callback : callbacks) {
+    PythonObjectWrapper function =
+        PyCFunction_NewEx(callback.second, capsule, nullptr);
+    if (function.error()) {
+      return false;
+    }
+    if (!registerCallback(instrumentation, callback.first, function)) {
+      return false;
+    }
+  }
+  // sys.monitoring.restart_events isn't called since it would also re-enable
+  // the events other tools disabled.
+  PythonObjectWrapper result = callMethod(
+      instrumentation.monitoring, "set_events",
+      Py_BuildValue("il", instrumentation.tool_id,
+                    instrumentation.py_start_event |
+                        instrumentation.py_unwind_event));
+  return !result.error();
+}
+
+//--------------------------------------------------------------------------------------------------
+// releaseTool
+//--------------------------------------------------------------------------------------------------
+static bool releaseTool(AutoInstrumentation& instrumentation) noexcept {
+  auto tool_id = instrumentation.tool_id;
+  PythonObjectWrapper result =
+      callMethod(instrumentation.monitoring, "set_events",
+                 Py_BuildValue("ii", tool_id, 0));
+  if (result.error()) {
+    return false;
+  }
+  for (auto& code : instrumentation.instrumented_code) {
+    result = callMethod(instrumentation.monitoring, "set_local_events",
+                        Py_BuildValue("iOi", tool_id, code.first, 0));
+    if (result.error()) {
+      return false;
+    }
+  }
+  for (auto event :
+       {instrumentation.py_start_event, instrumentation.py_return_event,
+        instrumentation.py_unwind_event}) {
+    if (!registerCallback(instrumentation, event, Py_None)) {
+      return false;
+    }
+  }
+  result = callMethod(instrumentation.monitoring, "free_tool_id",
+                      Py_BuildValue("(i)", tool_id));
+  return !result.error();
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishSpan
+//--------------------------------------------------------------------------------------------------
+static bool finishSpan(PyObject* span) noexcept {
+  // Noop spans have nothing to finish.
+  if (!isSpan(span)) {
+    return true;
+  }
+  return getSpanBridge(span).finishCall(Py_None, Py_None);
+}
+
+//--------------------------------------------------------------------------------------------------
+// drainActiveCalls
+//--------------------------------------------------------------------------------------------------
+// Finish the calls that are still in progress, since their PY_RETURN and
+// PY_UNWIND events won't be received after the instrumentation stops.
+static void drainActiveCalls(AutoInstrumentation& instrumentation) noexcept {
+  std::unordered_map<std::thread::id, std::vector<ActiveCall>> active_calls;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{instrumentation.mutex};
+    instrumentation.tracer = nullptr;
+    active_calls.swap(instrumentation.active_calls);
+  }
+  auto thread_id = std::this_thread::get_id();
+  for (auto& thread_calls : active_calls) {
+    auto& calls = thread_calls.second;
+    for (auto iter = calls.rbegin(); iter != calls.rend(); ++iter) {
+      PythonObjectWrapper scope{iter->scope};
+      PythonObjectWrapper span{iter->span};
+      if (scope.error()) {
+        continue;
+      }
+      // Scopes can only be closed on the thread that activated them; the
+      // spans of other threads are finished without closing their scopes.
+      bool was_finished =
+          thread_calls.first == thread_id
+              ? finishActiveScope(scope, span, Py_None, Py_None)
+              : finishSpan(span);
+      if (!was_finished) {
+        PyErr_WriteUnraisable(iter->code);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeAutoInstrumentation
+//--------------------------------------------------------------------------------------------------
+static bool makeAutoInstrumentation(
+    PyObject* tracer, PyObject* qualified_names, int tool_id,
+    AutoInstrumentation& instrumentation) {
+  instrumentation.tracer = tracer;
+  instrumentation.tool_id = tool_id;
+  instrumentation.monitoring = getModuleAttribute("sys", "monitoring");
+  if (instrumentation.monitoring.error()) {
+    if (PyErr_ExceptionMatches(PyExc_AttributeError) != 0) {
+      PyErr_Clear();
+      PyErr_Format(PyExc_NotImplementedError,
+                   "auto-instrumentation requires sys.monitoring (Python "
+                   "3.12 or later)");
+    }
+    return false;
+  }
+  instrumentation.disable =
+      PyObject_GetAttrString(instrumentation.monitoring, "DISABLE");
+  if (instrumentation.disable.error()) {
+    return false;
+  }
+  PythonObjectWrapper events =
+      PyObject_GetAttrString(instrumentation.monitoring, "events");
+  if (events.error()) {
+    return false;
+  }
+  if (!getEvent(events, "PY_START", instrumentation.py_start_event) ||
+      !getEvent(events, "PY_RETURN", instrumentation.py_return_event) ||
+      !getEvent(events, "PY_UNWIND", instrumentation.py_unwind_event)) {
+    return false;
+  }
+  PythonObjectWrapper iterator = PyObject_GetIter(qualified_names);
+  if (iterator.error()) {
+    return false;
+  }
+  while (true) {
+    PythonObjectWrapper qualified_name = PyIter_Next(iterator);
+    if (qualified_name.error()) {
+      return PyErr_Occurred() == nullptr;
+    }
+    PythonStringWrapper qualified_name_str{qualified_name};
+    if (qualified_name_str.error()) {
+      return false;
+    }
+    opentracing::string_view qualified_name_view = qualified_name_str;
+    instrumentation.qualified_names.emplace(qualified_name_view.data(),
+                                            qualified_name_view.size());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// startAutoInstrumentation
+//--------------------------------------------------------------------------------------------------
+PyObject* startAutoInstrumentation(PyObject* tracer, PyObject* qualified_names,
+                                   int tool_id) noexcept try {
+  std::unique_ptr<AutoInstrumentation> instrumentation{
+      new AutoInstrumentation{}};
+  if (!makeAutoInstrumentation(tracer, qualified_names, tool_id,
+                               *instrumentation)) {
+    return nullptr;
+  }
+  PythonObjectWrapper result =
+      callMethod(instrumentation->monitoring, "use_tool_id",
+                 Py_BuildValue("is", tool_id, ToolName));
+  if (result.error()) {
+    return nullptr;
+  }
+  auto& instrumentation_ref = *instrumentation;
+  PythonObjectWrapper capsule =
+      PyCapsule_New(static_cast<void*>(instrumentation.get()),
+                    AutoInstrumentationCapsuleName, deleteAutoInstrumentation);
+  if (capsule.error()) {
+    return nullptr;
+  }
+  instrumentation.release();
+  if (!registerCallbacks(instrumentation_ref, capsule)) {
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    releaseTool(instrumentation_ref);
+    PyErr_Restore(type, value, traceback);
+    return nullptr;
+  }
+  return capsule.release();
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "%s", e.what());
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// stopAutoInstrumentation
+//--------------------------------------------------------------------------------------------------
+bool stopAutoInstrumentation(PyObject* auto_instrumentation) noexcept {
+  auto& instrumentation = getAutoInstrumentation(auto_instrumentation);
+  auto result = releaseTool(instrumentation);
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+  drainActiveCalls(instrumentation);
+  PyErr_Restore(type, value, traceback);
+  return result;
+}
+}  // namespace python_bridge_tracer
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Python.h>
+
+namespace python_bridge_tracer {
+/**
+ * Start tracing calls to python functions with sys.monitoring (PEP 669).
+ *
+ * Each call to a function whose qualified name (its module's __name__ followed
+ * by the function's __qualname__) is one of the given names is traced with an
+ * active span named after it. Monitoring is disabled for the code of every
+ * other function the first time it runs, so untraced functions only pay for
+ * a single callback.
+ *
+ * Generator and coroutine functions aren't traced since their frames are
+ * suspended and resumed.
+ *
+ * The instrumentation only borrows the tracer, which must stop it before it's
+ * destroyed. Events disabled for the tool id by an earlier instrumentation
+ * stay disabled until sys.monitoring.restart_events() is called.
+ * @param tracer the python tracer to start spans with
+ * @param qualified_names an iterable of the qualified names to trace
+ * @param tool_id the sys.monitoring tool id to use
+ * @return an object that stops the instrumentation when passed to
+ * stopAutoInstrumentation
+ */
+PyObject* startAutoInstrumentation(PyObject* tracer, PyObject* qualified_names,
+                                   int tool_id) noexcept;
+
+/**
+ * Stop tracing function calls and release the sys.monitoring tool id. Calls
+ * still in progress have their spans finished.
+ * @param auto_instrumentation the object returned by startAutoInstrumentation
+ * @return true if successful
+ */
+bool stopAutoInstrumentation(PyObject* auto_instrumentation) noexcept;
+} // namespace python_bridge_tracer
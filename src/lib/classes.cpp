@@ -1,6 +1,10 @@
 #include "python_bridge_tracer/module.h"
 
+#include "logging_filter.h"
+#include "noop_span.h"
+#include "opentracing_module.h"
 #include "tracer.h"
+#include "traced.h"
 #include "span_context.h"
 #include "span.h"
 
@@ -11,6 +15,9 @@ namespace python_bridge_tracer {
 bool setupClasses(PyObject* module,
     const std::vector<PyMethodDef>& tracer_extension_methods,
     const std::vector<PyGetSetDef>& tracer_extension_getsets) noexcept {
+  if (!setupScopeAttributes(module)) {
+    return false;
+  }
   if (!setupTracerClass(module, tracer_extension_methods,
                         tracer_extension_getsets)) {
     return false;
@@ -18,6 +25,15 @@ bool setupClasses(PyObject* module,
   if (!setupSpanContextClass(module)) {
     return false;
   }
+  if (!setupLoggingFilterClass(module)) {
+    return false;
+  }
+  if (!setupTracedClasses(module)) {
+    return false;
+  }
+  if (!setupNoopSpanClasses(module)) {
+    return false;
+  }
   return setupSpanClass(module);
 }
 } // namespace python_bridge_tracer
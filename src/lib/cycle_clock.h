@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace python_bridge_tracer {
+/**
+ * @return the CPU's timestamp counter where available, otherwise the steady
+ * clock in nanoseconds
+ */
+inline uint64_t readCycleCounter() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+#endif
+}
+
+/**
+ * Converts cycle counter ticks to nanoseconds by comparing the counter's
+ * progress with the steady clock's since construction.
+ */
+class CycleClockCalibration {
+ public:
+  CycleClockCalibration() noexcept
+      : start_ticks_{readCycleCounter()},
+        start_time_{std::chrono::steady_clock::now()} {}
+
+  /**
+   * @return the number of nanoseconds per tick measured so far
+   */
+  double getNanosecondsPerTick() const noexcept {
+    auto ticks = readCycleCounter() - start_ticks_;
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start_time_)
+                           .count();
+    if (ticks == 0 || nanoseconds <= 0) {
+      return 1.0;
+    }
+    return static_cast<double>(nanoseconds) / static_cast<double>(ticks);
+  }
+
+ private:
+  uint64_t start_ticks_;
+  std::chrono::steady_clock::time_point start_time_;
+};
+} // namespace python_bridge_tracer
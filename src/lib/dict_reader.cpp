@@ -9,8 +9,8 @@ namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
-DictReader:: DictReader(PyObject* dict) noexcept
-  : dict_{dict} {}
+DictReader:: DictReader(PyObject* dict, const KeyPrefixFilter& key_filter) noexcept
+  : dict_{dict}, key_filter_{key_filter} {}
 
 //--------------------------------------------------------------------------------------------------
 // LookupKey
@@ -41,6 +41,9 @@ opentracing::expected<void> DictReader::ForeachKey(Callback callback) const {
   PyObject* value;
   Py_ssize_t position = 0;
   while (PyDict_Next(dict_, &position, &key, &value) == 1) {
+    if (!key_filter_.matches(key)) {
+      continue;
+    }
     PythonStringWrapper key_str{key};
     if (key_str.error()) {
       return opentracing::make_unexpected(python_error);
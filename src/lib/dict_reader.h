@@ -2,6 +2,7 @@
 
 #include <Python.h>
 
+#include "key_prefix_filter.h"
 #include "python_bridge_tracer/python_string_wrapper.h"
 
 #include <opentracing/propagation.h>
@@ -15,7 +16,11 @@ class DictReader final : public opentracing::HTTPHeadersReader {
   using Callback = std::function<opentracing::expected<void>(
       opentracing::string_view, opentracing::string_view)>;
 
-  explicit DictReader(PyObject* dict) noexcept;
+  /**
+   * @param dict the python carrier
+   * @param key_filter filter applied to the keys visited by ForeachKey
+   */
+  DictReader(PyObject* dict, const KeyPrefixFilter& key_filter) noexcept;
 
   // opentracing::TextMapReader
   opentracing::expected<opentracing::string_view> LookupKey(opentracing::string_view key) const override;
@@ -24,6 +29,7 @@ class DictReader final : public opentracing::HTTPHeadersReader {
 
  private:
   PyObject* dict_;
+  const KeyPrefixFilter& key_filter_;
   mutable PythonStringWrapper lookup_value_;
 };
 } // namespace python_bridge_tracer
@@ -7,7 +7,8 @@ namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
-DictWriter::DictWriter(PyObject* dict) noexcept : dict_{dict} {}
+DictWriter::DictWriter(PyObject* dict, KeyValues* key_values) noexcept
+    : dict_{dict}, key_values_{key_values} {}
 
 //--------------------------------------------------------------------------------------------------
 // Set
@@ -28,6 +29,9 @@ opentracing::expected<void> DictWriter::Set(
   if (PyDict_SetItem(dict_, py_key, py_value) != 0) {
     return opentracing::make_unexpected(python_error);
   }
+  if (key_values_ != nullptr) {
+    key_values_->emplace_back(std::move(py_key), std::move(py_value));
+  }
   return {};
 }
 } // namespace python_bridge_tracer
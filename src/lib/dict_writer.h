@@ -1,7 +1,12 @@
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include <Python.h>
 
+#include "python_bridge_tracer/python_object_wrapper.h"
+
 #include <opentracing/propagation.h>
 
 namespace python_bridge_tracer {
@@ -10,7 +15,14 @@ namespace python_bridge_tracer {
  */
 class DictWriter final : public opentracing::HTTPHeadersWriter {
  public:
-   explicit DictWriter(PyObject* dict) noexcept;
+   using KeyValues =
+       std::vector<std::pair<PythonObjectWrapper, PythonObjectWrapper>>;
+
+   /**
+    * @param dict the python dictionary to write to
+    * @param key_values if non-null, records the python key-values written
+    */
+   explicit DictWriter(PyObject* dict, KeyValues* key_values = nullptr) noexcept;
 
   // opentracing::TextMapWriter
    opentracing::expected<void> Set(
@@ -19,5 +31,6 @@ class DictWriter final : public opentracing::HTTPHeadersWriter {
 
   private:
    PyObject* dict_;
+   KeyValues* key_values_;
 };
 } // namespace python_bridge_tracer
@@ -0,0 +1,153 @@
+#include "export_queue.h"
+
+namespace python_bridge_tracer {
+// How long the worker sleeps before checking the queue again if no producer
+// wakes it.
+static const std::chrono::milliseconds WorkerPollInterval{100};
+
+//--------------------------------------------------------------------------------------------------
+// roundUpToPowerOfTwo
+//--------------------------------------------------------------------------------------------------
+static size_t roundUpToPowerOfTwo(size_t value) noexcept {
+  size_t result = 2;
+  while (result < value) {
+    result *= 2;
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+ExportQueue::ExportQueue(size_t capacity)
+    : cells_(roundUpToPowerOfTwo(capacity)),
+      mask_{cells_.size() - 1},
+      enqueue_position_{0},
+      dequeue_position_{0} {
+  for (size_t i = 0; i < cells_.size(); ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  worker_ = std::thread{&ExportQueue::run, this};
+}
+
+//--------------------------------------------------------------------------------------------------
+// destructor
+//--------------------------------------------------------------------------------------------------
+ExportQueue::~ExportQueue() noexcept {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    is_stopping_ = true;
+  }
+  worker_condition_.notify_one();
+  worker_.join();
+}
+
+//--------------------------------------------------------------------------------------------------
+// push
+//--------------------------------------------------------------------------------------------------
+bool ExportQueue::push(
+    std::shared_ptr<opentracing::Span> span,
+    opentracing::FinishSpanOptions&& finish_span_options) noexcept {
+  Cell* cell;
+  auto position = enqueue_position_.load(std::memory_order_relaxed);
+  while (true) {
+    cell = &cells_[position & mask_];
+    auto sequence = cell->sequence.load(std::memory_order_acquire);
+    auto difference =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+    if (difference == 0) {
+      if (enqueue_position_.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      num_overflowed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->span = std::move(span);
+  cell->finish_span_options = std::move(finish_span_options);
+  cell->sequence.store(position + 1, std::memory_order_release);
+  num_pushed_.fetch_add(1, std::memory_order_relaxed);
+
+  // Pairs with the fence in run so that either the worker sees the new span or
+  // we see that it's waiting.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_worker_waiting_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    worker_condition_.notify_one();
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// pop
+//--------------------------------------------------------------------------------------------------
+bool ExportQueue::pop(
+    std::shared_ptr<opentracing::Span>& span,
+    opentracing::FinishSpanOptions& finish_span_options) noexcept {
+  auto& cell = cells_[dequeue_position_ & mask_];
+  auto sequence = cell.sequence.load(std::memory_order_acquire);
+  if (sequence != dequeue_position_ + 1) {
+    return false;
+  }
+  span = std::move(cell.span);
+  finish_span_options = std::move(cell.finish_span_options);
+  cell.sequence.store(dequeue_position_ + mask_ + 1,
+                      std::memory_order_release);
+  ++dequeue_position_;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// flush
+//--------------------------------------------------------------------------------------------------
+bool ExportQueue::flush(std::chrono::microseconds timeout) noexcept {
+  auto target = num_pushed();
+  auto is_flushed = [this, target] { return num_finished() >= target; };
+  std::unique_lock<std::mutex> lock{mutex_};
+  ++num_flush_waiters_;
+  worker_condition_.notify_one();
+  bool result;
+  if (timeout == std::chrono::microseconds::zero()) {
+    flush_condition_.wait(lock, is_flushed);
+    result = true;
+  } else {
+    result = flush_condition_.wait_for(lock, timeout, is_flushed);
+  }
+  --num_flush_waiters_;
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// run
+//--------------------------------------------------------------------------------------------------
+void ExportQueue::run() noexcept {
+  std::shared_ptr<opentracing::Span> span;
+  opentracing::FinishSpanOptions finish_span_options;
+  while (true) {
+    while (pop(span, finish_span_options)) {
+      span->FinishWithOptions(finish_span_options);
+      span.reset();
+      num_finished_.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (num_flush_waiters_ > 0) {
+      flush_condition_.notify_all();
+    }
+    if (is_stopping_) {
+      return;
+    }
+    is_worker_waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto sequence =
+        cells_[dequeue_position_ & mask_].sequence.load(std::memory_order_acquire);
+    if (sequence != dequeue_position_ + 1) {
+      worker_condition_.wait_for(lock, WorkerPollInterval);
+    }
+    is_worker_waiting_.store(false, std::memory_order_relaxed);
+  }
+}
+} // namespace python_bridge_tracer
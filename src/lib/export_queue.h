@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "opentracing/span.h"
+
+namespace python_bridge_tracer {
+/**
+ * Finishes spans on a native worker thread so that Span.finish doesn't wait
+ * on the vendor tracer.
+ *
+ * Producers add spans to a bounded lock-free queue (based on Dmitry Vyukov's
+ * bounded MPMC queue). If the queue is full, push fails and the caller
+ * finishes the span itself. The worker never touches python objects and so
+ * runs without the GIL.
+ */
+class ExportQueue {
+ public:
+  /**
+   * @param capacity the maximum number of spans waiting to be finished. It's
+   * rounded up to a power of two.
+   */
+  explicit ExportQueue(size_t capacity);
+
+  ExportQueue(const ExportQueue&) = delete;
+  ExportQueue& operator=(const ExportQueue&) = delete;
+
+  ~ExportQueue() noexcept;
+
+  /**
+   * Queue a span to be finished by the worker.
+   * @param span the span to finish
+   * @param finish_span_options the options to finish the span with. The
+   * finish timestamp should already be set. They're left unchanged if the
+   * span isn't queued.
+   * @return false if the queue was full and the span wasn't queued
+   */
+  bool push(std::shared_ptr<opentracing::Span> span,
+            opentracing::FinishSpanOptions&& finish_span_options) noexcept;
+
+  /**
+   * Wait until every span queued before the call has been finished.
+   * @param timeout the maximum time to wait or zero to wait indefinitely
+   * @return true if the queued spans were finished before the timeout
+   */
+  bool flush(std::chrono::microseconds timeout) noexcept;
+
+  /**
+   * @return the capacity of the queue
+   */
+  size_t capacity() const noexcept { return cells_.size(); }
+
+  /**
+   * @return the number of spans queued
+   */
+  uint64_t num_pushed() const noexcept {
+    return num_pushed_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return the number of spans finished by the worker
+   */
+  uint64_t num_finished() const noexcept {
+    return num_finished_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return the number of spans that weren't queued because the queue was
+   * full
+   */
+  uint64_t num_overflowed() const noexcept {
+    return num_overflowed_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    std::shared_ptr<opentracing::Span> span;
+    opentracing::FinishSpanOptions finish_span_options;
+  };
+
+  std::vector<Cell> cells_;
+  size_t mask_;
+
+  std::atomic<size_t> enqueue_position_;
+  // Only accessed by the worker.
+  size_t dequeue_position_;
+
+  std::atomic<uint64_t> num_pushed_{0};
+  std::atomic<uint64_t> num_finished_{0};
+  std::atomic<uint64_t> num_overflowed_{0};
+
+  std::mutex mutex_;
+  std::condition_variable worker_condition_;
+  std::condition_variable flush_condition_;
+  std::atomic<bool> is_worker_waiting_{false};
+  int num_flush_waiters_{0};
+  bool is_stopping_{false};
+  std::thread worker_;
+
+  bool pop(std::shared_ptr<opentracing::Span>& span,
+           opentracing::FinishSpanOptions& finish_span_options) noexcept;
+
+  void run() noexcept;
+};
+} // namespace python_bridge_tracer
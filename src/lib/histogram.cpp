@@ -0,0 +1,121 @@
+#include "histogram.h"
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+namespace python_bridge_tracer {
+const int LogLinearHistogram::SubBucketBits;
+const size_t LogLinearHistogram::NumBuckets;
+
+//--------------------------------------------------------------------------------------------------
+// getBucketMidpoint
+//--------------------------------------------------------------------------------------------------
+static double getBucketMidpoint(size_t index) noexcept {
+  auto lower_bound = LogLinearHistogram::getBucketLowerBound(index);
+  if (index + 1 == LogLinearHistogram::NumBuckets) {
+    return static_cast<double>(lower_bound);
+  }
+  auto upper_bound = LogLinearHistogram::getBucketLowerBound(index + 1);
+  return (static_cast<double>(lower_bound) + static_cast<double>(upper_bound - 1)) / 2;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getQuantile
+//--------------------------------------------------------------------------------------------------
+double HistogramSnapshot::getQuantile(double quantile) const noexcept {
+  if (count == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(quantile * static_cast<double>(count - 1));
+  uint64_t num_seen = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    num_seen += counts[i];
+    if (num_seen > rank) {
+      return getBucketMidpoint(i);
+    }
+  }
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getMax
+//--------------------------------------------------------------------------------------------------
+uint64_t HistogramSnapshot::getMax() const noexcept {
+  for (auto i = counts.size(); i-- > 0;) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    if (i + 1 == counts.size()) {
+      return UINT64_MAX;
+    }
+    return LogLinearHistogram::getBucketLowerBound(i + 1) - 1;
+  }
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// toPyDict
+//--------------------------------------------------------------------------------------------------
+PyObject* HistogramSnapshot::toPyDict(double scale) const noexcept {
+  auto mean = count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+  return Py_BuildValue("{s:K,s:d,s:d,s:d,s:d,s:d}", "count",
+                       static_cast<unsigned long long>(count), "mean",
+                       mean * scale, "p50", getQuantile(0.5) * scale, "p90",
+                       getQuantile(0.9) * scale, "p99",
+                       getQuantile(0.99) * scale, "max",
+                       static_cast<double>(getMax()) * scale);
+}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+LogLinearHistogram::LogLinearHistogram() noexcept {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  sum_.store(0, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+// takeSnapshot
+//--------------------------------------------------------------------------------------------------
+void LogLinearHistogram::takeSnapshot(HistogramSnapshot& snapshot,
+                                      bool reset) noexcept {
+  snapshot.counts.resize(NumBuckets);
+  snapshot.count = 0;
+  for (size_t i = 0; i < NumBuckets; ++i) {
+    auto count = reset ? buckets_[i].exchange(0, std::memory_order_relaxed)
+                       : buckets_[i].load(std::memory_order_relaxed);
+    snapshot.counts[i] = count;
+    snapshot.count += count;
+  }
+  snapshot.sum = reset ? sum_.exchange(0, std::memory_order_relaxed)
+                       : sum_.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getBucketIndex
+//--------------------------------------------------------------------------------------------------
+size_t LogLinearHistogram::getBucketIndex(uint64_t value) noexcept {
+  const uint64_t sub_bucket_count = 1 << SubBucketBits;
+  if (value < sub_bucket_count) {
+    return static_cast<size_t>(value);
+  }
+  auto exponent = 63 - __builtin_clzll(value);
+  auto sub_bucket = (value >> (exponent - SubBucketBits)) - sub_bucket_count;
+  return (static_cast<size_t>(exponent - SubBucketBits + 1) << SubBucketBits) +
+         static_cast<size_t>(sub_bucket);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getBucketLowerBound
+//--------------------------------------------------------------------------------------------------
+uint64_t LogLinearHistogram::getBucketLowerBound(size_t index) noexcept {
+  const uint64_t sub_bucket_count = 1 << SubBucketBits;
+  if (index < sub_bucket_count) {
+    return index;
+  }
+  auto exponent = static_cast<int>(index >> SubBucketBits) + SubBucketBits - 1;
+  auto sub_bucket = static_cast<uint64_t>(index & (sub_bucket_count - 1));
+  return (sub_bucket_count + sub_bucket) << (exponent - SubBucketBits);
+}
+} // namespace python_bridge_tracer
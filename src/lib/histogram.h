@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Python.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace python_bridge_tracer {
+/**
+ * A copy of a histogram's counts.
+ */
+struct HistogramSnapshot {
+  std::vector<uint64_t> counts;
+  uint64_t count = 0;
+  uint64_t sum = 0;
+
+  /**
+   * @param quantile a value between 0 and 1
+   * @return an estimate of the quantile's value
+   */
+  double getQuantile(double quantile) const noexcept;
+
+  /**
+   * @return an estimate of the largest recorded value
+   */
+  uint64_t getMax() const noexcept;
+
+  /**
+   * Summarize the snapshot as a python dictionary with the keys count, mean,
+   * p50, p90, p99 and max.
+   * @param scale a factor applied to the recorded values
+   * @return the summary
+   */
+  PyObject* toPyDict(double scale = 1.0) const noexcept;
+};
+
+/**
+ * A lock-free histogram of unsigned integers with log-linear buckets: each
+ * power of two is split into 2^SubBucketBits linear buckets, so values are
+ * resolved to within about 6% across the full 64-bit range.
+ */
+class LogLinearHistogram {
+ public:
+  static const int SubBucketBits = 4;
+  static const size_t NumBuckets = (64 - SubBucketBits + 1) << SubBucketBits;
+
+  LogLinearHistogram() noexcept;
+
+  LogLinearHistogram(const LogLinearHistogram&) = delete;
+  LogLinearHistogram& operator=(const LogLinearHistogram&) = delete;
+
+  /**
+   * Record a value.
+   * @param value the value to record
+   */
+  void record(uint64_t value) noexcept {
+    buckets_[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /**
+   * Copy the histogram's counts.
+   * @param snapshot the snapshot to copy into
+   * @param reset if true, the counts are atomically taken out of the
+   * histogram so that each recorded value appears in exactly one snapshot
+   */
+  void takeSnapshot(HistogramSnapshot& snapshot, bool reset) noexcept;
+
+  /**
+   * @param value a value
+   * @return the index of the bucket value is counted in
+   */
+  static size_t getBucketIndex(uint64_t value) noexcept;
+
+  /**
+   * @param index a bucket index
+   * @return the smallest value counted in the bucket
+   */
+  static uint64_t getBucketLowerBound(size_t index) noexcept;
+
+ private:
+  std::array<std::atomic<uint64_t>, NumBuckets> buckets_;
+  std::atomic<uint64_t> sum_;
+};
+} // namespace python_bridge_tracer
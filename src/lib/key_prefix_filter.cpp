@@ -0,0 +1,113 @@
+#include "key_prefix_filter.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+#include "python_bridge_tracer/python_string_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+#include "python_bridge_tracer/version.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// copyUnicodePrefix
+//--------------------------------------------------------------------------------------------------
+// Copies up to size leading characters of a unicode string without encoding
+// the rest of it. Returns the number of characters copied or -1 on error.
+static Py_ssize_t copyUnicodePrefix(PyObject* obj, wchar_t* buffer,
+                                    Py_ssize_t size) noexcept {
+#ifdef PYTHON_BRIDGE_TRACER_PY3
+  return PyUnicode_AsWideChar(obj, buffer, size);
+#else
+  return PyUnicode_AsWideChar(reinterpret_cast<PyUnicodeObject*>(obj), buffer,
+                              size);
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// toLower
+//--------------------------------------------------------------------------------------------------
+template <class Char>
+static Char toLower(Char c) noexcept {
+  if (c >= 'A' && c <= 'Z') {
+    return static_cast<Char>(c - 'A' + 'a');
+  }
+  return c;
+}
+
+//--------------------------------------------------------------------------------------------------
+// matchesPrefix
+//--------------------------------------------------------------------------------------------------
+template <class Char>
+static bool matchesPrefix(const std::vector<std::string>& prefixes,
+                          const Char* data, size_t length) noexcept {
+  for (auto& prefix : prefixes) {
+    if (prefix.size() > length) {
+      continue;
+    }
+    auto mismatch =
+        std::mismatch(prefix.begin(), prefix.end(), data,
+                      [](char lhs, Char rhs) {
+                        return static_cast<Char>(
+                                   static_cast<unsigned char>(lhs)) ==
+                               toLower(rhs);
+                      });
+    if (mismatch.first == prefix.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+KeyPrefixFilter::KeyPrefixFilter(std::vector<std::string> prefixes) noexcept
+    : prefixes_{std::move(prefixes)} {
+  for (auto& prefix : prefixes_) {
+    for (auto& c : prefix) {
+      c = toLower(c);
+    }
+    max_prefix_length_ = std::max(max_prefix_length_, prefix.size());
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// matches
+//--------------------------------------------------------------------------------------------------
+bool KeyPrefixFilter::matches(PyObject* key) const noexcept {
+  if (prefixes_.empty()) {
+    return true;
+  }
+  if (PyBytes_Check(key) == 1) {
+    char* data;
+    Py_ssize_t length;
+    if (PyBytes_AsStringAndSize(key, &data, &length) == -1) {
+      PyErr_Clear();
+      return true;
+    }
+    return matchesPrefix(prefixes_, data, static_cast<size_t>(length));
+  }
+  if (PyUnicode_Check(key) == 0) {
+    return true;
+  }
+  std::array<wchar_t, 64> buffer;
+  if (max_prefix_length_ > buffer.size()) {
+    // Uncommonly long prefixes are matched against the full encoding.
+    PythonStringWrapper key_str{key};
+    if (key_str.error()) {
+      PyErr_Clear();
+      return true;
+    }
+    auto key_view = static_cast<opentracing::string_view>(key_str);
+    return matchesPrefix(prefixes_, key_view.data(), key_view.size());
+  }
+  auto length = copyUnicodePrefix(key, buffer.data(),
+                                  static_cast<Py_ssize_t>(max_prefix_length_));
+  if (length == -1) {
+    PyErr_Clear();
+    return true;
+  }
+  return matchesPrefix(prefixes_, buffer.data(), static_cast<size_t>(length));
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Python.h>
+
+namespace python_bridge_tracer {
+/**
+ * Matches carrier keys against the propagation key prefixes declared by a
+ * tracer so that irrelevant keys can be skipped before they're encoded.
+ */
+class KeyPrefixFilter {
+ public:
+  KeyPrefixFilter() noexcept = default;
+
+  explicit KeyPrefixFilter(std::vector<std::string> prefixes) noexcept;
+
+  /**
+   * @param key a python string or bytes carrier key
+   * @return true if the key starts with one of the prefixes (ignoring case),
+   * if no prefixes were declared, or if the key isn't a string and should be
+   * left for the regular conversion to reject.
+   */
+  bool matches(PyObject* key) const noexcept;
+
+ private:
+  std::vector<std::string> prefixes_;
+  size_t max_prefix_length_{0};
+};
+} // namespace python_bridge_tracer
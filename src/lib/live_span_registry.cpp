@@ -0,0 +1,129 @@
+#include "live_span_registry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// getShardIndex
+//--------------------------------------------------------------------------------------------------
+size_t LiveSpanRegistry::getShardIndex() noexcept {
+  static std::atomic<size_t> next_shard_index{0};
+  thread_local size_t shard_index =
+      next_shard_index.fetch_add(1, std::memory_order_relaxed) % NumShards;
+  return shard_index;
+}
+
+//--------------------------------------------------------------------------------------------------
+// add
+//--------------------------------------------------------------------------------------------------
+void LiveSpanRegistry::add(
+    Node& node, std::chrono::steady_clock::time_point start_timestamp,
+    opentracing::string_view operation_name) noexcept try {
+  node.operation_name.assign(operation_name.data(), operation_name.size());
+  node.start_timestamp = start_timestamp;
+  auto& shard = shards_[getShardIndex()];
+  std::lock_guard<ObjectMutex> lock_guard{shard.mutex};
+  node.previous = nullptr;
+  node.next = shard.head;
+  if (shard.head != nullptr) {
+    shard.head->previous = &node;
+  }
+  shard.head = &node;
+  node.shard = &shard;
+} catch (const std::exception& /*e*/) {
+  // Leave the span out of the registry if its name can't be copied.
+}
+
+//--------------------------------------------------------------------------------------------------
+// remove
+//--------------------------------------------------------------------------------------------------
+void LiveSpanRegistry::remove(Node& node) noexcept {
+  auto shard = node.shard;
+  if (shard == nullptr) {
+    return;
+  }
+  std::lock_guard<ObjectMutex> lock_guard{shard->mutex};
+  if (node.previous != nullptr) {
+    node.previous->next = node.next;
+  } else {
+    shard->head = node.next;
+  }
+  if (node.next != nullptr) {
+    node.next->previous = node.previous;
+  }
+  node.previous = nullptr;
+  node.next = nullptr;
+  node.shard = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// setOperationName
+//--------------------------------------------------------------------------------------------------
+void LiveSpanRegistry::setOperationName(
+    Node& node, opentracing::string_view operation_name) noexcept try {
+  auto shard = node.shard;
+  if (shard == nullptr) {
+    return;
+  }
+  std::lock_guard<ObjectMutex> lock_guard{shard->mutex};
+  node.operation_name.assign(operation_name.data(), operation_name.size());
+} catch (const std::exception& /*e*/) {
+  // Keep reporting the span under its old name.
+}
+
+//--------------------------------------------------------------------------------------------------
+// toPyList
+//--------------------------------------------------------------------------------------------------
+PyObject* LiveSpanRegistry::toPyList(
+    std::chrono::steady_clock::duration older_than) const noexcept try {
+  auto now = std::chrono::steady_clock::now();
+  std::vector<std::pair<std::chrono::steady_clock::duration, std::string>>
+      spans;
+  for (auto& shard : shards_) {
+    std::lock_guard<ObjectMutex> lock_guard{shard.mutex};
+    for (auto node = shard.head; node != nullptr; node = node->next) {
+      auto age = now - node->start_timestamp;
+      if (age >= older_than) {
+        spans.emplace_back(age, node->operation_name);
+      }
+    }
+  }
+  std::sort(spans.begin(), spans.end(),
+            [](const std::pair<std::chrono::steady_clock::duration,
+                               std::string>& lhs,
+               const std::pair<std::chrono::steady_clock::duration,
+                               std::string>& rhs) {
+              return lhs.first > rhs.first;
+            });
+  PythonObjectWrapper result = PyList_New(static_cast<Py_ssize_t>(spans.size()));
+  if (result.error()) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < spans.size(); ++i) {
+    PythonObjectWrapper operation_name = toPyString(spans[i].second);
+    if (operation_name.error()) {
+      return nullptr;
+    }
+    auto age = std::chrono::duration<double>{spans[i].first}.count();
+    PyObject* span = Py_BuildValue("{s:O,s:d}", "operation_name",
+                                   static_cast<PyObject*>(operation_name),
+                                   "age", age);
+    if (span == nullptr) {
+      return nullptr;
+    }
+    // PyList_SetItem steals the reference.
+    PyList_SetItem(result, static_cast<Py_ssize_t>(i), span);
+  }
+  return result.release();
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to list live spans: %s", e.what());
+  return nullptr;
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Python.h>
+
+#include <array>
+#include <chrono>
+#include <string>
+
+#include "object_mutex.h"
+
+#include "opentracing/string_view.h"
+
+namespace python_bridge_tracer {
+/**
+ * Keeps track of the spans that were started but haven't finished yet so that
+ * spans that instrumentation forgot to finish can be found.
+ *
+ * Spans are linked into an intrusive list through a node they own, so
+ * registering a span doesn't allocate beyond copying its operation name. Each
+ * thread adds its spans to its own shard; with the GIL the shards aren't
+ * locked at all, and without it a thread only contends on its shard's lock
+ * when a span is finished on another thread or the spans are reported.
+ */
+class LiveSpanRegistry {
+ private:
+  struct Shard;
+
+ public:
+  /**
+   * The part of a span that links it into the registry.
+   */
+  struct Node {
+    Node* previous{nullptr};
+    Node* next{nullptr};
+    Shard* shard{nullptr};
+    std::chrono::steady_clock::time_point start_timestamp;
+    std::string operation_name;
+  };
+
+  LiveSpanRegistry() noexcept = default;
+
+  LiveSpanRegistry(const LiveSpanRegistry&) = delete;
+  LiveSpanRegistry& operator=(const LiveSpanRegistry&) = delete;
+
+  /**
+   * Register a span. The span is left out of the registry if its operation
+   * name can't be copied.
+   * @param node the span's node, which must not already be registered
+   * @param start_timestamp the span's start time
+   * @param operation_name the span's operation name
+   */
+  void add(Node& node, std::chrono::steady_clock::time_point start_timestamp,
+           opentracing::string_view operation_name) noexcept;
+
+  /**
+   * Unregister a span if it's registered.
+   * @param node the span's node
+   */
+  void remove(Node& node) noexcept;
+
+  /**
+   * Update the operation name of a registered span.
+   * @param node the span's node
+   * @param operation_name the span's new operation name
+   */
+  void setOperationName(Node& node,
+                        opentracing::string_view operation_name) noexcept;
+
+  /**
+   * @param older_than the minimum age of the spans reported
+   * @return a list of dictionaries with the operation name and age in seconds
+   * of each registered span at least older_than old, oldest first
+   */
+  PyObject* toPyList(std::chrono::steady_clock::duration older_than) const
+      noexcept;
+
+ private:
+  static const size_t NumShards = 16;
+
+  struct Shard {
+    mutable ObjectMutex mutex;
+    Node* head{nullptr};
+  };
+
+  std::array<Shard, NumShards> shards_;
+
+  static size_t getShardIndex() noexcept;
+};
+} // namespace python_bridge_tracer
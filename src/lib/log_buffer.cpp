@@ -0,0 +1,70 @@
+#include "log_buffer.h"
+
+#include <algorithm>
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// add
+//--------------------------------------------------------------------------------------------------
+size_t LogBuffer::add(opentracing::LogRecord&& log_record, size_t num_bytes) {
+  // Count each record as at least a byte so that, when only max_bytes_ is
+  // set, empty records can't grow the ring without bound.
+  num_bytes = std::max<size_t>(num_bytes, 1);
+  if (max_bytes_ > 0 && num_bytes > max_bytes_) {
+    ++num_dropped_;
+    return 1;
+  }
+  size_t num_dropped = 0;
+  while (num_records_ > 0 &&
+         ((max_records_ > 0 && num_records_ == max_records_) ||
+          (max_bytes_ > 0 && num_bytes_ + num_bytes > max_bytes_))) {
+    dropFirst();
+    ++num_dropped;
+  }
+  if (num_records_ < slots_.size()) {
+    auto& slot = slots_[(first_ + num_records_) % slots_.size()];
+    slot.first = std::move(log_record);
+    slot.second = num_bytes;
+  } else {
+    // Only reached while the ring is still growing; make it contiguous so
+    // that the new slot goes at the end.
+    if (slots_.empty() && max_records_ > 0) {
+      slots_.reserve(max_records_);
+    }
+    std::rotate(slots_.begin(), slots_.begin() + first_, slots_.end());
+    first_ = 0;
+    slots_.emplace_back(std::move(log_record), num_bytes);
+  }
+  ++num_records_;
+  num_bytes_ += num_bytes;
+  return num_dropped;
+}
+
+//--------------------------------------------------------------------------------------------------
+// moveTo
+//--------------------------------------------------------------------------------------------------
+void LogBuffer::moveTo(std::vector<opentracing::LogRecord>& log_records) {
+  log_records.reserve(log_records.size() + num_records_);
+  for (size_t i = 0; i < num_records_; ++i) {
+    auto& slot = slots_[(first_ + i) % slots_.size()];
+    log_records.emplace_back(std::move(slot.first));
+    slot.first = opentracing::LogRecord{};
+  }
+  first_ = 0;
+  num_records_ = 0;
+  num_bytes_ = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// dropFirst
+//--------------------------------------------------------------------------------------------------
+void LogBuffer::dropFirst() noexcept {
+  auto& slot = slots_[first_];
+  // Release the record's strings now rather than when the slot is reused.
+  slot.first = opentracing::LogRecord{};
+  num_bytes_ -= slot.second;
+  first_ = (first_ + 1) % slots_.size();
+  --num_records_;
+  ++num_dropped_;
+}
+} // namespace python_bridge_tracer
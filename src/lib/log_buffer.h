@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "opentracing/span.h"
+
+namespace python_bridge_tracer {
+/**
+ * Holds the log records of a span in a ring that's bounded by the number of
+ * records and by their total size, so that a long-lived span that logs in a
+ * loop uses a predictable amount of memory.
+ *
+ * When a bound would be exceeded, the oldest records are dropped to make room
+ * for the newest; a record larger than the byte bound on its own is dropped
+ * instead. The ring's slots are allocated once, on the first record, and are
+ * reused after that.
+ */
+class LogBuffer {
+ public:
+  /**
+   * @param max_records the maximum number of records kept or zero for no
+   * limit
+   * @param max_bytes the maximum total size of the records kept or zero for
+   * no limit; each record counts as at least one byte, so this also bounds
+   * the number of records
+   */
+  LogBuffer(size_t max_records, size_t max_bytes) noexcept
+      : max_records_{max_records}, max_bytes_{max_bytes} {}
+
+  LogBuffer(const LogBuffer&) = delete;
+  LogBuffer& operator=(const LogBuffer&) = delete;
+
+  /**
+   * @return true if the buffer is bounded
+   */
+  bool bounded() const noexcept { return max_records_ > 0 || max_bytes_ > 0; }
+
+  /**
+   * @return the number of records dropped since the buffer was created
+   */
+  uint64_t num_dropped() const noexcept { return num_dropped_; }
+
+  /**
+   * Add a record, dropping older records if needed.
+   * @param log_record the record to add
+   * @param num_bytes the size of the record's keys and values
+   * @return the number of records dropped to add it
+   */
+  size_t add(opentracing::LogRecord&& log_record, size_t num_bytes);
+
+  /**
+   * Move the records kept, oldest first, to the end of a vector and empty the
+   * buffer.
+   * @param log_records the vector to append to
+   */
+  void moveTo(std::vector<opentracing::LogRecord>& log_records);
+
+ private:
+  size_t max_records_;
+  size_t max_bytes_;
+  std::vector<std::pair<opentracing::LogRecord, size_t>> slots_;
+  size_t first_{0};
+  size_t num_records_{0};
+  size_t num_bytes_{0};
+  uint64_t num_dropped_{0};
+
+  void dropFirst() noexcept;
+};
+} // namespace python_bridge_tracer
@@ -0,0 +1,207 @@
+#include "logging_filter.h"
+
+#include "python_bridge_tracer/module.h"
+
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "module_state.h"
+#include "object_mutex.h"
+#include "opentracing_module.h"
+#include "span.h"
+#include "tail_sampling_tracer.h"
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+#include "python_bridge_tracer/type.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// LoggingFilterObject
+//--------------------------------------------------------------------------------------------------
+namespace {
+struct LoggingFilterObject {
+  // clang-format off
+  PyObject_HEAD
+  PyObject* module;
+  PyObject* scope_manager;
+  PyObject* trace_id_attribute;
+  PyObject* span_id_attribute;
+
+  // The ids of the last active scope seen, so that records logged under the
+  // same scope only look up the active scope.
+  ObjectMutex mutex;
+  PyObject* last_scope;
+  PyObject* last_trace_id;
+  PyObject* last_span_id;
+  // clang-format on
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// deallocLoggingFilter
+//--------------------------------------------------------------------------------------------------
+static void deallocLoggingFilter(LoggingFilterObject* self) noexcept {
+  Py_XDECREF(self->module);
+  Py_DECREF(self->scope_manager);
+  Py_DECREF(self->trace_id_attribute);
+  Py_DECREF(self->span_id_attribute);
+  Py_XDECREF(self->last_scope);
+  Py_XDECREF(self->last_trace_id);
+  Py_XDECREF(self->last_span_id);
+  freeSelf(reinterpret_cast<PyObject*>(self));
+}
+
+//--------------------------------------------------------------------------------------------------
+// getScopeIds
+//--------------------------------------------------------------------------------------------------
+// is_final is set to false if the ids are provisional and so mustn't be
+// reused for later records.
+static bool getScopeIds(const ModuleState& module_state, PyObject* scope,
+                        PythonObjectWrapper& trace_id,
+                        PythonObjectWrapper& span_id, bool& is_final) noexcept {
+  is_final = true;
+  PythonObjectWrapper span;
+  if (scope != Py_None) {
+    span = PyObject_GetAttr(scope, module_state.span_attribute);
+    if (span.error()) {
+      return false;
+    }
+  }
+  if (scope != Py_None && isSpan(span)) {
+    auto span_context = getSpanContextFromSpan(span);
+    is_final = !hasProvisionalIds(span_context.span_context());
+    trace_id = span_context.getTraceId();
+    if (trace_id.error()) {
+      return false;
+    }
+    span_id = span_context.getSpanId();
+    return !span_id.error();
+  }
+  // Either no span is active or it wasn't created by a bridge tracer.
+  Py_INCREF(Py_None);
+  trace_id = Py_None;
+  Py_INCREF(Py_None);
+  span_id = Py_None;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// filter
+//--------------------------------------------------------------------------------------------------
+static PyObject* filter(LoggingFilterObject* self, PyObject* record) noexcept {
+  auto& module_state = getModuleState(self->module);
+  PythonObjectWrapper scope = getActiveScope(module_state, self->scope_manager);
+  if (scope.error()) {
+    return nullptr;
+  }
+  PythonObjectWrapper trace_id;
+  PythonObjectWrapper span_id;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{self->mutex};
+    if (self->last_scope == scope) {
+      Py_INCREF(self->last_trace_id);
+      trace_id = self->last_trace_id;
+      Py_INCREF(self->last_span_id);
+      span_id = self->last_span_id;
+    }
+  }
+  if (trace_id.error()) {
+    bool is_final;
+    if (!getScopeIds(module_state, scope, trace_id, span_id, is_final)) {
+      return nullptr;
+    }
+    // A scope's span never changes, so once its ids are final they can be
+    // reused for as long as the scope stays active.
+    if (is_final) {
+      Py_INCREF(scope);
+      Py_INCREF(trace_id);
+      Py_INCREF(span_id);
+      PyObject* last_scope = scope;
+      PyObject* last_trace_id = trace_id;
+      PyObject* last_span_id = span_id;
+      {
+        std::lock_guard<ObjectMutex> lock_guard{self->mutex};
+        std::swap(self->last_scope, last_scope);
+        std::swap(self->last_trace_id, last_trace_id);
+        std::swap(self->last_span_id, last_span_id);
+      }
+      // Released outside the lock since a scope's finalizer can run python
+      // code.
+      Py_XDECREF(last_scope);
+      Py_XDECREF(last_trace_id);
+      Py_XDECREF(last_span_id);
+    }
+  }
+  if (PyObject_SetAttr(record, self->trace_id_attribute, trace_id) != 0) {
+    return nullptr;
+  }
+  if (PyObject_SetAttr(record, self->span_id_attribute, span_id) != 0) {
+    return nullptr;
+  }
+  Py_RETURN_TRUE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeLoggingFilter
+//--------------------------------------------------------------------------------------------------
+PyObject* makeLoggingFilter(
+    PyObject* module, PyObject* scope_manager,
+    opentracing::string_view trace_id_attribute,
+    opentracing::string_view span_id_attribute) noexcept {
+  PythonObjectWrapper py_trace_id_attribute = toPyString(trace_id_attribute);
+  if (py_trace_id_attribute.error()) {
+    return nullptr;
+  }
+  PythonObjectWrapper py_span_id_attribute = toPyString(span_id_attribute);
+  if (py_span_id_attribute.error()) {
+    return nullptr;
+  }
+  auto result = newPythonObject<LoggingFilterObject>(
+      getModuleState(module).logging_filter_type);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  Py_XINCREF(module);
+  result->module = module;
+  Py_INCREF(scope_manager);
+  result->scope_manager = scope_manager;
+  result->trace_id_attribute = py_trace_id_attribute.release();
+  result->span_id_attribute = py_span_id_attribute.release();
+  new (&result->mutex) ObjectMutex{};
+  result->last_scope = nullptr;
+  result->last_trace_id = nullptr;
+  result->last_span_id = nullptr;
+  return reinterpret_cast<PyObject*>(result);
+}
+
+//--------------------------------------------------------------------------------------------------
+// LoggingFilterMethods
+//--------------------------------------------------------------------------------------------------
+static PyMethodDef LoggingFilterMethods[] = {
+    {"filter", reinterpret_cast<PyCFunction>(filter), METH_O,
+     PyDoc_STR("stamp the active span's ids onto a log record")},
+    {nullptr, nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// setupLoggingFilterClass
+//--------------------------------------------------------------------------------------------------
+bool setupLoggingFilterClass(PyObject* module) noexcept {
+  auto& module_state = getModuleState(module);
+  TypeDescription type_description;
+  type_description.name = PYTHON_BRIDGE_TRACER_MODULE "._LoggingFilter";
+  type_description.size = sizeof(LoggingFilterObject);
+  type_description.doc = toVoidPtr("CppBridgeLoggingFilter");
+  type_description.dealloc = toVoidPtr(deallocLoggingFilter);
+  type_description.methods = toVoidPtr(LoggingFilterMethods);
+  auto logging_filter_type = makeType<LoggingFilterObject>(type_description);
+  if (logging_filter_type == nullptr) {
+    return false;
+  }
+  Py_INCREF(logging_filter_type);
+  module_state.logging_filter_type = logging_filter_type;
+  auto rcode =
+      PyModule_AddObject(module, "_LoggingFilter", logging_filter_type);
+  return rcode == 0;
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Python.h>
+
+#include "opentracing/string_view.h"
+
+namespace python_bridge_tracer {
+/**
+ * Make a logging filter that stamps the ids of the active span onto log
+ * records.
+ * @param module the module whose class to use
+ * @param scope_manager the scope manager used to look up the active span
+ * @param trace_id_attribute the log record attribute to set the trace id on
+ * @param span_id_attribute the log record attribute to set the span id on
+ * @return the python logging filter object
+ */
+PyObject* makeLoggingFilter(PyObject* module, PyObject* scope_manager,
+                            opentracing::string_view trace_id_attribute,
+                            opentracing::string_view span_id_attribute) noexcept;
+
+/**
+ * Setup the python logging filter class
+ * @param module the module to add the class to
+ * @return true if succuessful
+ */
+bool setupLoggingFilterClass(PyObject* module) noexcept;
+} // namespace python_bridge_tracer
@@ -3,10 +3,29 @@
 
 #ifndef PYTHON_BRIDGE_TRACER_PY3
 
+#include "module_state.h"
+
 namespace python_bridge_tracer {
+PyObject* makeModule(const char* name, const char* doc, PyMethodDef* methods,
+                     int (*exec)(PyObject* module)) noexcept {
+  auto module = Py_InitModule3(name, methods, doc);
+  if (module == nullptr) {
+    return nullptr;
+  }
+  if (exec(module) != 0) {
+    return nullptr;
+  }
+  return module;
+}
+
 PyObject* makeModule(const char* name, const char* doc,
                      PyMethodDef* methods) noexcept {
-  return Py_InitModule3(name, methods, doc);
+  auto module = Py_InitModule3(name, methods, doc);
+  if (module == nullptr) {
+    return nullptr;
+  }
+  setSinglePhaseModule(module);
+  return module;
 }
 }  // namespace python_bridge_tracer
 
@@ -3,12 +3,117 @@
 
 #ifdef PYTHON_BRIDGE_TRACER_PY3
 
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+#include "module_state.h"
+
+// Py_mod_multiple_interpreters and Py_MOD_PER_INTERPRETER_GIL_SUPPORTED from
+// python 3.12. They're defined here since the module is compiled against older
+// headers.
+#define PYTHON_BRIDGE_TRACER_MOD_MULTIPLE_INTERPRETERS 3
+#define PYTHON_BRIDGE_TRACER_MOD_PER_INTERPRETER_GIL_SUPPORTED \
+  reinterpret_cast<void*>(2)
+
 namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// isRuntimeVersionAtLeast
+//--------------------------------------------------------------------------------------------------
+static bool isRuntimeVersionAtLeast(int major, int minor) noexcept {
+  int runtime_major = 0;
+  int runtime_minor = 0;
+  if (std::sscanf(Py_GetVersion(), "%d.%d", &runtime_major, &runtime_minor) !=
+      2) {
+    return false;
+  }
+  return runtime_major > major ||
+         (runtime_major == major && runtime_minor >= minor);
+}
+
+//--------------------------------------------------------------------------------------------------
+// traverseModule
+//--------------------------------------------------------------------------------------------------
+static int traverseModule(PyObject* module, visitproc visit,
+                          void* arg) noexcept {
+  return traverseModuleState(module, visit, arg);
+}
+
+//--------------------------------------------------------------------------------------------------
+// clearModule
+//--------------------------------------------------------------------------------------------------
+static int clearModule(PyObject* module) noexcept {
+  return clearModuleState(module);
+}
+
+//--------------------------------------------------------------------------------------------------
+// freeModule
+//--------------------------------------------------------------------------------------------------
+static void freeModule(void* module) noexcept {
+  clearModuleState(static_cast<PyObject*>(module));
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeModuleSlots
+//--------------------------------------------------------------------------------------------------
+static std::vector<PyModuleDef_Slot> makeModuleSlots(
+    int (*exec)(PyObject* module)) {
+  std::vector<PyModuleDef_Slot> result;
+  result.push_back({Py_mod_exec, reinterpret_cast<void*>(exec)});
+
+  // Interpreters before 3.12 reject slots they don't know about.
+  if (isRuntimeVersionAtLeast(3, 12)) {
+    result.push_back({PYTHON_BRIDGE_TRACER_MOD_MULTIPLE_INTERPRETERS,
+                      PYTHON_BRIDGE_TRACER_MOD_PER_INTERPRETER_GIL_SUPPORTED});
+  }
+#ifdef Py_GIL_DISABLED
+  // Otherwise, importing the module would re-enable the GIL.
+  result.push_back({Py_mod_gil, Py_MOD_GIL_NOT_USED});
+#endif
+  result.push_back({0, nullptr});
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeModule
+//--------------------------------------------------------------------------------------------------
+PyObject* makeModule(const char* name, const char* doc, PyMethodDef* methods,
+                     int (*exec)(PyObject* module)) noexcept try {
+  // Every interpreter that imports the module calls its init function, so the
+  // definition is built once and then shared.
+  static std::vector<PyModuleDef_Slot> module_slots = makeModuleSlots(exec);
+  static PyModuleDef module_definition = {PyModuleDef_HEAD_INIT,
+                                          name,
+                                          doc,
+                                          sizeof(ModuleState),
+                                          methods,
+                                          module_slots.data(),
+                                          traverseModule,
+                                          clearModule,
+                                          freeModule};
+  return PyModuleDef_Init(&module_definition);
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "%s", e.what());
+  return nullptr;
+}
+
 PyObject* makeModule(const char* name, const char* doc,
                      PyMethodDef* methods) noexcept {
-  static PyModuleDef module_definition = {PyModuleDef_HEAD_INIT, name, doc, -1,
-                                          methods};
-  return PyModule_Create(&module_definition);
+  static PyModuleDef module_definition = {PyModuleDef_HEAD_INIT,
+                                          name,
+                                          doc,
+                                          sizeof(ModuleState),
+                                          methods,
+                                          nullptr,
+                                          traverseModule,
+                                          clearModule,
+                                          freeModule};
+  auto module = PyModule_Create(&module_definition);
+  if (module == nullptr) {
+    return nullptr;
+  }
+  setSinglePhaseModule(module);
+  return module;
 }
 }  // namespace python_bridge_tracer
 
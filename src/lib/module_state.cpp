@@ -0,0 +1,99 @@
+#include "module_state.h"
+
+#include "python_bridge_tracer/version.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// findModuleState
+//--------------------------------------------------------------------------------------------------
+static ModuleState* findModuleState(PyObject* module) noexcept {
+#ifdef PYTHON_BRIDGE_TRACER_PY3
+  // The state isn't allocated if the module failed before being executed.
+  return static_cast<ModuleState*>(PyModule_GetState(module));
+#else
+  // Python 2 modules don't have state and are only loaded once.
+  (void)module;
+  static ModuleState module_state;
+  return &module_state;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// getModuleState
+//--------------------------------------------------------------------------------------------------
+ModuleState& getModuleState(PyObject* module) noexcept {
+  return *findModuleState(module);
+}
+
+//--------------------------------------------------------------------------------------------------
+// forEachModuleStateObject
+//--------------------------------------------------------------------------------------------------
+template <class F>
+static int forEachModuleStateObject(PyObject* module, F f) noexcept {
+  auto module_state_ptr = findModuleState(module);
+  if (module_state_ptr == nullptr) {
+    return 0;
+  }
+  auto& module_state = *module_state_ptr;
+  PyObject** objects[] = {&module_state.tracer_type,
+                          &module_state.span_type,
+                          &module_state.span_context_type,
+                          &module_state.noop_span_type,
+                          &module_state.noop_span_context_type,
+                          &module_state.noop_span_context,
+                          &module_state.logging_filter_type,
+                          &module_state.traced_type,
+                          &module_state.traced_coroutine_type,
+                          &module_state.method_type,
+                          &module_state.active_attribute,
+                          &module_state.span_attribute};
+  for (auto object : objects) {
+    auto result = f(*object);
+    if (result != 0) {
+      return result;
+    }
+  }
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// traverseModuleState
+//--------------------------------------------------------------------------------------------------
+int traverseModuleState(PyObject* module, visitproc visit, void* arg) noexcept {
+  return forEachModuleStateObject(
+      module, [visit, arg](PyObject*& object) {
+        return object != nullptr ? visit(object, arg) : 0;
+      });
+}
+
+//--------------------------------------------------------------------------------------------------
+// clearModuleState
+//--------------------------------------------------------------------------------------------------
+int clearModuleState(PyObject* module) noexcept {
+  return forEachModuleStateObject(module, [](PyObject*& object) {
+    Py_CLEAR(object);
+    return 0;
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// SinglePhaseModule
+//--------------------------------------------------------------------------------------------------
+// A strong reference, since tracers made by the two-argument makeTracer can
+// outlive the module's entry in sys.modules.
+static PyObject* SinglePhaseModule = nullptr;
+
+//--------------------------------------------------------------------------------------------------
+// setSinglePhaseModule
+//--------------------------------------------------------------------------------------------------
+void setSinglePhaseModule(PyObject* module) noexcept {
+  Py_INCREF(module);
+  Py_XDECREF(SinglePhaseModule);
+  SinglePhaseModule = module;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getSinglePhaseModule
+//--------------------------------------------------------------------------------------------------
+PyObject* getSinglePhaseModule() noexcept { return SinglePhaseModule; }
+} // namespace python_bridge_tracer
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Python.h>
+
+namespace python_bridge_tracer {
+/**
+ * The classes and cached objects of a bridge module. Every interpreter that
+ * imports the module gets its own so that no python object is shared between
+ * interpreters.
+ */
+struct ModuleState {
+  PyObject* tracer_type;
+  PyObject* span_type;
+  PyObject* span_context_type;
+  PyObject* noop_span_type;
+  PyObject* noop_span_context_type;
+  PyObject* noop_span_context;
+  PyObject* logging_filter_type;
+  PyObject* traced_type;
+  PyObject* traced_coroutine_type;
+  PyObject* method_type;
+  PyObject* active_attribute;
+  PyObject* span_attribute;
+};
+
+/**
+ * @param module the module object or nullptr with python 2
+ * @return the module's state
+ */
+ModuleState& getModuleState(PyObject* module) noexcept;
+
+/**
+ * Visit the objects referenced by a module's state for the garbage collector.
+ * @param module the module object
+ * @param visit the visitor
+ * @param arg the visitor's argument
+ * @return the visitor's result if nonzero; otherwise, 0
+ */
+int traverseModuleState(PyObject* module, visitproc visit, void* arg) noexcept;
+
+/**
+ * Release the objects referenced by a module's state.
+ * @param module the module object
+ * @return 0
+ */
+int clearModuleState(PyObject* module) noexcept;
+
+/**
+ * Record the module made by the three-argument makeModule so that the
+ * two-argument makeTracer can find its classes.
+ * @param module the module
+ */
+void setSinglePhaseModule(PyObject* module) noexcept;
+
+/**
+ * @return the module recorded by setSinglePhaseModule or nullptr
+ */
+PyObject* getSinglePhaseModule() noexcept;
+} // namespace python_bridge_tracer
@@ -0,0 +1,232 @@
+#include "noop_span.h"
+
+#include "python_bridge_tracer/module.h"
+
+#include "module_state.h"
+#include "tracer.h"
+#include "python_bridge_tracer/utility.h"
+#include "python_bridge_tracer/type.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// NoopSpanObject
+//--------------------------------------------------------------------------------------------------
+namespace {
+struct NoopSpanObject {
+  // clang-format off
+  PyObject_HEAD
+  PyObject* tracer;
+  PyObject* context;
+  // clang-format on
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// NoopSpanContextObject
+//--------------------------------------------------------------------------------------------------
+namespace {
+struct NoopSpanContextObject {
+  // clang-format off
+  PyObject_HEAD
+  // clang-format on
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// deallocNoopSpan
+//--------------------------------------------------------------------------------------------------
+static void deallocNoopSpan(NoopSpanObject* self) noexcept {
+  Py_DECREF(self->context);
+  freeSelf(reinterpret_cast<PyObject*>(self));
+}
+
+//--------------------------------------------------------------------------------------------------
+// deallocNoopSpanContext
+//--------------------------------------------------------------------------------------------------
+static void deallocNoopSpanContext(NoopSpanContextObject* self) noexcept {
+  freeSelf(reinterpret_cast<PyObject*>(self));
+}
+
+//--------------------------------------------------------------------------------------------------
+// returnSelf
+//--------------------------------------------------------------------------------------------------
+static PyObject* returnSelf(PyObject* self, PyObject* /*args*/,
+                            PyObject* /*keywords*/) noexcept {
+  Py_INCREF(self);
+  return self;
+}
+
+//--------------------------------------------------------------------------------------------------
+// returnNone
+//--------------------------------------------------------------------------------------------------
+static PyObject* returnNone(PyObject* /*self*/, PyObject* /*args*/,
+                            PyObject* /*keywords*/) noexcept {
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getContext
+//--------------------------------------------------------------------------------------------------
+static PyObject* getContext(NoopSpanObject* self,
+                            PyObject* /*ignored*/) noexcept {
+  Py_INCREF(self->context);
+  return self->context;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getTracer
+//--------------------------------------------------------------------------------------------------
+static PyObject* getTracer(NoopSpanObject* self, PyObject* /*ignored*/) noexcept {
+  if (self->tracer == nullptr) {
+    Py_RETURN_NONE;
+  }
+  Py_INCREF(self->tracer);
+  return self->tracer;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getBaggage
+//--------------------------------------------------------------------------------------------------
+static PyObject* getBaggage(NoopSpanContextObject* /*self*/,
+                            PyObject* /*ignored*/) noexcept {
+  return PyDict_New();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getNone
+//--------------------------------------------------------------------------------------------------
+static PyObject* getNone(PyObject* /*self*/, PyObject* /*ignored*/) noexcept {
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// NoopSpanMethods
+//--------------------------------------------------------------------------------------------------
+// The arguments are never parsed so that calls on a no-op span cost as little
+// as possible.
+static PyMethodDef NoopSpanMethods[] = {
+    {"set_operation_name", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("set the span's operation name")},
+    {"set_tag", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("set a tag")},
+    {"log_kv", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("log key-values")},
+    {"set_baggage_item", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("stores a baggage item")},
+    {"get_baggage_item", reinterpret_cast<PyCFunction>(returnNone),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("retrieves a baggage item")},
+    {"log_event", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("log an event")},
+    {"log", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("log key-values")},
+    {"finish", reinterpret_cast<PyCFunction>(returnNone),
+     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("finish the span")},
+    {"__enter__", reinterpret_cast<PyCFunction>(returnSelf),
+     METH_VARARGS | METH_KEYWORDS, nullptr},
+    {"__exit__", reinterpret_cast<PyCFunction>(returnNone),
+     METH_VARARGS | METH_KEYWORDS, nullptr},
+    {nullptr, nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// NoopSpanGetSetList
+//--------------------------------------------------------------------------------------------------
+static PyGetSetDef NoopSpanGetSetList[] = {
+    {const_cast<char*>("context"), reinterpret_cast<getter>(getContext), nullptr,
+     const_cast<char*>(PyDoc_STR("Returns the span's context"))},
+    {const_cast<char*>("tracer"), reinterpret_cast<getter>(getTracer), nullptr,
+     const_cast<char*>(PyDoc_STR("Returns the tracer used to create the span"))},
+    {nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// NoopSpanContextGetSetList
+//--------------------------------------------------------------------------------------------------
+static PyGetSetDef NoopSpanContextGetSetList[] = {
+    {const_cast<char*>("baggage"), reinterpret_cast<getter>(getBaggage), nullptr,
+     const_cast<char*>(PyDoc_STR("return the context's baggage"))},
+    {const_cast<char*>("trace_id"), reinterpret_cast<getter>(getNone), nullptr,
+     const_cast<char*>(PyDoc_STR("return the context's trace id"))},
+    {const_cast<char*>("span_id"), reinterpret_cast<getter>(getNone), nullptr,
+     const_cast<char*>(PyDoc_STR("return the context's span id"))},
+    {nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// makeNoopSpan
+//--------------------------------------------------------------------------------------------------
+PyObject* makeNoopSpan(PyObject* tracer) noexcept {
+  auto& module_state = getTracerModuleState(tracer);
+  auto result = newPythonObject<NoopSpanObject>(module_state.noop_span_type);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  result->tracer = tracer;
+  Py_INCREF(module_state.noop_span_context);
+  result->context = module_state.noop_span_context;
+  return reinterpret_cast<PyObject*>(result);
+}
+
+//--------------------------------------------------------------------------------------------------
+// detachNoopSpan
+//--------------------------------------------------------------------------------------------------
+void detachNoopSpan(PyObject* noop_span) noexcept {
+  reinterpret_cast<NoopSpanObject*>(noop_span)->tracer = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// isNoopSpan
+//--------------------------------------------------------------------------------------------------
+bool isNoopSpan(PyObject* object) noexcept {
+  return hasDealloc(object, toVoidPtr(deallocNoopSpan));
+}
+
+//--------------------------------------------------------------------------------------------------
+// isNoopSpanContext
+//--------------------------------------------------------------------------------------------------
+bool isNoopSpanContext(PyObject* object) noexcept {
+  return hasDealloc(object, toVoidPtr(deallocNoopSpanContext));
+}
+
+//--------------------------------------------------------------------------------------------------
+// setupNoopSpanClasses
+//--------------------------------------------------------------------------------------------------
+bool setupNoopSpanClasses(PyObject* module) noexcept {
+  auto& module_state = getModuleState(module);
+  TypeDescription span_context_type_description;
+  span_context_type_description.name =
+      PYTHON_BRIDGE_TRACER_MODULE "._NoopSpanContext";
+  span_context_type_description.size = sizeof(NoopSpanContextObject);
+  span_context_type_description.doc = toVoidPtr("CppBridgeNoopSpanContext");
+  span_context_type_description.dealloc = toVoidPtr(deallocNoopSpanContext);
+  span_context_type_description.getset = toVoidPtr(NoopSpanContextGetSetList);
+  auto span_context_type =
+      makeType<NoopSpanContextObject>(span_context_type_description);
+  if (span_context_type == nullptr) {
+    return false;
+  }
+  Py_INCREF(span_context_type);
+  module_state.noop_span_context_type = span_context_type;
+  module_state.noop_span_context = reinterpret_cast<PyObject*>(
+      newPythonObject<NoopSpanContextObject>(span_context_type));
+  if (module_state.noop_span_context == nullptr) {
+    return false;
+  }
+
+  TypeDescription span_type_description;
+  span_type_description.name = PYTHON_BRIDGE_TRACER_MODULE "._NoopSpan";
+  span_type_description.size = sizeof(NoopSpanObject);
+  span_type_description.doc = toVoidPtr("CppBridgeNoopSpan");
+  span_type_description.dealloc = toVoidPtr(deallocNoopSpan);
+  span_type_description.methods = toVoidPtr(NoopSpanMethods);
+  span_type_description.getset = toVoidPtr(NoopSpanGetSetList);
+  auto span_type = makeType<NoopSpanObject>(span_type_description);
+  if (span_type == nullptr) {
+    return false;
+  }
+  Py_INCREF(span_type);
+  module_state.noop_span_type = span_type;
+
+  if (PyModule_AddObject(module, "_NoopSpanContext", span_context_type) != 0) {
+    return false;
+  }
+  return PyModule_AddObject(module, "_NoopSpan", span_type) == 0;
+}
+} // namespace python_bridge_tracer
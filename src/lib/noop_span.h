@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Python.h>
+
+namespace python_bridge_tracer {
+/**
+ * Make a no-op span whose methods do nothing. A tracer preallocates one no-op
+ * span and returns it for every span it doesn't sample.
+ * @param tracer the tracer that owns the span. The span doesn't keep a
+ * reference to the tracer; detachNoopSpan must be called before the tracer is
+ * destroyed.
+ * @return the no-op span object
+ */
+PyObject* makeNoopSpan(PyObject* tracer) noexcept;
+
+/**
+ * Clear the tracer of a no-op span.
+ * @param noop_span the no-op span
+ */
+void detachNoopSpan(PyObject* noop_span) noexcept;
+
+/**
+ * Check if an object is a no-op span
+ * @param object the object to check
+ * @return true if object is a no-op span
+ */
+bool isNoopSpan(PyObject* object) noexcept;
+
+/**
+ * Check if an object is the no-op span context
+ * @param object the object to check
+ * @return true if object is the no-op span context
+ */
+bool isNoopSpanContext(PyObject* object) noexcept;
+
+/**
+ * Setup the python no-op span and span context classes
+ * @param module the module to add the classes to
+ * @return true if succuessful
+ */
+bool setupNoopSpanClasses(PyObject* module) noexcept;
+} // namespace python_bridge_tracer
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Python.h>
+
+namespace python_bridge_tracer {
+#ifdef Py_GIL_DISABLED
+/**
+ * Guards the C++ state of a python object that several threads can use at
+ * once when the GIL is disabled (PEP 703).
+ *
+ * It's a PyMutex rather than a std::mutex since a thread waiting on a PyMutex
+ * detaches from the interpreter; otherwise, the garbage collector could stop
+ * the world while the owner holds the lock and never resume.
+ */
+class ObjectMutex {
+ public:
+  void lock() noexcept { PyMutex_Lock(&mutex_); }
+
+  void unlock() noexcept { PyMutex_Unlock(&mutex_); }
+
+ private:
+  PyMutex mutex_{};
+};
+#else
+/**
+ * With the GIL, only one thread runs at a time so there's nothing to lock.
+ */
+class ObjectMutex {
+ public:
+  void lock() noexcept {}
+
+  void unlock() noexcept {}
+};
+#endif
+}  // namespace python_bridge_tracer
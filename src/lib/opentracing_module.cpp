@@ -1,9 +1,47 @@
+#include "opentracing_module.h"
+
 #include "python_bridge_tracer/module.h"
 
 #include "python_bridge_tracer/utility.h"
 #include "python_bridge_tracer/python_object_wrapper.h"
 
 namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// setupScopeAttributes
+//--------------------------------------------------------------------------------------------------
+bool setupScopeAttributes(PyObject* module) noexcept {
+  auto& module_state = getModuleState(module);
+  module_state.active_attribute = toPyString("active");
+  if (module_state.active_attribute == nullptr) {
+    return false;
+  }
+  module_state.span_attribute = toPyString("span");
+  return module_state.span_attribute != nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getActiveScope
+//--------------------------------------------------------------------------------------------------
+PyObject* getActiveScope(const ModuleState& module_state,
+                         PyObject* scope_manager) noexcept {
+  return PyObject_GetAttr(scope_manager, module_state.active_attribute);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getActiveSpan
+//--------------------------------------------------------------------------------------------------
+PyObject* getActiveSpan(const ModuleState& module_state,
+                        PyObject* scope_manager) noexcept {
+  PythonObjectWrapper scope = getActiveScope(module_state, scope_manager);
+  if (scope.error()) {
+    return nullptr;
+  }
+  if (scope == Py_None) {
+    Py_RETURN_NONE;
+  }
+  return PyObject_GetAttr(scope, module_state.span_attribute);
+}
+
 //--------------------------------------------------------------------------------------------------
 // getThreadLocalScopeManager
 //--------------------------------------------------------------------------------------------------
@@ -16,6 +54,17 @@ PyObject* getThreadLocalScopeManager() noexcept {
   return PyObject_CallObject(scope_manager, nullptr);
 }
 
+//--------------------------------------------------------------------------------------------------
+// makeScope
+//--------------------------------------------------------------------------------------------------
+PyObject* makeScope(PyObject* scope_manager, PyObject* span) noexcept {
+  PythonObjectWrapper scope_class = getModuleAttribute("opentracing", "Scope");
+  if (scope_class.error()) {
+    return nullptr;
+  }
+  return PyObject_CallFunctionObjArgs(scope_class, scope_manager, span, nullptr);
+}
+
 //--------------------------------------------------------------------------------------------------
 // getUnsupportedFormatException
 //--------------------------------------------------------------------------------------------------
@@ -2,13 +2,48 @@
 
 #include <Python.h>
 
+#include "module_state.h"
+
 namespace python_bridge_tracer {
+/**
+ * Intern the attribute names used to look up the active span.
+ * @param module the module whose state to set up
+ * @return true if successful
+ */
+bool setupScopeAttributes(PyObject* module) noexcept;
+
+/**
+ * Look up a scope manager's active scope.
+ * @param module_state the module's state
+ * @param scope_manager the scope manager
+ * @return the active scope or Py_None if no scope is active
+ */
+PyObject* getActiveScope(const ModuleState& module_state,
+                         PyObject* scope_manager) noexcept;
+
+/**
+ * Look up the span of a scope manager's active scope.
+ * @param module_state the module's state
+ * @param scope_manager the scope manager
+ * @return the active span or Py_None if no scope is active
+ */
+PyObject* getActiveSpan(const ModuleState& module_state,
+                        PyObject* scope_manager) noexcept;
+
 /**
  * Lookup the thread local scope manager from the python OpenTracing module.
  * @return the scope manager object
  */
 PyObject* getThreadLocalScopeManager() noexcept;
 
+/**
+ * Construct an opentracing.Scope that does nothing when closed.
+ * @param scope_manager the scope manager of the scope
+ * @param span the span of the scope
+ * @return the scope object
+ */
+PyObject* makeScope(PyObject* scope_manager, PyObject* span) noexcept;
+
 /**
  * @return the python object for opentracing.UnsupportedFormatException
  */
@@ -0,0 +1,69 @@
+#include "overhead_profile.h"
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+OverheadProfile::OverheadProfile(size_t sample_interval) noexcept
+    : sample_interval_{sample_interval} {}
+
+//--------------------------------------------------------------------------------------------------
+// shouldSample
+//--------------------------------------------------------------------------------------------------
+bool OverheadProfile::shouldSample(Operation operation) noexcept {
+  static thread_local std::array<size_t, NumOperations> num_calls;
+  auto& count = num_calls[operation];
+  if (++count < sample_interval_) {
+    return false;
+  }
+  count = 0;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// record
+//--------------------------------------------------------------------------------------------------
+void OverheadProfile::record(Operation operation, uint64_t bridge_ticks,
+                             uint64_t vendor_ticks) noexcept {
+  bridge_histograms_[operation].record(bridge_ticks);
+  vendor_histograms_[operation].record(vendor_ticks);
+}
+
+//--------------------------------------------------------------------------------------------------
+// toPyDict
+//--------------------------------------------------------------------------------------------------
+PyObject* OverheadProfile::toPyDict() noexcept {
+  static const char* const operation_names[NumOperations] = {
+      "start_span", "set_tag", "log_kv", "finish", "inject", "extract"};
+  auto nanoseconds_per_tick = calibration_.getNanosecondsPerTick();
+  PythonObjectWrapper result = PyDict_New();
+  if (result.error()) {
+    return nullptr;
+  }
+  HistogramSnapshot snapshot;
+  for (int i = 0; i < NumOperations; ++i) {
+    bridge_histograms_[i].takeSnapshot(snapshot, false);
+    PythonObjectWrapper bridge = snapshot.toPyDict(nanoseconds_per_tick);
+    if (bridge.error()) {
+      return nullptr;
+    }
+    vendor_histograms_[i].takeSnapshot(snapshot, false);
+    PythonObjectWrapper vendor = snapshot.toPyDict(nanoseconds_per_tick);
+    if (vendor.error()) {
+      return nullptr;
+    }
+    PythonObjectWrapper operation = Py_BuildValue(
+        "{s:O,s:O}", "bridge", static_cast<PyObject*>(bridge), "vendor",
+        static_cast<PyObject*>(vendor));
+    if (operation.error()) {
+      return nullptr;
+    }
+    if (PyDict_SetItemString(result, operation_names[i], operation) != 0) {
+      return nullptr;
+    }
+  }
+  return result.release();
+}
+} // namespace python_bridge_tracer
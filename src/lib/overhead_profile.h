@@ -0,0 +1,138 @@
+#pragma once
+
+#include <Python.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "cycle_clock.h"
+#include "histogram.h"
+
+namespace python_bridge_tracer {
+/**
+ * Histograms of the time spent in a sample of the bridge's operations, split
+ * into the time spent in the bridge itself (argument parsing, conversions)
+ * and the time spent in the C++ tracer.
+ */
+class OverheadProfile {
+ public:
+  enum Operation { StartSpan, SetTag, LogKv, Finish, Inject, Extract, NumOperations };
+
+  /**
+   * @param sample_interval every sample_interval-th call of an operation on a
+   * thread is timed
+   */
+  explicit OverheadProfile(size_t sample_interval) noexcept;
+
+  OverheadProfile(const OverheadProfile&) = delete;
+  OverheadProfile& operator=(const OverheadProfile&) = delete;
+
+  /**
+   * @param operation the operation about to be called
+   * @return true if the call should be timed
+   */
+  bool shouldSample(Operation operation) noexcept;
+
+  /**
+   * Record a timed call.
+   * @param operation the operation called
+   * @param bridge_ticks the cycle counter ticks spent in the bridge
+   * @param vendor_ticks the cycle counter ticks spent in the C++ tracer
+   */
+  void record(Operation operation, uint64_t bridge_ticks,
+              uint64_t vendor_ticks) noexcept;
+
+  /**
+   * @return a dictionary mapping each operation's name to summaries of its
+   * bridge and vendor durations in nanoseconds
+   */
+  PyObject* toPyDict() noexcept;
+
+ private:
+  size_t sample_interval_;
+  CycleClockCalibration calibration_;
+  std::array<LogLinearHistogram, NumOperations> bridge_histograms_;
+  std::array<LogLinearHistogram, NumOperations> vendor_histograms_;
+};
+
+/**
+ * The timing state of the current thread.
+ */
+struct ThreadOverheadState {
+  bool is_sampling;
+  uint64_t vendor_ticks;
+};
+
+inline ThreadOverheadState& getThreadOverheadState() noexcept {
+  static thread_local ThreadOverheadState state;
+  return state;
+}
+
+/**
+ * Times a bridge operation if it's sampled. Nested operations (for example,
+ * the tags set by start_span) are attributed to the outermost one.
+ */
+class OverheadScope {
+ public:
+  OverheadScope(OverheadProfile* profile,
+                OverheadProfile::Operation operation) noexcept
+      : operation_{operation} {
+    if (profile == nullptr || !profile->shouldSample(operation)) {
+      return;
+    }
+    auto& state = getThreadOverheadState();
+    if (state.is_sampling) {
+      return;
+    }
+    profile_ = profile;
+    state.is_sampling = true;
+    state.vendor_ticks = 0;
+    start_ticks_ = readCycleCounter();
+  }
+
+  OverheadScope(const OverheadScope&) = delete;
+  OverheadScope& operator=(const OverheadScope&) = delete;
+
+  ~OverheadScope() noexcept {
+    if (profile_ == nullptr) {
+      return;
+    }
+    auto ticks = readCycleCounter() - start_ticks_;
+    auto& state = getThreadOverheadState();
+    state.is_sampling = false;
+    auto vendor_ticks = std::min(state.vendor_ticks, ticks);
+    profile_->record(operation_, ticks - vendor_ticks, vendor_ticks);
+  }
+
+ private:
+  OverheadProfile* profile_{nullptr};
+  OverheadProfile::Operation operation_;
+  uint64_t start_ticks_{0};
+};
+
+/**
+ * Attributes the time spent in its scope to the C++ tracer when the
+ * enclosing operation is sampled.
+ */
+class VendorTimer {
+ public:
+  VendorTimer() noexcept {
+    if (getThreadOverheadState().is_sampling) {
+      start_ticks_ = readCycleCounter();
+    }
+  }
+
+  VendorTimer(const VendorTimer&) = delete;
+  VendorTimer& operator=(const VendorTimer&) = delete;
+
+  ~VendorTimer() noexcept {
+    if (start_ticks_ != 0) {
+      getThreadOverheadState().vendor_ticks += readCycleCounter() - start_ticks_;
+    }
+  }
+
+ private:
+  uint64_t start_ticks_{0};
+};
+} // namespace python_bridge_tracer
@@ -0,0 +1,157 @@
+#include "pair_sequence_reader.h"
+
+#include <cctype>
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/python_string_wrapper.h"
+#include "python_bridge_error.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// toStringView
+//--------------------------------------------------------------------------------------------------
+static bool toStringView(PyObject* object, PythonStringWrapper& storage,
+                         opentracing::string_view& result) noexcept {
+  if (PyBytes_Check(object) == 1) {
+    char* data;
+    Py_ssize_t length;
+    if (PyBytes_AsStringAndSize(object, &data, &length) == -1) {
+      return false;
+    }
+    result = opentracing::string_view{data, static_cast<size_t>(length)};
+    return true;
+  }
+  PythonStringWrapper str{object};
+  if (str.error()) {
+    return false;
+  }
+  storage = std::move(str);
+  result = storage;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// equalsIgnoreCase
+//--------------------------------------------------------------------------------------------------
+static bool equalsIgnoreCase(opentracing::string_view lhs,
+                             opentracing::string_view rhs) noexcept {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(lhs[i])) !=
+        std::tolower(static_cast<unsigned char>(rhs[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+PairSequenceReader::PairSequenceReader(PyObject* sequence,
+                                       const KeyPrefixFilter& key_filter,
+                                       bool is_http_headers) noexcept
+    : sequence_{sequence},
+      key_filter_{key_filter},
+      is_http_headers_{is_http_headers} {}
+
+//--------------------------------------------------------------------------------------------------
+// size
+//--------------------------------------------------------------------------------------------------
+Py_ssize_t PairSequenceReader::size() const noexcept {
+  if (PyList_Check(sequence_) == 1) {
+    return PyList_Size(sequence_);
+  }
+  return PyTuple_Size(sequence_);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getPair
+//--------------------------------------------------------------------------------------------------
+bool PairSequenceReader::getPair(Py_ssize_t index, PyObject*& key,
+                                 PyObject*& value) const noexcept {
+  PyObject* pair;
+  if (PyList_Check(sequence_) == 1) {
+    pair = PyList_GetItem(sequence_, index);
+  } else {
+    pair = PyTuple_GetItem(sequence_, index);
+  }
+  if (pair == nullptr) {
+    return false;
+  }
+  if (PyTuple_Check(pair) == 1 && PyTuple_Size(pair) == 2) {
+    key = PyTuple_GetItem(pair, 0);
+    value = PyTuple_GetItem(pair, 1);
+    return true;
+  }
+  if (PyList_Check(pair) == 1 && PyList_Size(pair) == 2) {
+    key = PyList_GetItem(pair, 0);
+    value = PyList_GetItem(pair, 1);
+    return true;
+  }
+  PyErr_Format(PyExc_TypeError, "carrier items must be (key, value) pairs");
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// LookupKey
+//--------------------------------------------------------------------------------------------------
+opentracing::expected<opentracing::string_view> PairSequenceReader::LookupKey(
+    opentracing::string_view key) const {
+  auto num_pairs = size();
+  for (Py_ssize_t i = 0; i < num_pairs; ++i) {
+    PyObject* py_key;
+    PyObject* py_value;
+    if (!getPair(i, py_key, py_value)) {
+      return opentracing::make_unexpected(python_error);
+    }
+    PythonStringWrapper key_storage;
+    opentracing::string_view key_str;
+    if (!toStringView(py_key, key_storage, key_str)) {
+      return opentracing::make_unexpected(python_error);
+    }
+    if (is_http_headers_ ? !equalsIgnoreCase(key_str, key) : key_str != key) {
+      continue;
+    }
+    if (!toStringView(py_value, lookup_value_str_, lookup_value_)) {
+      return opentracing::make_unexpected(python_error);
+    }
+    return lookup_value_;
+  }
+  return opentracing::make_unexpected(opentracing::key_not_found_error);
+}
+
+//--------------------------------------------------------------------------------------------------
+// ForeachKey
+//--------------------------------------------------------------------------------------------------
+opentracing::expected<void> PairSequenceReader::ForeachKey(Callback callback) const {
+  auto num_pairs = size();
+  for (Py_ssize_t i = 0; i < num_pairs; ++i) {
+    PyObject* py_key;
+    PyObject* py_value;
+    if (!getPair(i, py_key, py_value)) {
+      return opentracing::make_unexpected(python_error);
+    }
+    if (!key_filter_.matches(py_key)) {
+      continue;
+    }
+    PythonStringWrapper key_storage;
+    opentracing::string_view key_str;
+    if (!toStringView(py_key, key_storage, key_str)) {
+      return opentracing::make_unexpected(python_error);
+    }
+    PythonStringWrapper value_storage;
+    opentracing::string_view value_str;
+    if (!toStringView(py_value, value_storage, value_str)) {
+      return opentracing::make_unexpected(python_error);
+    }
+    auto was_successful = callback(key_str, value_str);
+    if (!was_successful) {
+      return was_successful;
+    }
+  }
+  return {};
+}
+} // namespace python_bridge_tracer
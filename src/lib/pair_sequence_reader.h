@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Python.h>
+
+#include "key_prefix_filter.h"
+#include "python_bridge_tracer/python_string_wrapper.h"
+
+#include <opentracing/propagation.h>
+
+namespace python_bridge_tracer {
+/**
+ * Allow a python list or tuple of (key, value) pairs to be used as an
+ * OpenTracing-C++ carrier reader.
+ *
+ * This is the form taken by ASGI headers (a list of (bytes, bytes) tuples) and
+ * gRPC metadata (a tuple of (str, str|bytes) tuples). Keys and values can be
+ * either strings or bytes. Keys of HTTP headers are looked up
+ * case-insensitively and those of text maps exactly.
+ */
+class PairSequenceReader final : public opentracing::HTTPHeadersReader {
+ public:
+  using Callback = std::function<opentracing::expected<void>(
+      opentracing::string_view, opentracing::string_view)>;
+
+  /**
+   * @param sequence the python carrier
+   * @param key_filter filter applied to the keys visited by ForeachKey
+   * @param is_http_headers whether the carrier holds HTTP headers rather than
+   * a text map
+   */
+  PairSequenceReader(PyObject* sequence, const KeyPrefixFilter& key_filter,
+                     bool is_http_headers) noexcept;
+
+  // opentracing::TextMapReader
+  opentracing::expected<opentracing::string_view> LookupKey(opentracing::string_view key) const override;
+
+  opentracing::expected<void> ForeachKey(Callback callback) const override;
+
+ private:
+  PyObject* sequence_;
+  const KeyPrefixFilter& key_filter_;
+  bool is_http_headers_;
+  mutable PythonStringWrapper lookup_value_str_;
+  mutable opentracing::string_view lookup_value_;
+
+  Py_ssize_t size() const noexcept;
+
+  bool getPair(Py_ssize_t index, PyObject*& key, PyObject*& value) const
+      noexcept;
+};
+} // namespace python_bridge_tracer
@@ -0,0 +1,78 @@
+#include "pair_sequence_writer.h"
+
+#include <cctype>
+#include <string>
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+#include "python_bridge_error.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// hasBytesKeys
+//--------------------------------------------------------------------------------------------------
+static bool hasBytesKeys(PyObject* list, bool use_bytes_by_default) noexcept {
+  if (PyList_Size(list) == 0) {
+    return use_bytes_by_default;
+  }
+  auto pair = PyList_GetItem(list, 0);
+  if (PyTuple_Check(pair) == 0 || PyTuple_Size(pair) != 2) {
+    return use_bytes_by_default;
+  }
+  return PyBytes_Check(PyTuple_GetItem(pair, 0)) == 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// toPyStringOrBytes
+//--------------------------------------------------------------------------------------------------
+static PyObject* toPyStringOrBytes(opentracing::string_view s,
+                                   bool use_bytes) noexcept {
+  if (use_bytes) {
+    return PyBytes_FromStringAndSize(s.data(), static_cast<Py_ssize_t>(s.size()));
+  }
+  return toPyString(s);
+}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+PairSequenceWriter::PairSequenceWriter(PyObject* list,
+                                       bool is_http_headers) noexcept
+    : list_{list},
+      is_http_headers_{is_http_headers},
+      use_bytes_{hasBytesKeys(list, is_http_headers)} {}
+
+//--------------------------------------------------------------------------------------------------
+// Set
+//--------------------------------------------------------------------------------------------------
+opentracing::expected<void> PairSequenceWriter::Set(
+       opentracing::string_view key,
+       opentracing::string_view value) const {
+  PythonObjectWrapper py_key;
+  if (is_http_headers_) {
+    std::string lowercase_key{key.data(), key.size()};
+    for (auto& c : lowercase_key) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    py_key = toPyStringOrBytes(lowercase_key, use_bytes_);
+  } else {
+    py_key = toPyStringOrBytes(key, use_bytes_);
+  }
+  if (py_key.error()) {
+    return opentracing::make_unexpected(python_error);
+  }
+  PythonObjectWrapper py_value = toPyStringOrBytes(value, use_bytes_);
+  if (py_value.error()) {
+    return opentracing::make_unexpected(python_error);
+  }
+  PythonObjectWrapper pair = PyTuple_Pack(2, static_cast<PyObject*>(py_key),
+                                          static_cast<PyObject*>(py_value));
+  if (pair.error()) {
+    return opentracing::make_unexpected(python_error);
+  }
+  if (PyList_Append(list_, pair) != 0) {
+    return opentracing::make_unexpected(python_error);
+  }
+  return {};
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Python.h>
+
+#include <opentracing/propagation.h>
+
+namespace python_bridge_tracer {
+/**
+ * Allow a python list of (key, value) pairs to be used as an OpenTracing-C++
+ * carrier writer.
+ *
+ * HTTP header keys are lowercased as required by both ASGI and gRPC; text map
+ * keys are written as the tracer gives them. Pairs are written as bytes if the
+ * list already holds bytes keys, as strings if it already holds string keys,
+ * and otherwise as bytes for HTTP headers and as strings for text maps.
+ */
+class PairSequenceWriter final : public opentracing::HTTPHeadersWriter {
+ public:
+   /**
+    * @param list the python carrier
+    * @param is_http_headers whether the carrier holds HTTP headers rather than
+    * a text map
+    */
+   PairSequenceWriter(PyObject* list, bool is_http_headers) noexcept;
+
+  // opentracing::TextMapWriter
+   opentracing::expected<void> Set(
+       opentracing::string_view key,
+       opentracing::string_view value) const override;
+
+  private:
+   PyObject* list_;
+   bool is_http_headers_;
+   bool use_bytes_;
+};
+} // namespace python_bridge_tracer
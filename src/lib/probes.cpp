@@ -0,0 +1,20 @@
+#include "probes.h"
+
+#ifdef PYTHON_BRIDGE_TRACER_USDT
+//--------------------------------------------------------------------------------------------------
+// semaphores
+//--------------------------------------------------------------------------------------------------
+// Tools find a probe's semaphore through its note and increment it while
+// they're attached; by convention the semaphores live in the .probes section.
+#define PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(name) \
+  volatile unsigned short PYTHON_BRIDGE_TRACER_PROBE_SEMAPHORE(name) = 0
+
+extern "C" {
+PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(span__start);
+PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(span__finish);
+PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(inject);
+PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(extract);
+PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(tracer__flush);
+PYTHON_BRIDGE_TRACER_DEFINE_PROBE_SEMAPHORE(tracer__close);
+}
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+// USDT (SystemTap-style) probe points for observing the bridge with tools like
+// bpftrace, e.g.
+//
+//   bpftrace -e 'usdt:./bridge_tracer.so:python_bridge_tracer:span__start
+//                { @[str(arg0, arg1)] = count(); }'
+//
+// Probes are compiled out unless PYTHON_BRIDGE_TRACER_USDT is defined (build
+// with --define usdt=enabled). The probes and their arguments are
+//
+//   span__start(const char* operation_name, size_t operation_name_length)
+//     a span is started; operation_name isn't null-terminated
+//   span__finish(uint64_t duration_ns, int is_error)
+//     a span is finished for the first time
+//   inject(const char* format, int was_successful)
+//   extract(const char* format, int was_successful)
+//     a span context is injected into or extracted from a carrier; format is
+//     the null-terminated format name (e.g. "text_map")
+//   tracer__flush(uint64_t timeout_us)
+//     Tracer.flush is called; a timeout of 0 waits indefinitely
+//   tracer__close()
+//     Tracer.close is called
+//
+// Each probe has a semaphore that tools increment while they're attached to
+// it, so that the arguments of a probe (and any clock reads they need) are
+// only evaluated when someone is listening. Use
+// PYTHON_BRIDGE_TRACER_PROBE_ENABLED(name) to guard work done solely for a
+// probe.
+#ifdef PYTHON_BRIDGE_TRACER_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define PYTHON_BRIDGE_TRACER_PROBE_SEMAPHORE(name) \
+  python_bridge_tracer_##name##_semaphore
+
+// The semaphores are defined in probes.cpp.
+#define PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(name)         \
+  extern "C" volatile unsigned short                                \
+      PYTHON_BRIDGE_TRACER_PROBE_SEMAPHORE(name)                    \
+      __attribute__((unused)) __attribute__((section(".probes")))
+
+PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(span__start);
+PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(span__finish);
+PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(inject);
+PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(extract);
+PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(tracer__flush);
+PYTHON_BRIDGE_TRACER_DECLARE_PROBE_SEMAPHORE(tracer__close);
+
+#define PYTHON_BRIDGE_TRACER_PROBE_ENABLED(name) \
+  (__builtin_expect(PYTHON_BRIDGE_TRACER_PROBE_SEMAPHORE(name) != 0, 0))
+
+#define PYTHON_BRIDGE_TRACER_PROBE0(name)                \
+  do {                                                   \
+    if (PYTHON_BRIDGE_TRACER_PROBE_ENABLED(name)) {      \
+      DTRACE_PROBE(python_bridge_tracer, name);          \
+    }                                                    \
+  } while (false)
+#define PYTHON_BRIDGE_TRACER_PROBE1(name, arg1)          \
+  do {                                                   \
+    if (PYTHON_BRIDGE_TRACER_PROBE_ENABLED(name)) {      \
+      DTRACE_PROBE1(python_bridge_tracer, name, arg1);   \
+    }                                                    \
+  } while (false)
+#define PYTHON_BRIDGE_TRACER_PROBE2(name, arg1, arg2)        \
+  do {                                                       \
+    if (PYTHON_BRIDGE_TRACER_PROBE_ENABLED(name)) {          \
+      DTRACE_PROBE2(python_bridge_tracer, name, arg1, arg2); \
+    }                                                        \
+  } while (false)
+#else
+#define PYTHON_BRIDGE_TRACER_PROBE_ENABLED(name) false
+#define PYTHON_BRIDGE_TRACER_PROBE0(name) \
+  do {                                    \
+  } while (false)
+#define PYTHON_BRIDGE_TRACER_PROBE1(name, arg1) \
+  do {                                          \
+  } while (false)
+#define PYTHON_BRIDGE_TRACER_PROBE2(name, arg1, arg2) \
+  do {                                                \
+  } while (false)
+#endif
@@ -8,12 +8,17 @@ namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
-PythonStringWrapper::PythonStringWrapper(PyObject* object) noexcept 
-{
+PythonStringWrapper::PythonStringWrapper(PyObject* object,
+                                         size_t max_length) noexcept {
   if (PyString_AsStringAndSize(object, &data_, &length_) == -1) {
     data_ = nullptr;
     return;
   }
+  // The string's bytes are used in place so truncating is free.
+  if (max_length > 0 && static_cast<size_t>(length_) > max_length) {
+    length_ = static_cast<Py_ssize_t>(max_length);
+    truncated_ = true;
+  }
 }
 } // namespace python_bridge_tracer
 
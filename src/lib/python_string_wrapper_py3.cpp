@@ -8,9 +8,27 @@ namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
-PythonStringWrapper::PythonStringWrapper(PyObject* object) noexcept 
-  : utf8_{PyUnicode_AsUTF8String(object)}
-{
+PythonStringWrapper::PythonStringWrapper(PyObject* object,
+                                         size_t max_length) noexcept {
+  PythonObjectWrapper prefix;
+  if (max_length > 0) {
+    auto length = PyUnicode_GetLength(object);
+    if (length == -1) {
+      return;
+    }
+    if (static_cast<size_t>(length) > max_length) {
+      // Take the prefix first so that the rest of the string is never
+      // encoded.
+      prefix = PyUnicode_Substring(object, 0,
+                                   static_cast<Py_ssize_t>(max_length));
+      if (prefix.error()) {
+        return;
+      }
+      object = prefix;
+      truncated_ = true;
+    }
+  }
+  utf8_ = PyUnicode_AsUTF8String(object);
   if (utf8_.error()) {
     return;
   }
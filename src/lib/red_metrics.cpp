@@ -0,0 +1,224 @@
+#include "red_metrics.h"
+
+#include <algorithm>
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+
+namespace python_bridge_tracer {
+const size_t RedMetrics::NumShards;
+
+//--------------------------------------------------------------------------------------------------
+// hashOperationName
+//--------------------------------------------------------------------------------------------------
+// FNV-1a, since C++11 has no std::hash for string_view.
+static size_t hashOperationName(opentracing::string_view name) noexcept {
+  uint64_t hash = 14695981039346656037ull;
+  for (auto c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return static_cast<size_t>(hash);
+}
+
+//--------------------------------------------------------------------------------------------------
+// toPyDict
+//--------------------------------------------------------------------------------------------------
+static PyObject* toPyDict(const HistogramSnapshot& durations,
+                          uint64_t num_errors) noexcept {
+  PythonObjectWrapper duration_summary = durations.toPyDict(1.0e-9);
+  if (duration_summary.error()) {
+    return nullptr;
+  }
+  return Py_BuildValue("{s:K,s:K,s:O}", "count",
+                       static_cast<unsigned long long>(durations.count),
+                       "errors", static_cast<unsigned long long>(num_errors),
+                       "duration", static_cast<PyObject*>(duration_summary));
+}
+
+//--------------------------------------------------------------------------------------------------
+// OperationMetrics constructor
+//--------------------------------------------------------------------------------------------------
+RedMetrics::OperationMetrics::OperationMetrics(opentracing::string_view name,
+                                               size_t hash)
+    : name{name}, hash{hash} {}
+
+//--------------------------------------------------------------------------------------------------
+// Table constructor
+//--------------------------------------------------------------------------------------------------
+RedMetrics::Table::Table(size_t capacity)
+    : mask{capacity - 1},
+      slots{new std::atomic<OperationMetrics*>[capacity]()} {}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+RedMetrics::RedMetrics(size_t max_operations) noexcept
+    : max_operations_{max_operations}, other_operations_{{}, 0} {}
+
+//--------------------------------------------------------------------------------------------------
+// record
+//--------------------------------------------------------------------------------------------------
+void RedMetrics::record(opentracing::string_view operation_name,
+                        std::chrono::steady_clock::duration duration,
+                        bool is_error) noexcept try {
+  auto& operation_metrics = getOperationMetrics(operation_name);
+  auto nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  operation_metrics.durations.record(
+      static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0)));
+  if (is_error) {
+    operation_metrics.num_errors.fetch_add(1, std::memory_order_relaxed);
+  }
+} catch (const std::exception& /*e*/) {
+  // Drop the span if a new operation can't be allocated.
+}
+
+//--------------------------------------------------------------------------------------------------
+// findOperation
+//--------------------------------------------------------------------------------------------------
+RedMetrics::OperationMetrics* RedMetrics::findOperation(
+    const Table& table, opentracing::string_view name, size_t hash) noexcept {
+  for (auto index = hash;; ++index) {
+    auto operation =
+        table.slots[index & table.mask].load(std::memory_order_acquire);
+    if (operation == nullptr) {
+      return nullptr;
+    }
+    if (operation->hash == hash &&
+        opentracing::string_view{operation->name} == name) {
+      return operation;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// insertOperation
+//--------------------------------------------------------------------------------------------------
+void RedMetrics::insertOperation(Table& table,
+                                 OperationMetrics* operation) noexcept {
+  for (auto index = operation->hash;; ++index) {
+    auto& slot = table.slots[index & table.mask];
+    if (slot.load(std::memory_order_relaxed) == nullptr) {
+      slot.store(operation, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// getOperationMetrics
+//--------------------------------------------------------------------------------------------------
+RedMetrics::OperationMetrics& RedMetrics::getOperationMetrics(
+    opentracing::string_view operation_name) {
+  auto hash = hashOperationName(operation_name);
+  auto& shard = shards_[hash % NumShards];
+  // The low bits pick the shard, so probe with the rest.
+  hash /= NumShards;
+  auto table = shard.table.load(std::memory_order_acquire);
+  if (table != nullptr) {
+    auto operation = findOperation(*table, operation_name, hash);
+    if (operation != nullptr) {
+      return *operation;
+    }
+  }
+  return addOperationMetrics(shard, operation_name, hash);
+}
+
+//--------------------------------------------------------------------------------------------------
+// addOperationMetrics
+//--------------------------------------------------------------------------------------------------
+RedMetrics::OperationMetrics& RedMetrics::addOperationMetrics(
+    Shard& shard, opentracing::string_view operation_name, size_t hash) {
+  std::lock_guard<std::mutex> lock_guard{shard.mutex};
+  auto table = shard.table.load(std::memory_order_relaxed);
+  if (table != nullptr) {
+    // Another thread may have added the operation since the lookup.
+    auto operation = findOperation(*table, operation_name, hash);
+    if (operation != nullptr) {
+      return *operation;
+    }
+  }
+  if (num_operations_.fetch_add(1, std::memory_order_relaxed) >=
+      max_operations_) {
+    num_operations_.fetch_sub(1, std::memory_order_relaxed);
+    return other_operations_;
+  }
+  try {
+    std::unique_ptr<OperationMetrics> operation{
+        new OperationMetrics{operation_name, hash}};
+    // Keep the table at most half full so that probes stay short.
+    if (table == nullptr ||
+        2 * (shard.operations.size() + 1) > table->mask + 1) {
+      auto capacity = table == nullptr ? 8 : 2 * (table->mask + 1);
+      std::unique_ptr<Table> new_table{new Table{capacity}};
+      for (auto& other_operation : shard.operations) {
+        insertOperation(*new_table, other_operation.get());
+      }
+      shard.tables.emplace_back(std::move(new_table));
+      table = shard.tables.back().get();
+      shard.table.store(table, std::memory_order_release);
+    }
+    shard.operations.emplace_back(std::move(operation));
+  } catch (...) {
+    num_operations_.fetch_sub(1, std::memory_order_relaxed);
+    throw;
+  }
+  auto& result = *shard.operations.back();
+  insertOperation(*table, &result);
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// takeSnapshot
+//--------------------------------------------------------------------------------------------------
+PyObject* RedMetrics::takeSnapshot() noexcept try {
+  PythonObjectWrapper result = PyDict_New();
+  if (result.error()) {
+    return nullptr;
+  }
+  HistogramSnapshot durations;
+  auto add_operation = [&](PyObject* key,
+                           OperationMetrics& operation_metrics) -> bool {
+    operation_metrics.durations.takeSnapshot(durations, true);
+    auto num_errors =
+        operation_metrics.num_errors.exchange(0, std::memory_order_relaxed);
+    if (durations.count == 0 && num_errors == 0) {
+      return true;
+    }
+    PythonObjectWrapper value = toPyDict(durations, num_errors);
+    if (value.error()) {
+      return false;
+    }
+    return PyDict_SetItem(result, key, value) == 0;
+  };
+  for (auto& shard : shards_) {
+    // Operations are never removed, so the metrics can be read after the
+    // shard is unlocked.
+    std::vector<OperationMetrics*> operations;
+    {
+      std::lock_guard<std::mutex> lock_guard{shard.mutex};
+      operations.reserve(shard.operations.size());
+      for (auto& operation : shard.operations) {
+        operations.push_back(operation.get());
+      }
+    }
+    for (auto operation : operations) {
+      PythonObjectWrapper key = toPyString(operation->name);
+      if (key.error()) {
+        return nullptr;
+      }
+      if (!add_operation(key, *operation)) {
+        return nullptr;
+      }
+    }
+  }
+  if (!add_operation(Py_None, other_operations_)) {
+    return nullptr;
+  }
+  return result.release();
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to take snapshot: %s", e.what());
+  return nullptr;
+}
+} // namespace python_bridge_tracer
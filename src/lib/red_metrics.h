@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Python.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+#include "opentracing/string_view.h"
+
+namespace python_bridge_tracer {
+/**
+ * Rate, error and duration metrics aggregated per operation name from
+ * finished spans.
+ *
+ * Operations are kept in hash tables split into shards. Operations are never
+ * removed, so a lookup of an operation that's already tracked reads the
+ * shard's table without locking or allocating; only adding an operation
+ * locks the shard. The counts themselves are updated with relaxed atomics.
+ */
+class RedMetrics {
+ public:
+  /**
+   * @param max_operations the maximum number of distinct operation names
+   * tracked; spans of additional operations are aggregated together
+   */
+  explicit RedMetrics(size_t max_operations) noexcept;
+
+  RedMetrics(const RedMetrics&) = delete;
+  RedMetrics& operator=(const RedMetrics&) = delete;
+
+  /**
+   * Record a finished span.
+   * @param operation_name the span's operation name
+   * @param duration the span's duration
+   * @param is_error whether the span was tagged as an error
+   */
+  void record(opentracing::string_view operation_name,
+              std::chrono::steady_clock::duration duration,
+              bool is_error) noexcept;
+
+  /**
+   * Take the metrics recorded since the last snapshot and reset them.
+   * @return a dictionary mapping each operation name (or None for the
+   * aggregated operations beyond max_operations) to a dictionary with the
+   * keys count, errors and duration, a summary of the durations in seconds
+   */
+  PyObject* takeSnapshot() noexcept;
+
+ private:
+  struct OperationMetrics {
+    OperationMetrics(opentracing::string_view name, size_t hash);
+
+    const std::string name;
+    const size_t hash;
+    std::atomic<uint64_t> num_errors{0};
+    LogLinearHistogram durations;
+  };
+
+  // An open addressing table of a shard's operations. A full table is
+  // replaced by a larger copy, but kept until destruction since lookups may
+  // still be reading it.
+  struct Table {
+    explicit Table(size_t capacity);
+
+    size_t mask;
+    std::unique_ptr<std::atomic<OperationMetrics*>[]> slots;
+  };
+
+  struct Shard {
+    std::atomic<Table*> table{nullptr};
+
+    // Guards the members below and the replacement of table.
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Table>> tables;
+    std::vector<std::unique_ptr<OperationMetrics>> operations;
+  };
+
+  static const size_t NumShards = 16;
+
+  size_t max_operations_;
+  std::atomic<size_t> num_operations_{0};
+  std::array<Shard, NumShards> shards_;
+  OperationMetrics other_operations_;
+
+  static OperationMetrics* findOperation(const Table& table,
+                                         opentracing::string_view name,
+                                         size_t hash) noexcept;
+
+  // Requires the table's shard to be locked.
+  static void insertOperation(Table& table,
+                              OperationMetrics* operation) noexcept;
+
+  OperationMetrics& getOperationMetrics(
+      opentracing::string_view operation_name);
+
+  OperationMetrics& addOperationMetrics(Shard& shard,
+                                        opentracing::string_view operation_name,
+                                        size_t hash);
+};
+} // namespace python_bridge_tracer
@@ -0,0 +1,138 @@
+#include "sampling_policy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// hashOperationName
+//--------------------------------------------------------------------------------------------------
+// FNV-1a so that lookups can hash a string_view without constructing a
+// std::string.
+static uint64_t hashOperationName(opentracing::string_view operation_name) noexcept {
+  uint64_t result = 14695981039346656037ULL;
+  auto data = operation_name.data();
+  for (size_t i = 0; i < operation_name.size(); ++i) {
+    result ^= static_cast<unsigned char>(data[i]);
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getRandomNumberGenerator
+//--------------------------------------------------------------------------------------------------
+static std::mt19937_64& getRandomNumberGenerator() noexcept {
+  thread_local std::mt19937_64 random_number_generator{std::random_device{}()};
+  return random_number_generator;
+}
+
+//--------------------------------------------------------------------------------------------------
+// TokenBucket constructor
+//--------------------------------------------------------------------------------------------------
+TokenBucket::TokenBucket(double rate) noexcept
+    : rate_{rate},
+      capacity_{rate > 0 ? std::max(rate, 1.0) : 0},
+      tokens_{capacity_},
+      last_refill_{std::chrono::steady_clock::now()} {}
+
+//--------------------------------------------------------------------------------------------------
+// acquire
+//--------------------------------------------------------------------------------------------------
+bool TokenBucket::acquire() noexcept {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto elapsed = std::chrono::duration<double>{now - last_refill_}.count();
+  if (elapsed > 0) {
+    tokens_ = std::min(capacity_, tokens_ + elapsed * rate_);
+    last_refill_ = now;
+  }
+  if (tokens_ < 1) {
+    return false;
+  }
+  tokens_ -= 1;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// SamplingPolicy constructor
+//--------------------------------------------------------------------------------------------------
+SamplingPolicy::SamplingPolicy(const TracerOptions& options)
+    : is_enabled_{options.sample_rate < 1 || !options.denied_operations.empty() ||
+                  !options.operation_rate_limits.empty()},
+      sample_rate_{options.sample_rate} {
+  size_t num_operations = options.denied_operations.size() +
+                          options.operation_rate_limits.size();
+  if (num_operations == 0) {
+    return;
+  }
+  // Keep the load factor at or below 1/2.
+  size_t size = 1;
+  while (size < 2 * num_operations) {
+    size *= 2;
+  }
+  operations_.resize(size);
+  for (auto& operation_name : options.denied_operations) {
+    insert(operation_name).is_denied = true;
+  }
+  for (auto& rate_limit : options.operation_rate_limits) {
+    insert(rate_limit.first).rate_limit.reset(new TokenBucket{rate_limit.second});
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// insert
+//--------------------------------------------------------------------------------------------------
+SamplingPolicy::OperationRules& SamplingPolicy::insert(
+    const std::string& operation_name) {
+  auto mask = operations_.size() - 1;
+  for (auto index = hashOperationName(operation_name) & mask;;
+       index = (index + 1) & mask) {
+    auto& slot = operations_[index];
+    if (slot == nullptr) {
+      slot.reset(new OperationRules{});
+      slot->operation_name = operation_name;
+      return *slot;
+    }
+    if (slot->operation_name == operation_name) {
+      return *slot;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// lookup
+//--------------------------------------------------------------------------------------------------
+SamplingPolicy::OperationRules* SamplingPolicy::lookup(
+    opentracing::string_view operation_name) noexcept {
+  if (operations_.empty()) {
+    return nullptr;
+  }
+  auto mask = operations_.size() - 1;
+  for (auto index = hashOperationName(operation_name) & mask;;
+       index = (index + 1) & mask) {
+    auto& slot = operations_[index];
+    if (slot == nullptr) {
+      return nullptr;
+    }
+    if (opentracing::string_view{slot->operation_name} == operation_name) {
+      return slot.get();
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// sampleRoot
+//--------------------------------------------------------------------------------------------------
+bool SamplingPolicy::sampleRoot() const noexcept {
+  if (sample_rate_ >= 1) {
+    return true;
+  }
+  if (sample_rate_ <= 0) {
+    return false;
+  }
+  std::uniform_real_distribution<double> distribution{0, 1};
+  return distribution(getRandomNumberGenerator()) < sample_rate_;
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "python_bridge_tracer/tracer_options.h"
+
+#include "opentracing/string_view.h"
+
+namespace python_bridge_tracer {
+/**
+ * Limits the rate at which spans of an operation are sampled.
+ */
+class TokenBucket {
+ public:
+  /**
+   * @param rate the number of tokens added per second. The bucket holds at
+   * most max(rate, 1) tokens and starts out full.
+   */
+  explicit TokenBucket(double rate) noexcept;
+
+  /**
+   * @return true if a token was available and taken
+   */
+  bool acquire() noexcept;
+
+ private:
+  std::mutex mutex_;
+  double rate_;
+  double capacity_;
+  double tokens_;
+  std::chrono::steady_clock::time_point last_refill_;
+};
+
+/**
+ * Decides which spans the bridge starts with the vendor tracer. Spans that are
+ * rejected are replaced with a no-op span.
+ */
+class SamplingPolicy {
+ public:
+  /**
+   * The rules configured for an operation.
+   */
+  struct OperationRules {
+    std::string operation_name;
+    bool is_denied = false;
+    std::unique_ptr<TokenBucket> rate_limit;
+  };
+
+  explicit SamplingPolicy(const TracerOptions& options);
+
+  /**
+   * @return true if any sampling rules are configured
+   */
+  bool is_enabled() const noexcept { return is_enabled_; }
+
+  /**
+   * @param operation_name the operation name of a span
+   * @return the rules for the operation or nullptr if there are none
+   */
+  OperationRules* lookup(opentracing::string_view operation_name) noexcept;
+
+  /**
+   * Make the probabilistic decision for a span that has no parent.
+   * @return true if the span should be sampled
+   */
+  bool sampleRoot() const noexcept;
+
+ private:
+  bool is_enabled_;
+  double sample_rate_;
+
+  // Open addressing table of the operations with rules; its size is a power
+  // of two and empty slots are nullptr.
+  std::vector<std::unique_ptr<OperationRules>> operations_;
+
+  OperationRules& insert(const std::string& operation_name);
+};
+} // namespace python_bridge_tracer
@@ -2,13 +2,13 @@
 
 #include "python_bridge_tracer/module.h"
 
+#include "module_state.h"
 #include "span_bridge.h"
 #include "span_context.h"
+#include "tracer.h"
 #include "python_bridge_tracer/utility.h"
 #include "python_bridge_tracer/type.h"
 
-static PyObject* SpanType;
-
 namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // SpanObject
@@ -139,8 +139,10 @@ static PyObject* exitContext(SpanObject* self, PyObject* args) noexcept {
 // getContext
 //--------------------------------------------------------------------------------------------------
 static PyObject* getContext(SpanObject* self, PyObject* /*ignored*/) noexcept {
-  return makeSpanContext(std::unique_ptr<SpanContextBridge>{
-      new SpanContextBridge{self->span_bridge->span()}});
+  return makeSpanContext(
+      getTracerModuleState(self->tracer),
+      std::unique_ptr<SpanContextBridge>{new SpanContextBridge{
+      self->span_bridge->span(), self->span_bridge->cache()}});
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -192,7 +194,8 @@ static PyGetSetDef SpanGetSetList[] = {
 //--------------------------------------------------------------------------------------------------
 PyObject* makeSpan(std::unique_ptr<SpanBridge>&& span_bridge,
                    PyObject* tracer) noexcept {
-  auto result = newPythonObject<SpanObject>(SpanType);
+  auto result =
+      newPythonObject<SpanObject>(getTracerModuleState(tracer).span_type);
   if (result == nullptr) {
     return nullptr;
   }
@@ -206,7 +209,15 @@ PyObject* makeSpan(std::unique_ptr<SpanBridge>&& span_bridge,
 // isSpan
 //--------------------------------------------------------------------------------------------------
 bool isSpan(PyObject* object) noexcept {
-  return object->ob_type == reinterpret_cast<PyTypeObject*>(SpanType);
+  return hasDealloc(object, toVoidPtr(deallocSpan));
+}
+
+//--------------------------------------------------------------------------------------------------
+// getSpanBridge
+//--------------------------------------------------------------------------------------------------
+SpanBridge& getSpanBridge(PyObject* object) noexcept {
+  assert(isSpan(object));
+  return *reinterpret_cast<SpanObject*>(object)->span_bridge;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -214,8 +225,8 @@ bool isSpan(PyObject* object) noexcept {
 //--------------------------------------------------------------------------------------------------
 SpanContextBridge getSpanContextFromSpan(PyObject* object) noexcept {
   assert(isSpan(object));
-  return SpanContextBridge{
-      reinterpret_cast<SpanObject*>(object)->span_bridge->span()};
+  auto span_bridge = reinterpret_cast<SpanObject*>(object)->span_bridge;
+  return SpanContextBridge{span_bridge->span(), span_bridge->cache()};
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -234,7 +245,8 @@ bool setupSpanClass(PyObject* module) noexcept {
   if (span_type == nullptr) {
     return false;
   }
-  SpanType = span_type;
+  Py_INCREF(span_type);
+  getModuleState(module).span_type = span_type;
   auto rcode = PyModule_AddObject(module, "_Span", span_type);
   return rcode == 0;
 }
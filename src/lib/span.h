@@ -24,6 +24,13 @@ PyObject* makeSpan(std::unique_ptr<SpanBridge>&& span_bridge, PyObject* tracer)
  */
 bool isSpan(PyObject* object) noexcept;
 
+/**
+ * Get the span bridge of a python span object
+ * @param object the python span
+ * @return the span's SpanBridge
+ */
+SpanBridge& getSpanBridge(PyObject* object) noexcept;
+
 /**
  * Get the span context bridge associated with a python span object
  * @param object the python span
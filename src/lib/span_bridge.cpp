@@ -1,19 +1,46 @@
 #include "span_bridge.h"
 
+#include <cstring>
+
+#include "probes.h"
+#include "tracer_bridge.h"
+
 #include "python_bridge_tracer/utility.h"
 #include "to_string.h"
 #include "python_bridge_tracer/python_object_wrapper.h"
 #include "python_bridge_tracer/python_string_wrapper.h"
 
+static opentracing::string_view SamplingPriorityKey{"sampling.priority"};
+static opentracing::string_view ErrorKey{"error"};
+static opentracing::string_view DroppedLogsKey{"dropped_logs"};
+
 namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // setStringTag
 //--------------------------------------------------------------------------------------------------
 static bool setStringTag(opentracing::Span& span, opentracing::string_view key,
-    PyObject* value) noexcept {
-  PythonStringWrapper s{value};
-  span.SetTag(key, static_cast<opentracing::string_view>(s));
+    PyObject* value, size_t max_length,
+    opentracing::string_view truncation_marker) noexcept try {
+  PythonStringWrapper s{value, max_length};
+  if (s.error()) {
+    return false;
+  }
+  auto value_view = static_cast<opentracing::string_view>(s);
+  if (!s.truncated()) {
+    VendorTimer vendor_timer;
+    span.SetTag(key, value_view);
+    return true;
+  }
+  std::string truncated_value;
+  truncated_value.reserve(value_view.size() + truncation_marker.size());
+  truncated_value.append(value_view.data(), value_view.size());
+  truncated_value.append(truncation_marker.data(), truncation_marker.size());
+  VendorTimer vendor_timer;
+  span.SetTag(key, std::move(truncated_value));
   return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to set tag: %s", e.what());
+  return false;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -29,12 +56,60 @@ static std::chrono::system_clock::time_point getTimestamp(double py_timestamp) {
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
-SpanBridge::SpanBridge(std::unique_ptr<opentracing::Span>&& span) noexcept
-  : span_{span.release()} 
-{}
+SpanBridge::SpanBridge(std::unique_ptr<opentracing::Span>&& span,
+                       TracerBridge* tracer_bridge) noexcept
+    : span_{span.release()},
+      log_buffer_{
+          tracer_bridge != nullptr ? tracer_bridge->max_logs_per_span() : 0,
+          tracer_bridge != nullptr ? tracer_bridge->max_log_bytes_per_span()
+                                   : 0},
+      tracer_bridge_{tracer_bridge} {}
 
 SpanBridge::SpanBridge(std::shared_ptr<opentracing::Span> span) noexcept
-    : span_{std::move(span)} {}
+    : span_{std::move(span)}, log_buffer_{0, 0} {}
+
+//--------------------------------------------------------------------------------------------------
+// destructor
+//--------------------------------------------------------------------------------------------------
+SpanBridge::~SpanBridge() noexcept {
+  if (!is_finished_) {
+    incrementStat(TracerStats::UnfinishedSpansDeallocated);
+    if (live_span_registry_ != nullptr) {
+      live_span_registry_->remove(live_span_node_);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// cache
+//--------------------------------------------------------------------------------------------------
+std::shared_ptr<SpanContextCache> SpanBridge::cache() noexcept {
+  std::lock_guard<ObjectMutex> lock_guard{mutex_};
+  if (cache_ == nullptr) {
+    cache_ = std::make_shared<SpanContextCache>();
+  }
+  return cache_;
+}
+
+//--------------------------------------------------------------------------------------------------
+// trackRedMetrics
+//--------------------------------------------------------------------------------------------------
+void SpanBridge::trackRedMetrics(
+    RedMetrics& red_metrics, opentracing::string_view operation_name) noexcept try {
+  operation_name_.assign(operation_name.data(), operation_name.size());
+  red_metrics_ = &red_metrics;
+} catch (const std::exception& /*e*/) {
+  // Leave the span out of the metrics if its name can't be copied.
+}
+
+//--------------------------------------------------------------------------------------------------
+// trackLiveSpan
+//--------------------------------------------------------------------------------------------------
+void SpanBridge::trackLiveSpan(LiveSpanRegistry& live_span_registry,
+                               opentracing::string_view operation_name) noexcept {
+  live_span_registry_ = &live_span_registry;
+  live_span_registry.add(live_span_node_, start_timestamp_, operation_name);
+}
 
 //--------------------------------------------------------------------------------------------------
 // setOperationName
@@ -49,8 +124,32 @@ bool SpanBridge::setOperationName(PyObject* args,
                                   &operation_name_length) == 0) {
     return false;
   }
-  span_->SetOperationName(opentracing::string_view{
-      operation_name, static_cast<size_t>(operation_name_length)});
+  opentracing::string_view operation_name_view{
+      operation_name, static_cast<size_t>(operation_name_length)};
+  span_->SetOperationName(operation_name_view);
+  if (live_span_registry_ == nullptr && red_metrics_ == nullptr) {
+    return true;
+  }
+  // finishSpan reads the operation name without the lock once the span is
+  // finished, so it's no longer updated.
+  std::lock_guard<ObjectMutex> lock_guard{mutex_};
+  if (is_finished_) {
+    return true;
+  }
+  if (live_span_registry_ != nullptr) {
+    live_span_registry_->setOperationName(live_span_node_,
+                                          operation_name_view);
+  }
+  if (red_metrics_ != nullptr) {
+    try {
+      operation_name_.assign(operation_name_view.data(),
+                             operation_name_view.size());
+    } catch (const std::exception& e) {
+      PyErr_Format(PyExc_MemoryError, "failed to set operation name: %s",
+                   e.what());
+      return false;
+    }
+  }
   return true;
 }
 
@@ -58,12 +157,27 @@ bool SpanBridge::setOperationName(PyObject* args,
 // setTagKeyValue
 //--------------------------------------------------------------------------------------------------
 bool SpanBridge::setTagKeyValue(opentracing::string_view key, PyObject* value) noexcept {
+  // Some tracers propagate the sampling priority, so cached injections may no
+  // longer be accurate.
+  if (key == SamplingPriorityKey) {
+    invalidateCache();
+  }
   opentracing::Value cpp_value;
   if (isString(value)) {
-    return setStringTag(*span_, key, value);
+    if (!setStringTag(*span_, key, value, maxValueLength(),
+                      valueTruncationMarker())) {
+      return false;
+    }
+    incrementStat(TracerStats::TagsSet);
+    return true;
   }
   if (PyBool_Check(value) == 1) {
-    cpp_value = static_cast<bool>(PyObject_IsTrue(value));
+    auto bool_value = static_cast<bool>(PyObject_IsTrue(value));
+    if (key == ErrorKey) {
+      std::lock_guard<ObjectMutex> lock_guard{mutex_};
+      is_error_ = bool_value;
+    }
+    cpp_value = bool_value;
   } else if (isInt(value)) {
     long long_value;
     if (!toLong(value, long_value)) {
@@ -81,7 +195,11 @@ bool SpanBridge::setTagKeyValue(opentracing::string_view key, PyObject* value) n
                  "tag value must be a string, bool, or a numeric type");
     return false;
   }
-  span_->SetTag(key, cpp_value);
+  {
+    VendorTimer vendor_timer;
+    span_->SetTag(key, cpp_value);
+  }
+  incrementStat(TracerStats::TagsSet);
   return true;
 }
 
@@ -101,6 +219,7 @@ bool SpanBridge::setTagKeyValue(PyObject* key, PyObject* value) noexcept {
 // logKeyValues
 //--------------------------------------------------------------------------------------------------
 bool SpanBridge::logKeyValues(PyObject* args, PyObject* keywords) noexcept {
+  OverheadScope overhead_scope{overheadProfile(), OverheadProfile::LogKv};
   static char* keyword_names[] = {const_cast<char*>("key_values"),
                                   const_cast<char*>("timestamp"), nullptr};
   PyObject* key_values = nullptr;
@@ -116,6 +235,7 @@ bool SpanBridge::logKeyValues(PyObject* args, PyObject* keywords) noexcept {
   opentracing::LogRecord log_record;
   log_record.timestamp = getTimestamp(timestamp);
   log_record.fields.reserve(static_cast<size_t>(PyDict_Size(key_values)));
+  size_t num_bytes = 0;
   PyObject* key;
   PyObject* value;
   Py_ssize_t position = 0;
@@ -125,15 +245,16 @@ bool SpanBridge::logKeyValues(PyObject* args, PyObject* keywords) noexcept {
       return false;
     }
     std::string value_str;
-    if (!toString(value, value_str)) {
+    if (!toString(value, value_str, maxValueLength(),
+                  valueTruncationMarker())) {
       return false;
     }
-    log_record.fields.emplace_back(
-        std::string{static_cast<opentracing::string_view>(key_str)},
-        opentracing::Value{std::move(value_str)});
+    auto key_view = static_cast<opentracing::string_view>(key_str);
+    num_bytes += key_view.size() + value_str.size();
+    log_record.fields.emplace_back(std::string{key_view},
+                                   opentracing::Value{std::move(value_str)});
   }
-  finish_span_options_.log_records.emplace_back(std::move(log_record));
-  return true;
+  return addLogRecord(std::move(log_record), num_bytes);
 }
 
 bool SpanBridge::logKeyValues(
@@ -142,21 +263,49 @@ bool SpanBridge::logKeyValues(
   opentracing::LogRecord log_record;
   log_record.timestamp = getTimestamp(py_timestamp);
   log_record.fields.reserve(static_cast<size_t>(key_values.size()));
+  size_t num_bytes = 0;
   for (auto& key_value : key_values) {
     if (key_value.second == nullptr) {
       continue;
     }
-    PythonStringWrapper value_str{key_value.second};
+    PythonStringWrapper value_str{key_value.second, maxValueLength()};
     if (value_str.error()) {
       return false;
     }
-    log_record.fields.emplace_back(
-        key_value.first,
-        opentracing::Value{
-            std::string{static_cast<opentracing::string_view>(value_str)}});
+    std::string value{static_cast<opentracing::string_view>(value_str)};
+    if (value_str.truncated()) {
+      auto truncation_marker = valueTruncationMarker();
+      value.append(truncation_marker.data(), truncation_marker.size());
+    }
+    num_bytes += std::strlen(key_value.first) + value.size();
+    log_record.fields.emplace_back(key_value.first,
+                                   opentracing::Value{std::move(value)});
+  }
+  return addLogRecord(std::move(log_record), num_bytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+// addLogRecord
+//--------------------------------------------------------------------------------------------------
+bool SpanBridge::addLogRecord(opentracing::LogRecord&& log_record,
+                              size_t num_bytes) noexcept try {
+  size_t num_dropped = 0;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{mutex_};
+    if (log_buffer_.bounded()) {
+      num_dropped = log_buffer_.add(std::move(log_record), num_bytes);
+    } else {
+      finish_span_options_.log_records.emplace_back(std::move(log_record));
+    }
+  }
+  incrementStat(TracerStats::LogsSet);
+  if (num_dropped > 0) {
+    incrementStat(TracerStats::LogsDropped, num_dropped);
   }
-  finish_span_options_.log_records.emplace_back(std::move(log_record));
   return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to log: %s", e.what());
+  return false;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -213,6 +362,7 @@ bool SpanBridge::setBaggageItem(PyObject* args,
   span_->SetBaggageItem(
       opentracing::string_view{key_data, static_cast<size_t>(key_length)},
       opentracing::string_view{value_data, static_cast<size_t>(value_length)});
+  invalidateCache();
   return true;
 }
 
@@ -239,6 +389,7 @@ PyObject* SpanBridge::getBaggageItem(PyObject* args, PyObject* keywords) noexcep
 // setTag
 //--------------------------------------------------------------------------------------------------
 bool SpanBridge::setTag(PyObject* args, PyObject* keywords) noexcept {
+  OverheadScope overhead_scope{overheadProfile(), OverheadProfile::SetTag};
   static char* keyword_names[] = {const_cast<char*>("key"),
                                   const_cast<char*>("value"), nullptr};
   const char* key_data;
@@ -257,6 +408,7 @@ bool SpanBridge::setTag(PyObject* args, PyObject* keywords) noexcept {
 // finish
 //--------------------------------------------------------------------------------------------------
 PyObject* SpanBridge::finish(PyObject* args, PyObject* keywords) noexcept {
+  OverheadScope overhead_scope{overheadProfile(), OverheadProfile::Finish};
   static char* keyword_names[] = {
     const_cast<char*>("finish_time"),
     nullptr
@@ -266,19 +418,21 @@ PyObject* SpanBridge::finish(PyObject* args, PyObject* keywords) noexcept {
         args, keywords, "|d:finish", keyword_names, &finish_time) == 0) {
     return nullptr;
   }
+  opentracing::SteadyTime finish_steady_timestamp;
   if (finish_time != 0) {
-    finish_span_options_.finish_steady_timestamp =
+    finish_steady_timestamp =
         opentracing::convert_time_point<std::chrono::steady_clock>(
             toTimestamp(finish_time));
   }
-  span_->FinishWithOptions(finish_span_options_);
+  finishSpan(finish_steady_timestamp);
   Py_RETURN_NONE;
 }
 
 //--------------------------------------------------------------------------------------------------
 // exit
 //--------------------------------------------------------------------------------------------------
-PyObject* SpanBridge::exit(PyObject* args) noexcept {
+PyObject* SpanBridge::exit(PyObject* args) noexcept try {
+  OverheadScope overhead_scope{overheadProfile(), OverheadProfile::Finish};
   PyObject* exc_type;
   PyObject* exc_value;
   PyObject* traceback;
@@ -287,25 +441,204 @@ PyObject* SpanBridge::exit(PyObject* args) noexcept {
   }
   if (exc_type != Py_None) {
     span_->SetTag("error", true);
+    {
+      std::lock_guard<ObjectMutex> lock_guard{mutex_};
+      is_error_ = true;
+    }
     std::string exc_value_str;
-    if (!toString(exc_value, exc_value_str)) {
+    if (!toString(exc_value, exc_value_str, maxValueLength(),
+                  valueTruncationMarker())) {
       return nullptr;
     }
     std::string exc_type_str;
-    if (!toString(exc_type, exc_type_str)) {
+    if (!toString(exc_type, exc_type_str, maxValueLength(),
+                  valueTruncationMarker())) {
       return nullptr;
     }
     std::string traceback_str;
-    if (!toString(traceback, traceback_str)) {
+    if (!toString(traceback, traceback_str, maxValueLength(),
+                  valueTruncationMarker())) {
+      return nullptr;
+    }
+    // Go through addLogRecord so that the record counts against the span's
+    // log bounds like any other.
+    opentracing::LogRecord log_record;
+    log_record.timestamp = getTimestamp(0);
+    log_record.fields.reserve(5);
+    size_t num_bytes = 0;
+    auto add_field = [&](const char* key, std::string&& value) {
+      num_bytes += std::strlen(key) + value.size();
+      log_record.fields.emplace_back(key, opentracing::Value{std::move(value)});
+    };
+    add_field("event", "error");
+    add_field("message", std::string{exc_value_str});
+    add_field("error.object", std::move(exc_value_str));
+    add_field("error.kind", std::move(exc_type_str));
+    add_field("stack", std::move(traceback_str));
+    if (!addLogRecord(std::move(log_record), num_bytes)) {
       return nullptr;
     }
-    span_->Log({{"event", "error"},
-                {"message", std::move(exc_value_str)},
-                {"error.object", std::move(exc_value_str)},
-                {"error.kind", std::move(exc_type_str)},
-                {"stack", std::move(traceback_str)}});
   }
-  span_->FinishWithOptions(finish_span_options_);
+  finishSpan();
   Py_RETURN_NONE;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to log: %s", e.what());
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishCall
+//--------------------------------------------------------------------------------------------------
+bool SpanBridge::finishCall(PyObject* exc_type, PyObject* exc_value) noexcept {
+  OverheadScope overhead_scope{overheadProfile(), OverheadProfile::Finish};
+  if (exc_type != Py_None) {
+    span_->SetTag("error", true);
+    {
+      std::lock_guard<ObjectMutex> lock_guard{mutex_};
+      is_error_ = true;
+    }
+    PythonObjectWrapper event = toPyString("error");
+    if (event.error()) {
+      return false;
+    }
+    PythonObjectWrapper error_kind = PyObject_GetAttrString(exc_type, "__name__");
+    if (error_kind.error()) {
+      return false;
+    }
+    PythonObjectWrapper message = PyObject_Str(exc_value);
+    if (message.error()) {
+      return false;
+    }
+    if (!logKeyValues({{"event", event},
+                       {"error.kind", error_kind},
+                       {"message", message}})) {
+      return false;
+    }
+  }
+  finishSpan();
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishSpan
+//--------------------------------------------------------------------------------------------------
+void SpanBridge::finishSpan(
+    opentracing::SteadyTime finish_steady_timestamp) noexcept {
+  opentracing::FinishSpanOptions finish_span_options;
+  uint64_t num_dropped_logs;
+  bool is_error;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{mutex_};
+    if (is_finished_) {
+      return;
+    }
+    is_finished_ = true;
+    if (live_span_registry_ != nullptr) {
+      live_span_registry_->remove(live_span_node_);
+    }
+    if (log_buffer_.bounded()) {
+      try {
+        log_buffer_.moveTo(finish_span_options_.log_records);
+      } catch (const std::exception& /*e*/) {
+        // Finish the span without the buffered logs rather than not at all.
+      }
+    }
+    num_dropped_logs = log_buffer_.num_dropped();
+    is_error = is_error_;
+    finish_span_options = std::move(finish_span_options_);
+  }
+  if (finish_steady_timestamp != opentracing::SteadyTime{}) {
+    finish_span_options.finish_steady_timestamp = finish_steady_timestamp;
+  }
+  incrementStat(TracerStats::SpansFinished);
+  if (num_dropped_logs > 0) {
+    VendorTimer vendor_timer;
+    span_->SetTag(DroppedLogsKey, num_dropped_logs);
+  }
+  if (start_timestamp_ != std::chrono::steady_clock::time_point{}) {
+    auto finish_timestamp = finish_span_options.finish_steady_timestamp;
+    if (finish_timestamp == opentracing::SteadyTime{}) {
+      finish_timestamp = std::chrono::steady_clock::now();
+    }
+    auto duration = finish_timestamp - start_timestamp_;
+    if (red_metrics_ != nullptr) {
+      red_metrics_->record(operation_name_, duration, is_error);
+    }
+    PYTHON_BRIDGE_TRACER_PROBE2(
+        span__finish,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+                .count()),
+        static_cast<int>(is_error));
+  }
+  auto export_queue =
+      tracer_bridge_ != nullptr ? tracer_bridge_->export_queue() : nullptr;
+  if (export_queue == nullptr) {
+    VendorTimer vendor_timer;
+    span_->FinishWithOptions(finish_span_options);
+    return;
+  }
+  // The worker finishes the span later so record the finish time now.
+  if (finish_span_options.finish_steady_timestamp ==
+      opentracing::SteadyTime{}) {
+    finish_span_options.finish_steady_timestamp =
+        std::chrono::steady_clock::now();
+  }
+  if (!export_queue->push(span_, std::move(finish_span_options))) {
+    // The queue is full so finish the span here rather than losing its
+    // finish time and logs.
+    VendorTimer vendor_timer;
+    span_->FinishWithOptions(finish_span_options);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// invalidateCache
+//--------------------------------------------------------------------------------------------------
+void SpanBridge::invalidateCache() noexcept {
+  std::lock_guard<ObjectMutex> lock_guard{mutex_};
+  if (cache_ != nullptr) {
+    cache_->invalidate();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// incrementStat
+//--------------------------------------------------------------------------------------------------
+void SpanBridge::incrementStat(TracerStats::Counter counter,
+                               uint64_t amount) noexcept {
+  if (tracer_bridge_ != nullptr) {
+    tracer_bridge_->stats().increment(counter, amount);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// overheadProfile
+//--------------------------------------------------------------------------------------------------
+OverheadProfile* SpanBridge::overheadProfile() noexcept {
+  if (tracer_bridge_ == nullptr) {
+    return nullptr;
+  }
+  return tracer_bridge_->overhead_profile();
+}
+
+//--------------------------------------------------------------------------------------------------
+// maxValueLength
+//--------------------------------------------------------------------------------------------------
+size_t SpanBridge::maxValueLength() const noexcept {
+  if (tracer_bridge_ == nullptr) {
+    return 0;
+  }
+  return tracer_bridge_->max_value_length();
+}
+
+//--------------------------------------------------------------------------------------------------
+// valueTruncationMarker
+//--------------------------------------------------------------------------------------------------
+opentracing::string_view SpanBridge::valueTruncationMarker() const noexcept {
+  if (tracer_bridge_ == nullptr) {
+    return {};
+  }
+  return tracer_bridge_->value_truncation_marker();
 }
 }  // namespace python_bridge_tracer
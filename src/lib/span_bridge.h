@@ -1,26 +1,78 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <string>
 
 #include <Python.h>
 
+#include "live_span_registry.h"
+#include "log_buffer.h"
+#include "object_mutex.h"
+#include "overhead_profile.h"
+#include "red_metrics.h"
+#include "span_context_cache.h"
+#include "tracer_stats.h"
+
 #include "opentracing/span.h"
 
 namespace python_bridge_tracer {
+class TracerBridge;
+
 /**
  * Translates OpenTracing-Python span methods to their OpenTracing-C++ equivalents.
  */
 class SpanBridge {
  public:
-   explicit SpanBridge(std::unique_ptr<opentracing::Span>&& span) noexcept;
+   explicit SpanBridge(std::unique_ptr<opentracing::Span>&& span,
+                       TracerBridge* tracer_bridge = nullptr) noexcept;
 
    explicit SpanBridge(std::shared_ptr<opentracing::Span> span) noexcept;
 
+   SpanBridge(const SpanBridge&) = delete;
+   SpanBridge& operator=(const SpanBridge&) = delete;
+
+   ~SpanBridge() noexcept;
+
    /**
     * @return the OpenTracing-C++ span associated with the bridge.
     */
    std::shared_ptr<const opentracing::Span> span() noexcept { return span_; }
 
+   /**
+    * @return the cache shared by the span contexts of this span.
+    */
+   std::shared_ptr<SpanContextCache> cache() noexcept;
+
+   /**
+    * Set the span's start time so that its duration is known when it
+    * finishes.
+    * @param start_timestamp the span's start time
+    */
+   void setStartTimestamp(
+       std::chrono::steady_clock::time_point start_timestamp) noexcept {
+     start_timestamp_ = start_timestamp;
+   }
+
+   /**
+    * Aggregate the span's duration and error status into RED metrics when it
+    * finishes. Requires the start time to be set.
+    * @param red_metrics the metrics to record into
+    * @param operation_name the span's operation name
+    */
+   void trackRedMetrics(RedMetrics& red_metrics,
+                        opentracing::string_view operation_name) noexcept;
+
+   /**
+    * Register the span as live until it finishes. Requires the start time to
+    * be set.
+    * @param live_span_registry the registry to add the span to
+    * @param operation_name the span's operation name
+    */
+   void trackLiveSpan(LiveSpanRegistry& live_span_registry,
+                      opentracing::string_view operation_name) noexcept;
+
    /**
     * Change the operation name of a span.
     * @param args python function arguments
@@ -107,9 +159,55 @@ class SpanBridge {
     * @return Py_None on success
     */
    PyObject* exit(PyObject* args) noexcept;
+
+   /**
+    * Finish the span of a call made by the bridge, recording the exception the
+    * call raised. Unlike exit, the traceback isn't converted.
+    * @param exc_type the type of the exception or Py_None
+    * @param exc_value the exception or Py_None
+    * @return true if successful
+    */
+   bool finishCall(PyObject* exc_type, PyObject* exc_value) noexcept;
  private:
   std::shared_ptr<opentracing::Span> span_;
+
+  // Guards the members below it that change after the span starts. The
+  // vendor span is expected to be thread-safe on its own.
+  ObjectMutex mutex_;
+  std::shared_ptr<SpanContextCache> cache_;
   opentracing::FinishSpanOptions finish_span_options_;
+  LogBuffer log_buffer_;
+  TracerBridge* tracer_bridge_{nullptr};
+  bool is_finished_{false};
+
+  // Only set if RED metrics or probes are enabled.
+  std::chrono::steady_clock::time_point start_timestamp_;
+  bool is_error_{false};
+
+  // Only set if RED metrics are tracked for the span.
+  RedMetrics* red_metrics_{nullptr};
+  std::string operation_name_;
+
+  // Only set if live spans are tracked.
+  LiveSpanRegistry* live_span_registry_{nullptr};
+  LiveSpanRegistry::Node live_span_node_;
+
+  void finishSpan(
+      opentracing::SteadyTime finish_steady_timestamp = {}) noexcept;
+
+  void invalidateCache() noexcept;
+
+  void incrementStat(TracerStats::Counter counter,
+                     uint64_t amount = 1) noexcept;
+
+  OverheadProfile* overheadProfile() noexcept;
+
+  size_t maxValueLength() const noexcept;
+
+  opentracing::string_view valueTruncationMarker() const noexcept;
+
+  bool addLogRecord(opentracing::LogRecord&& log_record,
+                    size_t num_bytes) noexcept;
 
   bool logKeyValues(
       std::initializer_list<std::pair<const char*, PyObject*>> key_values,
@@ -4,11 +4,11 @@
 
 #include "python_bridge_tracer/module.h"
 
+#include "module_state.h"
+
 #include "python_bridge_tracer/utility.h"
 #include "python_bridge_tracer/type.h"
 
-static PyObject* SpanContextType;
-
 namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // SpanContextObject
@@ -34,8 +34,10 @@ static void deallocSpanContext(SpanContextObject* self) noexcept {
 // makeSpanContext
 //--------------------------------------------------------------------------------------------------
 PyObject* makeSpanContext(
+    const ModuleState& module_state,
     std::unique_ptr<SpanContextBridge>&& span_context_bridge) noexcept {
-  auto result = newPythonObject<SpanContextObject>(SpanContextType);
+  auto result =
+      newPythonObject<SpanContextObject>(module_state.span_context_type);
   if (result == nullptr) {
     return nullptr;
   }
@@ -47,13 +49,13 @@ PyObject* makeSpanContext(
 // isSpanContext
 //--------------------------------------------------------------------------------------------------
 bool isSpanContext(PyObject* object) noexcept {
-  return object->ob_type == reinterpret_cast<PyTypeObject*>(SpanContextType);
+  return hasDealloc(object, toVoidPtr(deallocSpanContext));
 }
 
 //--------------------------------------------------------------------------------------------------
 // getSpanContext
 //--------------------------------------------------------------------------------------------------
-SpanContextBridge getSpanContext(PyObject* object) noexcept {
+const SpanContextBridge& getSpanContext(PyObject* object) noexcept {
   assert(isSpanContext(object));
   return *reinterpret_cast<SpanContextObject*>(object)->span_context_bridge;
 }
@@ -65,6 +67,20 @@ static PyObject* getBaggage(SpanContextObject* self, PyObject* /*ignored*/) noex
   return self->span_context_bridge->getBaggageAsPyDict();
 }
 
+//--------------------------------------------------------------------------------------------------
+// getTraceId
+//--------------------------------------------------------------------------------------------------
+static PyObject* getTraceId(SpanContextObject* self, PyObject* /*ignored*/) noexcept {
+  return self->span_context_bridge->getTraceId();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getSpanId
+//--------------------------------------------------------------------------------------------------
+static PyObject* getSpanId(SpanContextObject* self, PyObject* /*ignored*/) noexcept {
+  return self->span_context_bridge->getSpanId();
+}
+
 
 //--------------------------------------------------------------------------------------------------
 // SpanContextGetSetList
@@ -72,6 +88,10 @@ static PyObject* getBaggage(SpanContextObject* self, PyObject* /*ignored*/) noex
 static PyGetSetDef SpanContextGetSetList[] = {
     {const_cast<char*>("baggage"), reinterpret_cast<getter>(getBaggage), nullptr,
      const_cast<char*>(PyDoc_STR("return the context's baggage"))},
+    {const_cast<char*>("trace_id"), reinterpret_cast<getter>(getTraceId), nullptr,
+     const_cast<char*>(PyDoc_STR("return the context's trace id"))},
+    {const_cast<char*>("span_id"), reinterpret_cast<getter>(getSpanId), nullptr,
+     const_cast<char*>(PyDoc_STR("return the context's span id"))},
     {nullptr}};
 
 //--------------------------------------------------------------------------------------------------
@@ -88,7 +108,8 @@ bool setupSpanContextClass(PyObject* module) noexcept {
   if (span_context_type == nullptr) {
     return false;
   }
-  SpanContextType = span_context_type;
+  Py_INCREF(span_context_type);
+  getModuleState(module).span_context_type = span_context_type;
   auto rcode = PyModule_AddObject(module, "_SpanContext", span_context_type);
   return rcode == 0;
 }
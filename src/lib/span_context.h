@@ -4,6 +4,7 @@
 
 #include <Python.h>
 
+#include "module_state.h"
 #include "span_context_bridge.h"
 
 #include "opentracing/span.h"
@@ -11,10 +12,12 @@
 namespace python_bridge_tracer {
 /**
  * Make a python span context from a span bridge
+ * @param module_state the state of the module whose class to use
  * @param span_context_bridge the C++ span context bridge
  * @return an OpenTracing span context object
  */
 PyObject* makeSpanContext(
+    const ModuleState& module_state,
     std::unique_ptr<SpanContextBridge>&& span_context_bridge) noexcept;
 
 /**
@@ -29,7 +32,7 @@ bool isSpanContext(PyObject* object) noexcept;
  * @param object the python span context
  * @return the associated SpanContextBridge
  */
-SpanContextBridge getSpanContext(PyObject* object) noexcept;
+const SpanContextBridge& getSpanContext(PyObject* object) noexcept;
 
 /**
  * Setup the python span context class
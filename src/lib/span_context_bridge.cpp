@@ -1,15 +1,29 @@
 #include "span_context_bridge.h"
 
+#include <mutex>
+
+#include "tail_sampling_tracer.h"
 #include "python_bridge_tracer/python_object_wrapper.h"
 #include "python_bridge_tracer/utility.h"
 
 namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// toPyId
+//--------------------------------------------------------------------------------------------------
+static PyObject* toPyId(const std::string& id) noexcept {
+  if (id.empty()) {
+    Py_RETURN_NONE;
+  }
+  return toPyString(id);
+}
+
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
 SpanContextBridge::SpanContextBridge(
-    std::shared_ptr<const opentracing::Span> span) noexcept
-    : span_{std::move(span)} {}
+    std::shared_ptr<const opentracing::Span> span,
+    std::shared_ptr<SpanContextCache> cache) noexcept
+    : span_{std::move(span)}, cache_{std::move(cache)} {}
 
 SpanContextBridge::SpanContextBridge(
     std::unique_ptr<const opentracing::SpanContext>&& span_context) noexcept
@@ -26,6 +40,17 @@ const opentracing::SpanContext& SpanContextBridge::span_context() const
   return *span_context_;
 }
 
+//--------------------------------------------------------------------------------------------------
+// cache
+//--------------------------------------------------------------------------------------------------
+SpanContextCache& SpanContextBridge::cache() const noexcept {
+  std::lock_guard<ObjectMutex> lock_guard{mutex_};
+  if (cache_ == nullptr) {
+    cache_ = std::make_shared<SpanContextCache>();
+  }
+  return *cache_;
+}
+
 //--------------------------------------------------------------------------------------------------
 // getBaggageAsPyDict
 //--------------------------------------------------------------------------------------------------
@@ -60,4 +85,62 @@ PyObject* SpanContextBridge::getBaggageAsPyDict() const noexcept {
   }
   return result.release();
 }
+
+//--------------------------------------------------------------------------------------------------
+// getTraceId
+//--------------------------------------------------------------------------------------------------
+PyObject* SpanContextBridge::getTraceId() const noexcept try {
+  auto& cache = this->cache();
+  std::lock_guard<ObjectMutex> lock_guard{cache.mutex()};
+  auto& trace_id = cache.trace_id();
+  if (!trace_id.error()) {
+    PyObject* result = trace_id;
+    Py_INCREF(result);
+    return result;
+  }
+  // Checked before reading the id so that an id is only cached if it was
+  // final when read.
+  auto is_provisional = hasProvisionalIds(span_context());
+  PythonObjectWrapper result = toPyId(span_context().ToTraceID());
+  if (result.error()) {
+    return nullptr;
+  }
+  if (!is_provisional) {
+    Py_INCREF(result);
+    trace_id = static_cast<PyObject*>(result);
+  }
+  return result.release();
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to get trace id: %s", e.what());
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getSpanId
+//--------------------------------------------------------------------------------------------------
+PyObject* SpanContextBridge::getSpanId() const noexcept try {
+  auto& cache = this->cache();
+  std::lock_guard<ObjectMutex> lock_guard{cache.mutex()};
+  auto& span_id = cache.span_id();
+  if (!span_id.error()) {
+    PyObject* result = span_id;
+    Py_INCREF(result);
+    return result;
+  }
+  // Checked before reading the id so that an id is only cached if it was
+  // final when read.
+  auto is_provisional = hasProvisionalIds(span_context());
+  PythonObjectWrapper result = toPyId(span_context().ToSpanID());
+  if (result.error()) {
+    return nullptr;
+  }
+  if (!is_provisional) {
+    Py_INCREF(result);
+    span_id = static_cast<PyObject*>(result);
+  }
+  return result.release();
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to get span id: %s", e.what());
+  return nullptr;
+}
 }  // namespace python_bridge_tracer
@@ -4,8 +4,10 @@
 
 #include <Python.h>
 
-#include "opentracing/span.h"
+#include "object_mutex.h"
+#include "span_context_cache.h"
 
+#include "opentracing/span.h"
 
 namespace python_bridge_tracer {
 /**
@@ -13,7 +15,8 @@ namespace python_bridge_tracer {
  */
 class SpanContextBridge {
  public:
-   explicit SpanContextBridge(std::shared_ptr<const opentracing::Span> span) noexcept;
+   SpanContextBridge(std::shared_ptr<const opentracing::Span> span,
+                     std::shared_ptr<SpanContextCache> cache) noexcept;
 
    explicit SpanContextBridge(
        std::unique_ptr<const opentracing::SpanContext>&& span_context) noexcept;
@@ -28,8 +31,27 @@ class SpanContextBridge {
     */
    PyObject* getBaggageAsPyDict() const noexcept;
 
+   /**
+    * @return the span context's trace id as a python string or Py_None if the
+    * tracer doesn't provide one.
+    */
+   PyObject* getTraceId() const noexcept;
+
+   /**
+    * @return the span context's span id as a python string or Py_None if the
+    * tracer doesn't provide one.
+    */
+   PyObject* getSpanId() const noexcept;
+
+   /**
+    * @return the cache of python objects derived from the span context.
+    */
+   SpanContextCache& cache() const noexcept;
+
  private:
    std::shared_ptr<const opentracing::Span> span_;
    std::shared_ptr<const opentracing::SpanContext> span_context_;
+   mutable ObjectMutex mutex_;
+   mutable std::shared_ptr<SpanContextCache> cache_;
 };
 } // namespace python_bridge_tracer
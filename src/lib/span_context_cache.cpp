@@ -0,0 +1,20 @@
+#include "span_context_cache.h"
+
+#include <mutex>
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// invalidate
+//--------------------------------------------------------------------------------------------------
+void SpanContextCache::invalidate() noexcept {
+  // Release the entries after unlocking.
+  std::shared_ptr<const KeyValues> text_map;
+  std::shared_ptr<const KeyValues> http_headers;
+  std::shared_ptr<const std::string> binary;
+  std::lock_guard<ObjectMutex> lock_guard{mutex_};
+  text_map.swap(text_map_);
+  http_headers.swap(http_headers_);
+  binary.swap(binary_);
+  ++generation_;
+}
+} // namespace python_bridge_tracer
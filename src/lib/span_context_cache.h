@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Python.h>
+
+#include "object_mutex.h"
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+namespace python_bridge_tracer {
+/**
+ * Caches the results of injecting a span context so that repeated injections
+ * of the same context can skip the vendor's serialization, along with the
+ * python strings for the context's ids.
+ *
+ * The cache's entries may only be read or replaced while holding the cache's
+ * mutex. An entry is immutable once published, so it can be used after the
+ * mutex is released; injections fill new entries without holding it.
+ */
+class SpanContextCache {
+ public:
+  /**
+   * @return the mutex guarding the cached values
+   */
+  ObjectMutex& mutex() noexcept { return mutex_; }
+
+  /**
+   * Key-values written by a previous text map or http headers injection.
+   */
+  using KeyValues =
+      std::vector<std::pair<PythonObjectWrapper, PythonObjectWrapper>>;
+
+  /**
+   * @return the cached text map injection or nullptr
+   */
+  std::shared_ptr<const KeyValues>& text_map() noexcept { return text_map_; }
+
+  /**
+   * @return the cached http headers injection or nullptr
+   */
+  std::shared_ptr<const KeyValues>& http_headers() noexcept {
+    return http_headers_;
+  }
+
+  /**
+   * @return the bytes written by a cached binary injection or nullptr
+   */
+  std::shared_ptr<const std::string>& binary() noexcept { return binary_; }
+
+  /**
+   * @return a counter that invalidate increments. An entry filled without
+   * holding the mutex is only published if the counter hasn't changed since
+   * the injection started.
+   */
+  uint64_t generation() const noexcept { return generation_; }
+
+  /**
+   * @return the cached python string for the trace id; the wrapper holds
+   * nullptr until the id is first looked up. Provisional ids (see
+   * hasProvisionalIds) aren't cached.
+   */
+  PythonObjectWrapper& trace_id() noexcept { return trace_id_; }
+
+  /**
+   * @return the cached python string for the span id
+   */
+  PythonObjectWrapper& span_id() noexcept { return span_id_; }
+
+  /**
+   * Discard any cached injections. Called when the propagated state of the
+   * span context changes (e.g. a baggage item is set). The ids are kept
+   * since only final ids are cached.
+   */
+  void invalidate() noexcept;
+
+ private:
+  ObjectMutex mutex_;
+  std::shared_ptr<const KeyValues> text_map_;
+  std::shared_ptr<const KeyValues> http_headers_;
+  std::shared_ptr<const std::string> binary_;
+  uint64_t generation_{0};
+  PythonObjectWrapper trace_id_;
+  PythonObjectWrapper span_id_;
+};
+} // namespace python_bridge_tracer
@@ -0,0 +1,696 @@
+#include "tail_sampling_tracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <unordered_map>
+
+namespace python_bridge_tracer {
+using Baggage = std::unordered_map<std::string, std::string>;
+using KeyValues = std::vector<std::pair<std::string, std::string>>;
+
+static const opentracing::string_view ErrorKey{"error"};
+
+//--------------------------------------------------------------------------------------------------
+// TailSampledTrace
+//--------------------------------------------------------------------------------------------------
+struct TailSampledTrace {
+  enum Decision { Undecided, Kept, Discarded };
+
+  std::string trace_id;
+
+  // The propagation headers of the local root's remote parent, if it has one.
+  KeyValues remote_parent;
+
+  // The following are guarded by the tracer's mutex.
+  std::unique_ptr<opentracing::SpanContext> remote_parent_context;
+  Decision decision{Undecided};
+  bool is_error{false};
+  bool has_kept_operation{false};
+  std::vector<std::shared_ptr<TailSampledSpanState>> buffered_spans;
+  bool is_buffered{false};
+  std::list<std::shared_ptr<TailSampledTrace>>::iterator buffered_position;
+};
+
+//--------------------------------------------------------------------------------------------------
+// TailSampledSpanState
+//--------------------------------------------------------------------------------------------------
+struct TailSampledSpanState {
+  std::shared_ptr<TailSampledTrace> trace;
+  std::shared_ptr<TailSampledSpanState> parent;  // nullptr for the local root
+  opentracing::SpanReferenceType reference_type{
+      opentracing::SpanReferenceType::ChildOfRef};
+  std::string span_id;
+  opentracing::SystemTime start_system_timestamp;
+  opentracing::SteadyTime start_steady_timestamp;
+
+  // The following are guarded by mutex.
+  std::mutex mutex;
+  std::string operation_name;
+  std::vector<std::pair<std::string, opentracing::Value>> tags;
+  std::vector<opentracing::LogRecord> logs;
+  Baggage baggage;
+  opentracing::SteadyTime finish_steady_timestamp;
+  bool is_error{false};
+
+  // Guarded by the tracer's mutex. Once set it's never reset.
+  std::unique_ptr<opentracing::Span> vendor_span;
+
+  // The context of vendor_span, published so that ids can be read without
+  // the tracer's mutex.
+  std::atomic<const opentracing::SpanContext*> vendor_context{nullptr};
+};
+
+//--------------------------------------------------------------------------------------------------
+// generateId
+//--------------------------------------------------------------------------------------------------
+static std::string generateId() {
+  thread_local std::mt19937_64 random_number_generator{std::random_device{}()};
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(random_number_generator()));
+  return buffer;
+}
+
+//--------------------------------------------------------------------------------------------------
+// copyValue
+//--------------------------------------------------------------------------------------------------
+// Buffered values may outlive the memory that string views point to.
+static opentracing::Value copyValue(const opentracing::Value& value) {
+  if (value.is<opentracing::string_view>()) {
+    return std::string{value.get<opentracing::string_view>()};
+  }
+  if (value.is<const char*>()) {
+    return std::string{value.get<const char*>()};
+  }
+  return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+// isTrue
+//--------------------------------------------------------------------------------------------------
+static bool isTrue(const opentracing::Value& value) noexcept {
+  return value.is<bool>() && value.get<bool>();
+}
+
+//--------------------------------------------------------------------------------------------------
+// KeyValuesCarrier
+//--------------------------------------------------------------------------------------------------
+namespace {
+class KeyValuesCarrier final : public opentracing::TextMapReader,
+                               public opentracing::TextMapWriter {
+ public:
+  explicit KeyValuesCarrier(KeyValues& key_values) noexcept
+      : key_values_{key_values} {}
+
+  // opentracing::TextMapWriter
+  opentracing::expected<void> Set(opentracing::string_view key,
+                                  opentracing::string_view value) const override {
+    key_values_.emplace_back(key, value);
+    return {};
+  }
+
+  // opentracing::TextMapReader
+  opentracing::expected<void> ForeachKey(
+      std::function<opentracing::expected<void>(opentracing::string_view key,
+                                                opentracing::string_view value)>
+          f) const override {
+    for (auto& key_value : key_values_) {
+      auto result = f(key_value.first, key_value.second);
+      if (!result) {
+        return result;
+      }
+    }
+    return {};
+  }
+
+ private:
+  KeyValues& key_values_;
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// TailSampledSpanContext
+//--------------------------------------------------------------------------------------------------
+namespace {
+class TailSampledSpanContext final : public opentracing::SpanContext {
+ public:
+  explicit TailSampledSpanContext(
+      std::shared_ptr<TailSampledSpanState> span) noexcept
+      : span_{std::move(span)} {}
+
+  const std::shared_ptr<TailSampledSpanState>& span() const noexcept {
+    return span_;
+  }
+
+  void ForeachBaggageItem(
+      std::function<bool(const std::string&, const std::string&)> callback)
+      const override {
+    std::lock_guard<std::mutex> lock_guard{span_->mutex};
+    for (auto& item : span_->baggage) {
+      if (!callback(item.first, item.second)) {
+        return;
+      }
+    }
+  }
+
+  std::string ToTraceID() const noexcept override {
+    auto vendor_context = span_->vendor_context.load(std::memory_order_acquire);
+    if (vendor_context != nullptr) {
+      return vendor_context->ToTraceID();
+    }
+    return span_->trace->trace_id;
+  }
+
+  std::string ToSpanID() const noexcept override {
+    auto vendor_context = span_->vendor_context.load(std::memory_order_acquire);
+    if (vendor_context != nullptr) {
+      return vendor_context->ToSpanID();
+    }
+    return span_->span_id;
+  }
+
+ private:
+  std::shared_ptr<TailSampledSpanState> span_;
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// hasProvisionalIds
+//--------------------------------------------------------------------------------------------------
+bool hasProvisionalIds(const opentracing::SpanContext& span_context) noexcept {
+  auto tail_sampled_span_context =
+      dynamic_cast<const TailSampledSpanContext*>(&span_context);
+  return tail_sampled_span_context != nullptr &&
+         tail_sampled_span_context->span()->vendor_context.load(
+             std::memory_order_acquire) == nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// TailSampledSpan
+//--------------------------------------------------------------------------------------------------
+namespace {
+class TailSampledSpan final : public opentracing::Span {
+ public:
+  TailSampledSpan(std::shared_ptr<const TailSamplingTracer> tracer,
+                  std::shared_ptr<TailSampledSpanState> span) noexcept
+      : tracer_{std::move(tracer)}, span_{std::move(span)}, context_{span_} {}
+
+  ~TailSampledSpan() noexcept override {
+    FinishWithOptions(opentracing::FinishSpanOptions{});
+  }
+
+ private:
+  std::shared_ptr<const TailSamplingTracer> tracer_;
+  std::shared_ptr<TailSampledSpanState> span_;
+  TailSampledSpanContext context_;
+  std::atomic<bool> is_finished_{false};
+
+  void FinishWithOptions(const opentracing::FinishSpanOptions&
+                             finish_span_options) noexcept override {
+    if (is_finished_.exchange(true)) {
+      return;
+    }
+    try {
+      std::lock_guard<std::mutex> lock_guard{span_->mutex};
+      span_->finish_steady_timestamp =
+          finish_span_options.finish_steady_timestamp;
+      if (span_->finish_steady_timestamp == opentracing::SteadyTime{}) {
+        span_->finish_steady_timestamp = opentracing::SteadyClock::now();
+      }
+      for (auto& log_record : finish_span_options.log_records) {
+        span_->logs.emplace_back();
+        auto& log_record_copy = span_->logs.back();
+        log_record_copy.timestamp = log_record.timestamp;
+        for (auto& field : log_record.fields) {
+          log_record_copy.fields.emplace_back(field.first,
+                                              copyValue(field.second));
+        }
+      }
+    } catch (const std::exception& /*e*/) {
+      // Keep the logs that could be copied.
+    }
+    tracer_->finishSpan(span_);
+  }
+
+  void SetOperationName(opentracing::string_view name) noexcept override try {
+    std::lock_guard<std::mutex> lock_guard{span_->mutex};
+    span_->operation_name = name;
+  } catch (const std::exception& /*e*/) {
+  }
+
+  void SetTag(opentracing::string_view key,
+              const opentracing::Value& value) noexcept override try {
+    std::lock_guard<std::mutex> lock_guard{span_->mutex};
+    if (key == ErrorKey) {
+      span_->is_error = isTrue(value);
+    }
+    for (auto& tag : span_->tags) {
+      if (tag.first == key) {
+        tag.second = copyValue(value);
+        return;
+      }
+    }
+    span_->tags.emplace_back(key, copyValue(value));
+  } catch (const std::exception& /*e*/) {
+  }
+
+  void SetBaggageItem(opentracing::string_view restricted_key,
+                      opentracing::string_view value) noexcept override try {
+    std::lock_guard<std::mutex> lock_guard{span_->mutex};
+    span_->baggage[restricted_key] = value;
+  } catch (const std::exception& /*e*/) {
+  }
+
+  std::string BaggageItem(opentracing::string_view restricted_key) const
+      noexcept override try {
+    std::lock_guard<std::mutex> lock_guard{span_->mutex};
+    auto iter = span_->baggage.find(restricted_key);
+    if (iter == span_->baggage.end()) {
+      return {};
+    }
+    return iter->second;
+  } catch (const std::exception& /*e*/) {
+    return {};
+  }
+
+  void Log(std::initializer_list<
+           std::pair<opentracing::string_view, opentracing::Value>>
+               fields) noexcept override try {
+    opentracing::LogRecord log_record;
+    log_record.timestamp = opentracing::SystemClock::now();
+    for (auto& field : fields) {
+      log_record.fields.emplace_back(field.first, copyValue(field.second));
+    }
+    std::lock_guard<std::mutex> lock_guard{span_->mutex};
+    span_->logs.emplace_back(std::move(log_record));
+  } catch (const std::exception& /*e*/) {
+  }
+
+  const opentracing::SpanContext& context() const noexcept override {
+    return context_;
+  }
+
+  const opentracing::Tracer& tracer() const noexcept override {
+    return *tracer_;
+  }
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+TailSamplingTracer::TailSamplingTracer(
+    std::shared_ptr<opentracing::Tracer> tracer, const TracerOptions& options)
+    : tracer_{std::move(tracer)},
+      max_spans_{options.tail_sampling_max_spans},
+      min_duration_{std::chrono::duration_cast<opentracing::SteadyClock::duration>(
+          std::chrono::duration<double>{options.tail_sampling_min_duration})},
+      operations_{options.tail_sampling_operations} {}
+
+//--------------------------------------------------------------------------------------------------
+// destructor
+//--------------------------------------------------------------------------------------------------
+TailSamplingTracer::~TailSamplingTracer() noexcept {
+  // Buffered spans reference their trace so break the cycles.
+  for (auto& trace : buffered_traces_) {
+    trace->buffered_spans.clear();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// getStats
+//--------------------------------------------------------------------------------------------------
+PyObject* TailSamplingTracer::getStats() const noexcept {
+  size_t num_buffered_spans;
+  uint64_t num_traces_kept, num_traces_discarded, num_traces_evicted,
+      num_spans_evicted;
+  {
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    num_buffered_spans = num_buffered_spans_;
+    num_traces_kept = num_traces_kept_;
+    num_traces_discarded = num_traces_discarded_;
+    num_traces_evicted = num_traces_evicted_;
+    num_spans_evicted = num_spans_evicted_;
+  }
+  return Py_BuildValue(
+      "{s:n,s:n,s:K,s:K,s:K,s:K}", "capacity",
+      static_cast<Py_ssize_t>(max_spans_), "buffered_spans",
+      static_cast<Py_ssize_t>(num_buffered_spans), "kept_traces",
+      static_cast<unsigned long long>(num_traces_kept), "discarded_traces",
+      static_cast<unsigned long long>(num_traces_discarded), "evicted_traces",
+      static_cast<unsigned long long>(num_traces_evicted), "evicted_spans",
+      static_cast<unsigned long long>(num_spans_evicted));
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishSpan
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::finishSpan(
+    const std::shared_ptr<TailSampledSpanState>& span) const noexcept try {
+  std::lock_guard<std::mutex> lock_guard{mutex_};
+  auto& trace = *span->trace;
+  opentracing::SteadyClock::duration duration;
+  {
+    std::lock_guard<std::mutex> span_lock_guard{span->mutex};
+    trace.is_error = trace.is_error || span->is_error;
+    trace.has_kept_operation =
+        trace.has_kept_operation ||
+        std::find(operations_.begin(), operations_.end(),
+                  span->operation_name) != operations_.end();
+    duration = span->finish_steady_timestamp - span->start_steady_timestamp;
+  }
+  switch (trace.decision) {
+    case TailSampledTrace::Kept:
+      replay(*span);
+      return;
+    case TailSampledTrace::Discarded:
+      return;
+    case TailSampledTrace::Undecided:
+      break;
+  }
+  if (span->parent != nullptr) {
+    // An error or kept operation decides the trace, so keep it now rather
+    // than buffer spans that could be evicted.
+    if (trace.is_error || trace.has_kept_operation) {
+      keepTrace(trace);
+      replay(*span);
+    } else {
+      bufferSpan(span);
+    }
+    return;
+  }
+  if (isKeptTrace(trace, duration)) {
+    keepTrace(trace);
+    replay(*span);
+  } else {
+    discardTrace(trace);
+  }
+} catch (const std::exception& /*e*/) {
+  // Drop the span if it can't be buffered or replayed.
+}
+
+//--------------------------------------------------------------------------------------------------
+// materializeSpan
+//--------------------------------------------------------------------------------------------------
+opentracing::Span* TailSamplingTracer::materializeSpan(
+    TailSampledSpanState& span) const noexcept try {
+  std::lock_guard<std::mutex> lock_guard{mutex_};
+  auto& trace = *span.trace;
+  if (trace.decision == TailSampledTrace::Discarded) {
+    return nullptr;
+  }
+  if (trace.decision == TailSampledTrace::Undecided) {
+    keepTrace(trace);
+  }
+  auto vendor_span = materialize(span);
+  if (vendor_span == nullptr) {
+    return nullptr;
+  }
+  // Baggage may have been set since the span was started.
+  std::lock_guard<std::mutex> span_lock_guard{span.mutex};
+  for (auto& item : span.baggage) {
+    vendor_span->SetBaggageItem(item.first, item.second);
+  }
+  return vendor_span;
+} catch (const std::exception& /*e*/) {
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// isKeptTrace
+//--------------------------------------------------------------------------------------------------
+bool TailSamplingTracer::isKeptTrace(
+    const TailSampledTrace& trace,
+    opentracing::SteadyClock::duration duration) const noexcept {
+  if (trace.is_error || trace.has_kept_operation) {
+    return true;
+  }
+  return min_duration_ > opentracing::SteadyClock::duration::zero() &&
+         duration >= min_duration_;
+}
+
+//--------------------------------------------------------------------------------------------------
+// keepTrace
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::keepTrace(TailSampledTrace& trace) const {
+  trace.decision = TailSampledTrace::Kept;
+  ++num_traces_kept_;
+  auto buffered_spans = std::move(trace.buffered_spans);
+  unbufferTrace(trace);
+  num_buffered_spans_ -= buffered_spans.size();
+  for (auto& span : buffered_spans) {
+    replay(*span);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// discardTrace
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::discardTrace(TailSampledTrace& trace) const noexcept {
+  trace.decision = TailSampledTrace::Discarded;
+  ++num_traces_discarded_;
+  unbufferTrace(trace);
+  num_buffered_spans_ -= trace.buffered_spans.size();
+  trace.buffered_spans.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+// unbufferTrace
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::unbufferTrace(TailSampledTrace& trace) const noexcept {
+  if (!trace.is_buffered) {
+    return;
+  }
+  trace.is_buffered = false;
+  buffered_traces_.erase(trace.buffered_position);
+}
+
+//--------------------------------------------------------------------------------------------------
+// bufferSpan
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::bufferSpan(
+    const std::shared_ptr<TailSampledSpanState>& span) const {
+  auto& trace = *span->trace;
+  if (!trace.is_buffered) {
+    buffered_traces_.push_back(span->trace);
+    trace.buffered_position = std::prev(buffered_traces_.end());
+    trace.is_buffered = true;
+  }
+  trace.buffered_spans.push_back(span);
+  ++num_buffered_spans_;
+  while (num_buffered_spans_ > max_spans_) {
+    auto& evicted_trace = *buffered_traces_.front();
+    evicted_trace.decision = TailSampledTrace::Discarded;
+    ++num_traces_evicted_;
+    num_spans_evicted_ += evicted_trace.buffered_spans.size();
+    num_buffered_spans_ -= evicted_trace.buffered_spans.size();
+    evicted_trace.buffered_spans.clear();
+    unbufferTrace(evicted_trace);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// materialize
+//--------------------------------------------------------------------------------------------------
+opentracing::Span* TailSamplingTracer::materialize(
+    TailSampledSpanState& span) const {
+  if (span.vendor_span != nullptr) {
+    return span.vendor_span.get();
+  }
+  auto& trace = *span.trace;
+  opentracing::StartSpanOptions options;
+  options.start_system_timestamp = span.start_system_timestamp;
+  options.start_steady_timestamp = span.start_steady_timestamp;
+  if (span.parent != nullptr) {
+    auto parent = materialize(*span.parent);
+    if (parent != nullptr) {
+      options.references.emplace_back(span.reference_type, &parent->context());
+    }
+  } else if (!trace.remote_parent.empty()) {
+    if (trace.remote_parent_context == nullptr) {
+      auto span_context_maybe = tracer_->Extract(
+          static_cast<const opentracing::TextMapReader&>(
+              KeyValuesCarrier{trace.remote_parent}));
+      if (span_context_maybe) {
+        trace.remote_parent_context = std::move(*span_context_maybe);
+      }
+    }
+    if (trace.remote_parent_context != nullptr) {
+      options.references.emplace_back(span.reference_type,
+                                      trace.remote_parent_context.get());
+    }
+  }
+  std::lock_guard<std::mutex> lock_guard{span.mutex};
+  span.vendor_span =
+      tracer_->StartSpanWithOptions(span.operation_name, options);
+  if (span.vendor_span == nullptr) {
+    return nullptr;
+  }
+  span.vendor_context.store(&span.vendor_span->context(),
+                            std::memory_order_release);
+  for (auto& item : span.baggage) {
+    span.vendor_span->SetBaggageItem(item.first, item.second);
+  }
+  return span.vendor_span.get();
+}
+
+//--------------------------------------------------------------------------------------------------
+// replay
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::replay(TailSampledSpanState& span) const {
+  auto was_materialized = span.vendor_span != nullptr;
+  auto vendor_span = materialize(span);
+  if (vendor_span == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock_guard{span.mutex};
+  if (was_materialized) {
+    // The operation name may have changed after the span was started.
+    vendor_span->SetOperationName(span.operation_name);
+  }
+  for (auto& tag : span.tags) {
+    vendor_span->SetTag(tag.first, tag.second);
+  }
+  opentracing::FinishSpanOptions finish_span_options;
+  finish_span_options.finish_steady_timestamp = span.finish_steady_timestamp;
+  finish_span_options.log_records = std::move(span.logs);
+  vendor_span->FinishWithOptions(finish_span_options);
+}
+
+//--------------------------------------------------------------------------------------------------
+// StartSpanWithOptions
+//--------------------------------------------------------------------------------------------------
+std::unique_ptr<opentracing::Span> TailSamplingTracer::StartSpanWithOptions(
+    opentracing::string_view operation_name,
+    const opentracing::StartSpanOptions& options) const noexcept try {
+  auto span = std::make_shared<TailSampledSpanState>();
+  for (auto& reference : options.references) {
+    auto span_context =
+        dynamic_cast<const TailSampledSpanContext*>(reference.second);
+    if (span_context == nullptr) {
+      continue;
+    }
+    span->parent = span_context->span();
+    span->trace = span->parent->trace;
+    span->reference_type = reference.first;
+    std::lock_guard<std::mutex> lock_guard{span->parent->mutex};
+    span->baggage = span->parent->baggage;
+    break;
+  }
+  if (span->trace == nullptr) {
+    span->trace = std::make_shared<TailSampledTrace>();
+    for (auto& reference : options.references) {
+      if (reference.second == nullptr) {
+        continue;
+      }
+      // Keep the remote parent's propagation headers so that the local root
+      // can reference it when it's replayed.
+      auto& trace = *span->trace;
+      auto was_successful = tracer_->Inject(
+          *reference.second, static_cast<const opentracing::TextMapWriter&>(
+                                 KeyValuesCarrier{trace.remote_parent}));
+      if (!was_successful) {
+        trace.remote_parent.clear();
+        continue;
+      }
+      trace.trace_id = reference.second->ToTraceID();
+      span->reference_type = reference.first;
+      reference.second->ForeachBaggageItem(
+          [&span](const std::string& key, const std::string& value) {
+            span->baggage.emplace(key, value);
+            return true;
+          });
+      break;
+    }
+    if (span->trace->trace_id.empty()) {
+      span->trace->trace_id = generateId();
+    }
+  }
+  span->span_id = generateId();
+  span->operation_name = operation_name;
+  span->start_system_timestamp = options.start_system_timestamp;
+  span->start_steady_timestamp = options.start_steady_timestamp;
+  if (span->start_system_timestamp == opentracing::SystemTime{}) {
+    span->start_system_timestamp = opentracing::SystemClock::now();
+  }
+  if (span->start_steady_timestamp == opentracing::SteadyTime{}) {
+    span->start_steady_timestamp =
+        options.start_system_timestamp == opentracing::SystemTime{}
+            ? opentracing::SteadyClock::now()
+            : opentracing::convert_time_point<opentracing::SteadyClock>(
+                  span->start_system_timestamp);
+  }
+  span->tags.reserve(options.tags.size());
+  for (auto& tag : options.tags) {
+    if (tag.first == ErrorKey) {
+      span->is_error = isTrue(tag.second);
+    }
+    span->tags.emplace_back(tag.first, copyValue(tag.second));
+  }
+  return std::unique_ptr<opentracing::Span>{
+      new TailSampledSpan{shared_from_this(), std::move(span)}};
+} catch (const std::exception& /*e*/) {
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Inject
+//--------------------------------------------------------------------------------------------------
+template <class Carrier>
+opentracing::expected<void> TailSamplingTracer::injectImpl(
+    const opentracing::SpanContext& sc, Carrier& writer) const {
+  auto span_context = dynamic_cast<const TailSampledSpanContext*>(&sc);
+  if (span_context == nullptr) {
+    return tracer_->Inject(sc, writer);
+  }
+  auto vendor_span = materializeSpan(*span_context->span());
+  if (vendor_span == nullptr) {
+    // The trace was already discarded so there's nothing to propagate.
+    return {};
+  }
+  return tracer_->Inject(vendor_span->context(), writer);
+}
+
+opentracing::expected<void> TailSamplingTracer::Inject(
+    const opentracing::SpanContext& sc, std::ostream& writer) const {
+  return injectImpl(sc, writer);
+}
+
+opentracing::expected<void> TailSamplingTracer::Inject(
+    const opentracing::SpanContext& sc,
+    const opentracing::TextMapWriter& writer) const {
+  return injectImpl(sc, writer);
+}
+
+opentracing::expected<void> TailSamplingTracer::Inject(
+    const opentracing::SpanContext& sc,
+    const opentracing::HTTPHeadersWriter& writer) const {
+  return injectImpl(sc, writer);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Extract
+//--------------------------------------------------------------------------------------------------
+opentracing::expected<std::unique_ptr<opentracing::SpanContext>>
+TailSamplingTracer::Extract(std::istream& reader) const {
+  return tracer_->Extract(reader);
+}
+
+opentracing::expected<std::unique_ptr<opentracing::SpanContext>>
+TailSamplingTracer::Extract(const opentracing::TextMapReader& reader) const {
+  return tracer_->Extract(reader);
+}
+
+opentracing::expected<std::unique_ptr<opentracing::SpanContext>>
+TailSamplingTracer::Extract(const opentracing::HTTPHeadersReader& reader) const {
+  return tracer_->Extract(reader);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Close
+//--------------------------------------------------------------------------------------------------
+void TailSamplingTracer::Close() noexcept { tracer_->Close(); }
+} // namespace python_bridge_tracer
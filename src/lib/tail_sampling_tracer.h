@@ -0,0 +1,162 @@
+#pragma once
+
+#include <Python.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "python_bridge_tracer/tracer_options.h"
+
+#include "opentracing/tracer.h"
+
+namespace python_bridge_tracer {
+struct TailSampledTrace;
+struct TailSampledSpanState;
+
+/**
+ * Wraps a tracer so that spans reach it only after the trace they belong to
+ * is chosen to be kept.
+ *
+ * Spans are recorded natively and, when finished, buffered by trace. A trace
+ * is kept as soon as one of its finished spans was tagged as an error or had
+ * one of the configured operation names. Otherwise, when the local root of the
+ * trace (the span without a parent started by this tracer) finishes, the trace
+ * is kept if the local root took at least the configured duration. The spans
+ * of kept traces are replayed into the wrapped tracer with their original
+ * timestamps; the rest are discarded.
+ *
+ * Injecting a span context keeps its trace since downstream services will
+ * reference it; the span and its ancestors are started in the wrapped tracer
+ * at that point so that its propagation format is used.
+ *
+ * Until a span is started in the wrapped tracer, its span context reports
+ * provisional ids: a generated span id and either the remote parent's trace
+ * id or a generated one. Once the trace is kept, the wrapped tracer's ids are
+ * reported instead. The bridge doesn't cache provisional ids (see
+ * hasProvisionalIds), so ids read again after the context is injected are the
+ * wrapped tracer's.
+ *
+ * The number of finished spans buffered is bounded: when it's exceeded the
+ * oldest undecided traces are evicted. Traces that will be kept are never
+ * buffered, so they aren't evicted.
+ */
+class TailSamplingTracer final
+    : public opentracing::Tracer,
+      public std::enable_shared_from_this<TailSamplingTracer> {
+ public:
+  /**
+   * @param tracer the tracer kept traces are replayed into
+   * @param options the options with the sampling rules and buffer size
+   */
+  TailSamplingTracer(std::shared_ptr<opentracing::Tracer> tracer,
+                     const TracerOptions& options);
+
+  TailSamplingTracer(const TailSamplingTracer&) = delete;
+  TailSamplingTracer& operator=(const TailSamplingTracer&) = delete;
+
+  ~TailSamplingTracer() noexcept override;
+
+  /**
+   * @return the wrapped tracer
+   */
+  opentracing::Tracer& tracer() noexcept { return *tracer_; }
+
+  /**
+   * @return a dictionary with the buffer's counters
+   */
+  PyObject* getStats() const noexcept;
+
+  /**
+   * Decide the fate of a finished span. Called by the tracer's spans.
+   * @param span the finished span
+   */
+  void finishSpan(
+      const std::shared_ptr<TailSampledSpanState>& span) const noexcept;
+
+  /**
+   * Keep a span's trace and start the span in the wrapped tracer if it
+   * isn't already. Called by the tracer's spans.
+   * @param span the span to start
+   * @return the span in the wrapped tracer or nullptr if its trace was
+   * discarded
+   */
+  opentracing::Span* materializeSpan(
+      TailSampledSpanState& span) const noexcept;
+
+  std::unique_ptr<opentracing::Span> StartSpanWithOptions(
+      opentracing::string_view operation_name,
+      const opentracing::StartSpanOptions& options) const noexcept override;
+
+  opentracing::expected<void> Inject(const opentracing::SpanContext& sc,
+                                     std::ostream& writer) const override;
+
+  opentracing::expected<void> Inject(
+      const opentracing::SpanContext& sc,
+      const opentracing::TextMapWriter& writer) const override;
+
+  opentracing::expected<void> Inject(
+      const opentracing::SpanContext& sc,
+      const opentracing::HTTPHeadersWriter& writer) const override;
+
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> Extract(
+      std::istream& reader) const override;
+
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> Extract(
+      const opentracing::TextMapReader& reader) const override;
+
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> Extract(
+      const opentracing::HTTPHeadersReader& reader) const override;
+
+  void Close() noexcept override;
+
+ private:
+  std::shared_ptr<opentracing::Tracer> tracer_;
+  size_t max_spans_;
+  opentracing::SteadyClock::duration min_duration_;
+  std::vector<std::string> operations_;
+
+  // Guards the traces' buffers and decisions and the spans started in the
+  // wrapped tracer.
+  mutable std::mutex mutex_;
+
+  // Undecided traces with buffered spans, oldest first.
+  mutable std::list<std::shared_ptr<TailSampledTrace>> buffered_traces_;
+  mutable size_t num_buffered_spans_{0};
+
+  mutable uint64_t num_traces_kept_{0};
+  mutable uint64_t num_traces_discarded_{0};
+  mutable uint64_t num_traces_evicted_{0};
+  mutable uint64_t num_spans_evicted_{0};
+
+  // The following require mutex_ to be held.
+  bool isKeptTrace(const TailSampledTrace& trace,
+                   opentracing::SteadyClock::duration duration) const noexcept;
+
+  void keepTrace(TailSampledTrace& trace) const;
+
+  void discardTrace(TailSampledTrace& trace) const noexcept;
+
+  void unbufferTrace(TailSampledTrace& trace) const noexcept;
+
+  void bufferSpan(const std::shared_ptr<TailSampledSpanState>& span) const;
+
+  opentracing::Span* materialize(TailSampledSpanState& span) const;
+
+  void replay(TailSampledSpanState& span) const;
+
+  template <class Carrier>
+  opentracing::expected<void> injectImpl(const opentracing::SpanContext& sc,
+                                         Carrier& writer) const;
+};
+
+/**
+ * @param span_context the span context to check
+ * @return true if span_context belongs to a TailSamplingTracer span that
+ * hasn't been started in the wrapped tracer, so its ids may still change
+ */
+bool hasProvisionalIds(const opentracing::SpanContext& span_context) noexcept;
+} // namespace python_bridge_tracer
@@ -11,20 +11,30 @@ namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
 // pyStringToString
 //--------------------------------------------------------------------------------------------------
-static bool pyStringToString(PyObject* object, std::string& result) noexcept {
-  PythonStringWrapper str{object};
+static bool pyStringToString(
+    PyObject* object, std::string& result, size_t max_length,
+    opentracing::string_view truncation_marker) noexcept try {
+  PythonStringWrapper str{object, max_length};
   if (str.error()) {
     return false;
   }
   auto sv = static_cast<opentracing::string_view>(str);
   result.assign(sv.data(), sv.size());
+  if (str.truncated()) {
+    result.append(truncation_marker.data(), truncation_marker.size());
+  }
   return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to convert string: %s", e.what());
+  return false;
 }
 
 //--------------------------------------------------------------------------------------------------
 // convertToString
 //--------------------------------------------------------------------------------------------------
-static bool convertToString(PyObject* object, std::string& result) noexcept {
+static bool convertToString(PyObject* object, std::string& result,
+                            size_t max_length,
+                            opentracing::string_view truncation_marker) noexcept {
   PythonObjectWrapper str_function = getModuleAttribute(BuiltinModule, "str");
   if (str_function.error()) {
     return false;
@@ -37,15 +47,16 @@ static bool convertToString(PyObject* object, std::string& result) noexcept {
   if (str_result.error()) {
     return false;
   }
-  return pyStringToString(str_result, result);
+  return pyStringToString(str_result, result, max_length, truncation_marker);
 }
 
 //--------------------------------------------------------------------------------------------------
 // toString
 //--------------------------------------------------------------------------------------------------
-bool toString(PyObject* object, std::string& result) noexcept {
+bool toString(PyObject* object, std::string& result, size_t max_length,
+              opentracing::string_view truncation_marker) noexcept try {
   if(isString(object)) {
-    return pyStringToString(object, result);
+    return pyStringToString(object, result, max_length, truncation_marker);
   }
   if (PyBytes_Check(object) == 1) {
     char* data;
@@ -53,9 +64,17 @@ bool toString(PyObject* object, std::string& result) noexcept {
     if (PyBytes_AsStringAndSize(object, &data, &length) == -1) {
       return false;
     }
+    if (max_length > 0 && static_cast<size_t>(length) > max_length) {
+      result.assign(data, max_length);
+      result.append(truncation_marker.data(), truncation_marker.size());
+      return true;
+    }
     result.assign(data, static_cast<size_t>(length));
     return true;
   }
-  return convertToString(object, result);
+  return convertToString(object, result, max_length, truncation_marker);
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to convert to string: %s", e.what());
+  return false;
 }
 } // namespace python_bridge_tracer
@@ -4,6 +4,19 @@
 
 #include <Python.h>
 
+#include "opentracing/string_view.h"
+
 namespace python_bridge_tracer {
-bool toString(PyObject* object, std::string& result) noexcept;
+/**
+ * Convert a python object to a string, calling str on it if it isn't a string
+ * or bytes.
+ * @param object the object to convert
+ * @param result the converted string
+ * @param max_length if non-zero, the converted string is cut to this length
+ * and truncation_marker is appended
+ * @param truncation_marker appended to a truncated string
+ * @return true if successful
+ */
+bool toString(PyObject* object, std::string& result, size_t max_length = 0,
+              opentracing::string_view truncation_marker = {}) noexcept;
 } // namespace python_bridge_tracer
@@ -0,0 +1,569 @@
+#include "traced.h"
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "python_bridge_tracer/module.h"
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/type.h"
+#include "python_bridge_tracer/utility.h"
+#include "python_bridge_tracer/version.h"
+#include "module_state.h"
+#include "tracer.h"
+
+namespace python_bridge_tracer {
+// The code flag of coroutine functions (CO_COROUTINE).
+const long CoroutineCodeFlag = 0x80;
+
+//--------------------------------------------------------------------------------------------------
+// TracedObject
+//--------------------------------------------------------------------------------------------------
+namespace {
+struct TracedObject {
+  // clang-format off
+  PyObject_HEAD
+  PyObject* tracer;
+  std::string* operation_name;
+  PyObject* tags;
+  PyObject* function;
+  bool is_coroutine_function;
+  // clang-format on
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// TracedCoroutineObject
+//--------------------------------------------------------------------------------------------------
+namespace {
+struct TracedCoroutineObject {
+  // clang-format off
+  PyObject_HEAD
+  TracedObject* traced;
+  PyObject* coroutine;
+  PyObject* scope;
+  PyObject* span;
+  bool is_finished;
+  // clang-format on
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// deallocTraced
+//--------------------------------------------------------------------------------------------------
+static void deallocTraced(TracedObject* self) noexcept {
+  PyObject_GC_UnTrack(self);
+  Py_DECREF(self->tracer);
+  delete self->operation_name;
+  Py_XDECREF(self->tags);
+  Py_XDECREF(self->function);
+  PyObject_GC_Del(self);
+}
+
+//--------------------------------------------------------------------------------------------------
+// traverseTraced
+//--------------------------------------------------------------------------------------------------
+static int traverseTraced(TracedObject* self, visitproc visit,
+                          void* arg) noexcept {
+  Py_VISIT(self->tracer);
+  Py_VISIT(self->tags);
+  Py_VISIT(self->function);
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// clearTraced
+//--------------------------------------------------------------------------------------------------
+// Functions reference their module through __globals__, so decorating a
+// module level function is a cycle.
+static int clearTraced(TracedObject* self) noexcept {
+  Py_CLEAR(self->tags);
+  Py_CLEAR(self->function);
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// deallocTracedCoroutine
+//--------------------------------------------------------------------------------------------------
+static void deallocTracedCoroutine(TracedCoroutineObject* self) noexcept {
+  PyObject_GC_UnTrack(self);
+  Py_DECREF(self->traced);
+  Py_XDECREF(self->coroutine);
+  Py_XDECREF(self->scope);
+  Py_XDECREF(self->span);
+  PyObject_GC_Del(self);
+}
+
+//--------------------------------------------------------------------------------------------------
+// traverseTracedCoroutine
+//--------------------------------------------------------------------------------------------------
+static int traverseTracedCoroutine(TracedCoroutineObject* self,
+                                   visitproc visit, void* arg) noexcept {
+  Py_VISIT(self->traced);
+  Py_VISIT(self->coroutine);
+  Py_VISIT(self->scope);
+  Py_VISIT(self->span);
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// clearTracedCoroutine
+//--------------------------------------------------------------------------------------------------
+static int clearTracedCoroutine(TracedCoroutineObject* self) noexcept {
+  Py_CLEAR(self->coroutine);
+  Py_CLEAR(self->scope);
+  Py_CLEAR(self->span);
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishCall
+//--------------------------------------------------------------------------------------------------
+// Finish a call's span, recording the exception it raised if any. Returns
+// false if an exception is set afterwards.
+static bool finishCall(PyObject* scope, PyObject* span,
+                       bool is_coroutine) noexcept {
+  if (PyErr_Occurred() == nullptr) {
+    return finishActiveScope(scope, span, Py_None, Py_None);
+  }
+  PyObject *exc_type, *exc_value, *traceback;
+  PyErr_Fetch(&exc_type, &exc_value, &traceback);
+  PyErr_NormalizeException(&exc_type, &exc_value, &traceback);
+  bool was_finished;
+  // Coroutines signal that they returned by raising StopIteration.
+  if (is_coroutine &&
+      PyErr_GivenExceptionMatches(exc_type, PyExc_StopIteration) != 0) {
+    was_finished = finishActiveScope(scope, span, Py_None, Py_None);
+  } else {
+    was_finished = finishActiveScope(scope, span, exc_type, exc_value);
+  }
+  if (!was_finished) {
+    // Don't replace the call's exception.
+    PyErr_WriteUnraisable(span);
+  }
+  PyErr_Restore(exc_type, exc_value, traceback);
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// isCoroutineFunction
+//--------------------------------------------------------------------------------------------------
+static bool isCoroutineFunction(PyObject* function, bool& result) noexcept {
+  result = false;
+#ifdef PYTHON_BRIDGE_TRACER_PY3
+  PythonObjectWrapper code = PyObject_GetAttrString(function, "__code__");
+  if (code.error()) {
+    // Not a python function; treat it as a regular callable.
+    if (PyErr_ExceptionMatches(PyExc_AttributeError) != 0) {
+      PyErr_Clear();
+      return true;
+    }
+    return false;
+  }
+  PythonObjectWrapper flags_object = PyObject_GetAttrString(code, "co_flags");
+  if (flags_object.error()) {
+    return false;
+  }
+  long flags;
+  if (!toLong(flags_object, flags)) {
+    return false;
+  }
+  result = (flags & CoroutineCodeFlag) != 0;
+#else
+  (void)function;
+#endif
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// newTraced
+//--------------------------------------------------------------------------------------------------
+static TracedObject* newTraced(PyObject* tracer,
+                               opentracing::string_view operation_name,
+                               PyObject* tags) noexcept try {
+  std::unique_ptr<std::string> operation_name_str{
+      new std::string{operation_name.data(), operation_name.size()}};
+  auto result = newPythonGcObject<TracedObject>(
+      getTracerModuleState(tracer).traced_type);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  Py_INCREF(tracer);
+  result->tracer = tracer;
+  result->operation_name = operation_name_str.release();
+  Py_XINCREF(tags);
+  result->tags = tags;
+  result->function = nullptr;
+  result->is_coroutine_function = false;
+  PyObject_GC_Track(result);
+  return result;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "%s", e.what());
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// decorate
+//--------------------------------------------------------------------------------------------------
+static PyObject* decorate(TracedObject* self, PyObject* args,
+                          PyObject* keywords) noexcept {
+  PyObject* function;
+  if (PyArg_UnpackTuple(args, "traced", 1, 1, &function) == 0) {
+    return nullptr;
+  }
+  if (keywords != nullptr && PyDict_Size(keywords) != 0) {
+    PyErr_Format(PyExc_TypeError, "traced takes no keyword arguments");
+    return nullptr;
+  }
+  if (PyCallable_Check(function) == 0) {
+    PyErr_Format(PyExc_TypeError, "traced can only decorate a callable");
+    return nullptr;
+  }
+  bool is_coroutine_function;
+  if (!isCoroutineFunction(function, is_coroutine_function)) {
+    return nullptr;
+  }
+  auto result = newTraced(self->tracer, *self->operation_name, self->tags);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  Py_INCREF(function);
+  result->function = function;
+  result->is_coroutine_function = is_coroutine_function;
+  return reinterpret_cast<PyObject*>(result);
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeTracedCoroutine
+//--------------------------------------------------------------------------------------------------
+static PyObject* makeTracedCoroutine(TracedObject* traced,
+                                     PythonObjectWrapper coroutine) noexcept {
+  auto result = newPythonGcObject<TracedCoroutineObject>(
+      getTracerModuleState(traced->tracer).traced_coroutine_type);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  Py_INCREF(traced);
+  result->traced = traced;
+  result->coroutine = coroutine.release();
+  result->scope = nullptr;
+  result->span = nullptr;
+  result->is_finished = false;
+  PyObject_GC_Track(result);
+  return reinterpret_cast<PyObject*>(result);
+}
+
+//--------------------------------------------------------------------------------------------------
+// callTraced
+//--------------------------------------------------------------------------------------------------
+static PyObject* callTraced(TracedObject* self, PyObject* args,
+                            PyObject* keywords) noexcept {
+  if (self->function == nullptr) {
+    return decorate(self, args, keywords);
+  }
+  if (self->is_coroutine_function) {
+    // The span is started when the coroutine is first resumed.
+    PythonObjectWrapper coroutine =
+        PyObject_Call(self->function, args, keywords);
+    if (coroutine.error()) {
+      return nullptr;
+    }
+    return makeTracedCoroutine(self, std::move(coroutine));
+  }
+  PythonObjectWrapper span;
+  PythonObjectWrapper scope =
+      startActiveScope(self->tracer, *self->operation_name, self->tags, span);
+  if (scope.error()) {
+    return nullptr;
+  }
+  PythonObjectWrapper result = PyObject_Call(self->function, args, keywords);
+  if (!finishCall(scope, span, false)) {
+    return nullptr;
+  }
+  return result.release();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getTracedDescriptor
+//--------------------------------------------------------------------------------------------------
+static PyObject* getTracedDescriptor(TracedObject* self, PyObject* object,
+                                     PyObject* /*type*/) noexcept {
+  // Bind to instances like a function so that methods can be traced.
+  if (object == nullptr || object == Py_None) {
+    Py_INCREF(self);
+    return reinterpret_cast<PyObject*>(self);
+  }
+  return PyObject_CallFunctionObjArgs(
+      getTracerModuleState(self->tracer).method_type, self, object, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getWrapped
+//--------------------------------------------------------------------------------------------------
+static PyObject* getWrapped(TracedObject* self, void* /*ignored*/) noexcept {
+  if (self->function == nullptr) {
+    Py_RETURN_NONE;
+  }
+  Py_INCREF(self->function);
+  return self->function;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getName
+//--------------------------------------------------------------------------------------------------
+static PyObject* getName(TracedObject* self, void* /*ignored*/) noexcept {
+  if (self->function == nullptr) {
+    return toPyString(*self->operation_name);
+  }
+  return PyObject_GetAttrString(self->function, "__name__");
+}
+
+//--------------------------------------------------------------------------------------------------
+// getFunctionAttribute
+//--------------------------------------------------------------------------------------------------
+static PyObject* getFunctionAttribute(TracedObject* self,
+                                      const char* name) noexcept {
+  if (self->function == nullptr) {
+    PyErr_Format(PyExc_AttributeError, "%s", name);
+    return nullptr;
+  }
+  return PyObject_GetAttrString(self->function, name);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getCode
+//--------------------------------------------------------------------------------------------------
+// inspect treats objects with a function's attributes like a function, which
+// lets frameworks recognize traced coroutine functions.
+static PyObject* getCode(TracedObject* self, void* /*ignored*/) noexcept {
+  return getFunctionAttribute(self, "__code__");
+}
+
+//--------------------------------------------------------------------------------------------------
+// getDefaults
+//--------------------------------------------------------------------------------------------------
+static PyObject* getDefaults(TracedObject* self, void* /*ignored*/) noexcept {
+  return getFunctionAttribute(self, "__defaults__");
+}
+
+//--------------------------------------------------------------------------------------------------
+// getKwdefaults
+//--------------------------------------------------------------------------------------------------
+static PyObject* getKwdefaults(TracedObject* self,
+                               void* /*ignored*/) noexcept {
+  return getFunctionAttribute(self, "__kwdefaults__");
+}
+
+//--------------------------------------------------------------------------------------------------
+// getAnnotations
+//--------------------------------------------------------------------------------------------------
+static PyObject* getAnnotations(TracedObject* self,
+                                void* /*ignored*/) noexcept {
+  return getFunctionAttribute(self, "__annotations__");
+}
+
+//--------------------------------------------------------------------------------------------------
+// getIsCoroutine
+//--------------------------------------------------------------------------------------------------
+// The marker asyncio.iscoroutinefunction checks for on versions where inspect
+// only recognizes functions.
+static PyObject* getIsCoroutine(TracedObject* self,
+                                void* /*ignored*/) noexcept {
+  if (!self->is_coroutine_function) {
+    PyErr_Format(PyExc_AttributeError, "_is_coroutine");
+    return nullptr;
+  }
+  return getModuleAttribute("asyncio.coroutines", "_is_coroutine");
+}
+
+//--------------------------------------------------------------------------------------------------
+// resumeCoroutine
+//--------------------------------------------------------------------------------------------------
+static PyObject* resumeCoroutine(TracedCoroutineObject* self,
+                                 const char* method_name, PyObject* args,
+                                 bool start_span) noexcept {
+  PythonObjectWrapper args_wrapper{args};
+  if (args_wrapper.error()) {
+    return nullptr;
+  }
+  if (self->coroutine == nullptr) {
+    PyErr_Format(PyExc_RuntimeError, "coroutine was cleared");
+    return nullptr;
+  }
+  if (start_span && self->scope == nullptr && !self->is_finished) {
+    auto traced = self->traced;
+    PythonObjectWrapper span;
+    self->scope = startActiveScope(traced->tracer, *traced->operation_name,
+                                   traced->tags, span);
+    if (self->scope == nullptr) {
+      return nullptr;
+    }
+    self->span = span.release();
+  }
+  PythonObjectWrapper method =
+      PyObject_GetAttrString(self->coroutine, method_name);
+  if (method.error()) {
+    return nullptr;
+  }
+  PythonObjectWrapper result = PyObject_CallObject(method, args_wrapper);
+  if (self->scope == nullptr || (!result.error() && start_span)) {
+    return result.release();
+  }
+  // The coroutine returned, raised or was closed.
+  PythonObjectWrapper scope{self->scope};
+  PythonObjectWrapper span{self->span};
+  self->scope = nullptr;
+  self->span = nullptr;
+  self->is_finished = true;
+  if (!finishCall(scope, span, true)) {
+    return nullptr;
+  }
+  return result.release();
+}
+
+//--------------------------------------------------------------------------------------------------
+// returnSelf
+//--------------------------------------------------------------------------------------------------
+static PyObject* returnSelf(PyObject* self) noexcept {
+  Py_INCREF(self);
+  return self;
+}
+
+//--------------------------------------------------------------------------------------------------
+// nextCoroutine
+//--------------------------------------------------------------------------------------------------
+static PyObject* nextCoroutine(TracedCoroutineObject* self) noexcept {
+  return resumeCoroutine(self, "send", Py_BuildValue("(O)", Py_None), true);
+}
+
+//--------------------------------------------------------------------------------------------------
+// sendCoroutine
+//--------------------------------------------------------------------------------------------------
+static PyObject* sendCoroutine(TracedCoroutineObject* self,
+                               PyObject* value) noexcept {
+  return resumeCoroutine(self, "send", Py_BuildValue("(O)", value), true);
+}
+
+//--------------------------------------------------------------------------------------------------
+// throwCoroutine
+//--------------------------------------------------------------------------------------------------
+static PyObject* throwCoroutine(TracedCoroutineObject* self,
+                                PyObject* args) noexcept {
+  Py_INCREF(args);
+  return resumeCoroutine(self, "throw", args, true);
+}
+
+//--------------------------------------------------------------------------------------------------
+// closeCoroutine
+//--------------------------------------------------------------------------------------------------
+static PyObject* closeCoroutine(TracedCoroutineObject* self) noexcept {
+  return resumeCoroutine(self, "close", PyTuple_New(0), false);
+}
+
+//--------------------------------------------------------------------------------------------------
+// TracedGetSetList
+//--------------------------------------------------------------------------------------------------
+static PyGetSetDef TracedGetSetList[] = {
+    {const_cast<char*>("__wrapped__"), reinterpret_cast<getter>(getWrapped),
+     nullptr, const_cast<char*>(PyDoc_STR("Returns the traced function"))},
+    {const_cast<char*>("__name__"), reinterpret_cast<getter>(getName), nullptr,
+     const_cast<char*>(PyDoc_STR("Returns the traced function's name"))},
+    {const_cast<char*>("__code__"), reinterpret_cast<getter>(getCode), nullptr,
+     const_cast<char*>(PyDoc_STR("Returns the traced function's code"))},
+    {const_cast<char*>("__defaults__"), reinterpret_cast<getter>(getDefaults),
+     nullptr,
+     const_cast<char*>(PyDoc_STR("Returns the traced function's defaults"))},
+    {const_cast<char*>("__kwdefaults__"),
+     reinterpret_cast<getter>(getKwdefaults), nullptr,
+     const_cast<char*>(
+         PyDoc_STR("Returns the traced function's keyword defaults"))},
+    {const_cast<char*>("__annotations__"),
+     reinterpret_cast<getter>(getAnnotations), nullptr,
+     const_cast<char*>(PyDoc_STR("Returns the traced function's annotations"))},
+    {const_cast<char*>("_is_coroutine"),
+     reinterpret_cast<getter>(getIsCoroutine), nullptr,
+     const_cast<char*>(PyDoc_STR("Marks traced coroutine functions"))},
+    {nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// TracedCoroutineMethods
+//--------------------------------------------------------------------------------------------------
+static PyMethodDef TracedCoroutineMethods[] = {
+    {"send", reinterpret_cast<PyCFunction>(sendCoroutine), METH_O,
+     PyDoc_STR("resume the coroutine with a value")},
+    {"throw", reinterpret_cast<PyCFunction>(throwCoroutine), METH_VARARGS,
+     PyDoc_STR("raise an exception in the coroutine")},
+    {"close", reinterpret_cast<PyCFunction>(closeCoroutine), METH_NOARGS,
+     PyDoc_STR("close the coroutine")},
+    {nullptr, nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// makeTraced
+//--------------------------------------------------------------------------------------------------
+PyObject* makeTraced(PyObject* tracer, opentracing::string_view operation_name,
+                     PyObject* tags) noexcept {
+  if (tags == Py_None) {
+    tags = nullptr;
+  }
+  if (tags != nullptr && PyDict_Check(tags) == 0) {
+    PyErr_Format(PyExc_TypeError, "tags must be a dict");
+    return nullptr;
+  }
+  return reinterpret_cast<PyObject*>(newTraced(tracer, operation_name, tags));
+}
+
+//--------------------------------------------------------------------------------------------------
+// setupTracedClasses
+//--------------------------------------------------------------------------------------------------
+bool setupTracedClasses(PyObject* module) noexcept {
+  auto& module_state = getModuleState(module);
+  module_state.method_type = getModuleAttribute("types", "MethodType");
+  if (module_state.method_type == nullptr) {
+    return false;
+  }
+
+  TypeDescription traced_type_description;
+  traced_type_description.name = PYTHON_BRIDGE_TRACER_MODULE "._Traced";
+  traced_type_description.size = sizeof(TracedObject);
+  traced_type_description.doc = toVoidPtr("CppBridgeTraced");
+  traced_type_description.dealloc = toVoidPtr(deallocTraced);
+  traced_type_description.getset = toVoidPtr(TracedGetSetList);
+  traced_type_description.call = toVoidPtr(callTraced);
+  traced_type_description.descr_get = toVoidPtr(getTracedDescriptor);
+  traced_type_description.traverse = toVoidPtr(traverseTraced);
+  traced_type_description.clear = toVoidPtr(clearTraced);
+  auto traced_type = makeType<TracedObject>(traced_type_description);
+  if (traced_type == nullptr) {
+    return false;
+  }
+  Py_INCREF(traced_type);
+  module_state.traced_type = traced_type;
+
+  TypeDescription coroutine_type_description;
+  coroutine_type_description.name =
+      PYTHON_BRIDGE_TRACER_MODULE "._TracedCoroutine";
+  coroutine_type_description.size = sizeof(TracedCoroutineObject);
+  coroutine_type_description.doc = toVoidPtr("CppBridgeTracedCoroutine");
+  coroutine_type_description.dealloc = toVoidPtr(deallocTracedCoroutine);
+  coroutine_type_description.methods = toVoidPtr(TracedCoroutineMethods);
+  coroutine_type_description.iter = toVoidPtr(returnSelf);
+  coroutine_type_description.iternext = toVoidPtr(nextCoroutine);
+  coroutine_type_description.await = toVoidPtr(returnSelf);
+  coroutine_type_description.traverse = toVoidPtr(traverseTracedCoroutine);
+  coroutine_type_description.clear = toVoidPtr(clearTracedCoroutine);
+  auto coroutine_type =
+      makeType<TracedCoroutineObject>(coroutine_type_description);
+  if (coroutine_type == nullptr) {
+    return false;
+  }
+  Py_INCREF(coroutine_type);
+  module_state.traced_coroutine_type = coroutine_type;
+
+  if (PyModule_AddObject(module, "_Traced", traced_type) != 0) {
+    return false;
+  }
+  return PyModule_AddObject(module, "_TracedCoroutine", coroutine_type) == 0;
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Python.h>
+
+#include "opentracing/string_view.h"
+
+namespace python_bridge_tracer {
+/**
+ * Make a decorator that traces calls to the function it's applied to.
+ *
+ * Each call starts a span that's a child of the active span, activates it for
+ * the call's duration and finishes it, recording the exception if the call
+ * raises one. Calls to coroutine functions return a coroutine whose span
+ * covers the time from when it's first resumed until it returns; the span
+ * stays active while it's suspended so a scope manager that tracks the
+ * active span per task should be used.
+ * @param tracer the python tracer to start spans with
+ * @param operation_name the spans' operation name
+ * @param tags the spans' tags or nullptr
+ * @return the python decorator object
+ */
+PyObject* makeTraced(PyObject* tracer, opentracing::string_view operation_name,
+                     PyObject* tags) noexcept;
+
+/**
+ * Setup the python traced function and coroutine classes.
+ * @param module the module to add the classes to
+ * @return true if successful
+ */
+bool setupTracedClasses(PyObject* module) noexcept;
+} // namespace python_bridge_tracer
@@ -1,18 +1,26 @@
 #include "tracer.h"
 
-#include <iostream>
+#include <cmath>
 #include <memory>
+#include <mutex>
 
 #include "python_bridge_tracer/module.h"
 
+#include "auto_instrumentation.h"
+#include "logging_filter.h"
+#include "module_state.h"
+#include "noop_span.h"
+#include "object_mutex.h"
 #include "opentracing_module.h"
+#include "probes.h"
 #include "python_bridge_tracer/python_object_wrapper.h"
 #include "python_bridge_tracer/type.h"
 #include "python_bridge_tracer/utility.h"
 #include "span.h"
+#include "traced.h"
 #include "tracer_bridge.h"
 
-static PyObject* TracerType;
+#include "opentracing/noop.h"
 
 namespace python_bridge_tracer {
 //--------------------------------------------------------------------------------------------------
@@ -22,8 +30,14 @@ namespace {
 struct TracerObject {
   // clang-format off
   PyObject_HEAD
+  PyObject* module;
   TracerBridge* tracer_bridge;
   PyObject* scope_manager;
+  PyObject* noop_span;
+  bool is_noop;
+  PyObject* noop_scope;
+  ObjectMutex auto_instrumentation_mutex;
+  PyObject* auto_instrumentation;
   // clang-format on
 };
 }  // namespace
@@ -32,11 +46,32 @@ struct TracerObject {
 // deallocTracer
 //--------------------------------------------------------------------------------------------------
 static void deallocTracer(TracerObject* self) noexcept {
+  if (self->auto_instrumentation != nullptr) {
+    // The instrumentation only borrows the tracer.
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    if (!stopAutoInstrumentation(self->auto_instrumentation)) {
+      PyErr_WriteUnraisable(self->auto_instrumentation);
+    }
+    PyErr_Restore(type, value, traceback);
+  }
   delete self->tracer_bridge;
   Py_DECREF(self->scope_manager);
+  Py_XDECREF(self->noop_scope);
+  Py_XDECREF(self->auto_instrumentation);
+  detachNoopSpan(self->noop_span);
+  Py_DECREF(self->noop_span);
+  Py_XDECREF(self->module);
   freeSelf(reinterpret_cast<PyObject*>(self));
 }
 
+//--------------------------------------------------------------------------------------------------
+// getTracerModuleState
+//--------------------------------------------------------------------------------------------------
+ModuleState& getTracerModuleState(PyObject* tracer) noexcept {
+  return getModuleState(reinterpret_cast<TracerObject*>(tracer)->module);
+}
+
 //--------------------------------------------------------------------------------------------------
 // activateSpan
 //--------------------------------------------------------------------------------------------------
@@ -54,11 +89,46 @@ static PyObject* activateSpan(TracerObject* self, PyObject* span,
   return PyObject_CallObject(activate_function, args);
 }
 
+//--------------------------------------------------------------------------------------------------
+// activateNewSpan
+//--------------------------------------------------------------------------------------------------
+static PyObject* activateNewSpan(TracerObject* self,
+                                 opentracing::string_view operation_name,
+                                 PyObject* parent, PyObject* references,
+                                 PyObject* tags, double start_time,
+                                 bool ignore_active_span,
+                                 int finish_on_close,
+                                 PythonObjectWrapper& span) noexcept {
+  bool is_rejected;
+  auto span_bridge = self->tracer_bridge->makeSpan(
+      operation_name, self->scope_manager, parent, references, tags,
+      start_time, ignore_active_span, is_rejected);
+  if (is_rejected) {
+    // Activate the no-op span so that spans started within its scope inherit
+    // the decision.
+    Py_INCREF(self->noop_span);
+    span = self->noop_span;
+    return activateSpan(self, span, finish_on_close);
+  }
+  if (span_bridge == nullptr) {
+    return nullptr;
+  }
+  span = makeSpan(std::move(span_bridge), reinterpret_cast<PyObject*>(self));
+  if (span.error()) {
+    return nullptr;
+  }
+  return activateSpan(self, span, finish_on_close);
+}
+
 //--------------------------------------------------------------------------------------------------
 // startActiveSpan
 //--------------------------------------------------------------------------------------------------
 static PyObject* startActiveSpan(TracerObject* self, PyObject* args,
                                  PyObject* keywords) noexcept {
+  if (self->is_noop) {
+    Py_INCREF(self->noop_scope);
+    return self->noop_scope;
+  }
   static char* keyword_names[] = {const_cast<char*>("operation_name"),
                                   const_cast<char*>("child_of"),
                                   const_cast<char*>("references"),
@@ -75,6 +145,8 @@ static PyObject* startActiveSpan(TracerObject* self, PyObject* args,
   double start_time = 0;
   int ignore_active_span = 0;
   int finish_on_close = 1;
+  OverheadScope overhead_scope{self->tracer_bridge->overhead_profile(),
+                               OverheadProfile::StartSpan};
   static const char* const arguments_format =
       "s#"  // operation_name
       "|"
@@ -91,17 +163,74 @@ static PyObject* startActiveSpan(TracerObject* self, PyObject* args,
           &ignore_active_span, &finish_on_close) == 0) {
     return nullptr;
   }
-  auto span_bridge = self->tracer_bridge->makeSpan(
+  PythonObjectWrapper span;
+  return activateNewSpan(
+      self,
       opentracing::string_view{operation_name,
                                static_cast<size_t>(operation_name_length)},
-      self->scope_manager, parent, references, tags, start_time,
-      static_cast<bool>(ignore_active_span));
-  PythonObjectWrapper span =
-      makeSpan(std::move(span_bridge), reinterpret_cast<PyObject*>(self));
-  if (span.error()) {
+      parent, references, tags, start_time,
+      static_cast<bool>(ignore_active_span), finish_on_close, span);
+}
+
+//--------------------------------------------------------------------------------------------------
+// startActiveScope
+//--------------------------------------------------------------------------------------------------
+PyObject* startActiveScope(PyObject* tracer,
+                           opentracing::string_view operation_name,
+                           PyObject* tags, PythonObjectWrapper& span) noexcept {
+  auto self = reinterpret_cast<TracerObject*>(tracer);
+  if (self->is_noop) {
+    Py_INCREF(self->noop_span);
+    span = self->noop_span;
+    Py_INCREF(self->noop_scope);
+    return self->noop_scope;
+  }
+  OverheadScope overhead_scope{self->tracer_bridge->overhead_profile(),
+                               OverheadProfile::StartSpan};
+  return activateNewSpan(self, operation_name, nullptr, nullptr, tags, 0,
+                         false, 0, span);
+}
+
+//--------------------------------------------------------------------------------------------------
+// finishActiveScope
+//--------------------------------------------------------------------------------------------------
+bool finishActiveScope(PyObject* scope, PyObject* span, PyObject* exc_type,
+                       PyObject* exc_value) noexcept {
+  PythonObjectWrapper close_function = PyObject_GetAttrString(scope, "close");
+  if (close_function.error()) {
+    return false;
+  }
+  PythonObjectWrapper result = PyObject_CallObject(close_function, nullptr);
+  if (result.error()) {
+    return false;
+  }
+  // Noop spans have nothing to finish.
+  if (!isSpan(span)) {
+    return true;
+  }
+  return getSpanBridge(span).finishCall(exc_type, exc_value);
+}
+
+//--------------------------------------------------------------------------------------------------
+// traced
+//--------------------------------------------------------------------------------------------------
+static PyObject* traced(TracerObject* self, PyObject* args,
+                        PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("operation_name"),
+                                  const_cast<char*>("tags"), nullptr};
+  const char* operation_name = nullptr;
+  int operation_name_length = 0;
+  PyObject* tags = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "s#|O:traced",
+                                  keyword_names, &operation_name,
+                                  &operation_name_length, &tags) == 0) {
     return nullptr;
   }
-  return activateSpan(self, span, finish_on_close);
+  return makeTraced(
+      reinterpret_cast<PyObject*>(self),
+      opentracing::string_view{operation_name,
+                               static_cast<size_t>(operation_name_length)},
+      tags);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -109,6 +238,10 @@ static PyObject* startActiveSpan(TracerObject* self, PyObject* args,
 //--------------------------------------------------------------------------------------------------
 static PyObject* startSpan(TracerObject* self, PyObject* args,
                            PyObject* keywords) noexcept {
+  if (self->is_noop) {
+    Py_INCREF(self->noop_span);
+    return self->noop_span;
+  }
   static char* keyword_names[] = {const_cast<char*>("operation_name"),
                                   const_cast<char*>("child_of"),
                                   const_cast<char*>("references"),
@@ -123,6 +256,8 @@ static PyObject* startSpan(TracerObject* self, PyObject* args,
   PyObject* tags = nullptr;
   double start_time = 0;
   int ignore_active_span = 0;
+  OverheadScope overhead_scope{self->tracer_bridge->overhead_profile(),
+                               OverheadProfile::StartSpan};
   static const char* const arguments_format =
       "s#"  // operation_name
       "|"
@@ -138,11 +273,16 @@ static PyObject* startSpan(TracerObject* self, PyObject* args,
           &ignore_active_span) == 0) {
     return nullptr;
   }
+  bool is_rejected;
   auto span_bridge = self->tracer_bridge->makeSpan(
       opentracing::string_view{operation_name,
                                static_cast<size_t>(operation_name_length)},
       self->scope_manager, parent, references, tags, start_time,
-      static_cast<bool>(ignore_active_span));
+      static_cast<bool>(ignore_active_span), is_rejected);
+  if (is_rejected) {
+    Py_INCREF(self->noop_span);
+    return self->noop_span;
+  }
   if (span_bridge == nullptr) {
     return nullptr;
   }
@@ -154,6 +294,9 @@ static PyObject* startSpan(TracerObject* self, PyObject* args,
 //--------------------------------------------------------------------------------------------------
 static PyObject* inject(TracerObject* self, PyObject* args,
                         PyObject* keywords) noexcept {
+  if (self->is_noop) {
+    Py_RETURN_NONE;
+  }
   return self->tracer_bridge->inject(args, keywords);
 }
 
@@ -162,14 +305,73 @@ static PyObject* inject(TracerObject* self, PyObject* args,
 //--------------------------------------------------------------------------------------------------
 static PyObject* extract(TracerObject* self, PyObject* args,
                          PyObject* keywords) noexcept {
+  if (self->is_noop) {
+    Py_RETURN_NONE;
+  }
   return self->tracer_bridge->extract(args, keywords);
 }
 
+//--------------------------------------------------------------------------------------------------
+// extractMany
+//--------------------------------------------------------------------------------------------------
+static PyObject* extractMany(TracerObject* self, PyObject* args,
+                             PyObject* keywords) noexcept {
+  if (!self->is_noop) {
+    return self->tracer_bridge->extractMany(args, keywords);
+  }
+  static char* keyword_names[] = {const_cast<char*>("format"),
+                                  const_cast<char*>("carriers"), nullptr};
+  const char* format_data = nullptr;
+  int format_length = 0;
+  PyObject* carriers = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "s#O:extract_many",
+                                  keyword_names, &format_data, &format_length,
+                                  &carriers) == 0) {
+    return nullptr;
+  }
+  auto num_carriers = PySequence_Size(carriers);
+  if (num_carriers == -1) {
+    return nullptr;
+  }
+  PyObject* result = PyList_New(num_carriers);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  for (Py_ssize_t i = 0; i < num_carriers; ++i) {
+    Py_INCREF(Py_None);
+    PyList_SetItem(result, i, Py_None);
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// tryExtract
+//--------------------------------------------------------------------------------------------------
+static PyObject* tryExtract(TracerObject* self, PyObject* args,
+                            PyObject* keywords) noexcept {
+  if (self->is_noop) {
+    Py_RETURN_NONE;
+  }
+  return self->tracer_bridge->tryExtract(args, keywords);
+}
+
+//--------------------------------------------------------------------------------------------------
+// extractErrors
+//--------------------------------------------------------------------------------------------------
+static PyObject* extractErrors(TracerObject* self) noexcept {
+  return self->tracer_bridge->extractErrors();
+}
+
 //--------------------------------------------------------------------------------------------------
 // close
 //--------------------------------------------------------------------------------------------------
 static PyObject* close(TracerObject* self) noexcept {
-  self->tracer_bridge->tracer().Close();
+  PYTHON_BRIDGE_TRACER_PROBE0(tracer__close);
+  auto tracer_bridge = self->tracer_bridge;
+  Py_BEGIN_ALLOW_THREADS
+  tracer_bridge->flushExportQueue(std::chrono::microseconds::zero());
+  tracer_bridge->tracer().Close();
+  Py_END_ALLOW_THREADS
   Py_RETURN_NONE;
 }
 
@@ -187,81 +389,267 @@ static PyObject* flushPython(TracerObject* self, PyObject* args,
   }
   auto timeout_microseconds =
       std::chrono::microseconds{static_cast<uint64_t>(timeout * 1.0e6)};
-  flush(self->tracer_bridge->tracer(), timeout_microseconds);
+  PYTHON_BRIDGE_TRACER_PROBE1(
+      tracer__flush, static_cast<uint64_t>(timeout_microseconds.count()));
+  auto tracer_bridge = self->tracer_bridge;
+  Py_BEGIN_ALLOW_THREADS
+  tracer_bridge->flushExportQueue(timeout_microseconds);
+  flush(tracer_bridge->tracer(), timeout_microseconds);
+  Py_END_ALLOW_THREADS
   Py_RETURN_NONE;
 }
 
 //--------------------------------------------------------------------------------------------------
-// getScopeManager
+// stats
 //--------------------------------------------------------------------------------------------------
-static PyObject* getScopeManager(TracerObject* self,
-                                 void* /*ignored*/) noexcept {
-  Py_INCREF(self->scope_manager);
-  return self->scope_manager;
+static PyObject* stats(TracerObject* self) noexcept {
+  return self->tracer_bridge->stats().toPyDict();
+}
+
+//--------------------------------------------------------------------------------------------------
+// tailSamplingStats
+//--------------------------------------------------------------------------------------------------
+static PyObject* tailSamplingStats(TracerObject* self) noexcept {
+  return self->tracer_bridge->getTailSamplingStats();
+}
+
+//--------------------------------------------------------------------------------------------------
+// overhead
+//--------------------------------------------------------------------------------------------------
+static PyObject* overhead(TracerObject* self) noexcept {
+  return self->tracer_bridge->getOverhead();
 }
 
 //--------------------------------------------------------------------------------------------------
-// getActiveSpan
+// redMetrics
 //--------------------------------------------------------------------------------------------------
-static PyObject* getActiveSpan(TracerObject* self, void* /*ignored*/) noexcept {
-  PythonObjectWrapper scope =
-      PyObject_GetAttrString(self->scope_manager, "active");
-  if (scope.error()) {
+static PyObject* redMetrics(TracerObject* self) noexcept {
+  return self->tracer_bridge->getRedMetrics();
+}
+
+//--------------------------------------------------------------------------------------------------
+// liveSpans
+//--------------------------------------------------------------------------------------------------
+static PyObject* liveSpans(TracerObject* self, PyObject* args,
+                           PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("older_than"), nullptr};
+  double older_than = 0;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "|d:live_spans",
+                                  keyword_names, &older_than) == 0) {
     return nullptr;
   }
-  if (scope == Py_None) {
-    Py_RETURN_NONE;
+  if (!(older_than >= 0 && std::isfinite(older_than))) {
+    PyErr_SetString(PyExc_ValueError,
+                    "older_than must be a non-negative finite number");
+    return nullptr;
   }
-  return PyObject_GetAttrString(scope, "span");
+  return self->tracer_bridge->getLiveSpans(older_than);
 }
 
 //--------------------------------------------------------------------------------------------------
-// makeTypeDescription
+// loggingFilter
 //--------------------------------------------------------------------------------------------------
-static TypeDescription makeTypeDescription(
-    const std::vector<PyMethodDef>& extension_methods,
-    const std::vector<PyGetSetDef>& extension_getsets) noexcept {
-  static int call_counter = 0;
-  if (++call_counter > 1) {
-    std::cerr << "makeTypeDescription may only be called once\n";
-    std::terminate();
+static PyObject* loggingFilter(TracerObject* self, PyObject* args,
+                               PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("trace_id_attribute"),
+                                  const_cast<char*>("span_id_attribute"),
+                                  nullptr};
+  const char* trace_id_attribute = "trace_id";
+  int trace_id_attribute_length = 8;
+  const char* span_id_attribute = "span_id";
+  int span_id_attribute_length = 7;
+  if (PyArg_ParseTupleAndKeywords(
+          args, keywords, "|s#s#:logging_filter", keyword_names,
+          &trace_id_attribute, &trace_id_attribute_length, &span_id_attribute,
+          &span_id_attribute_length) == 0) {
+    return nullptr;
   }
+  return makeLoggingFilter(
+      self->module, self->scope_manager,
+      opentracing::string_view{trace_id_attribute,
+                               static_cast<size_t>(trace_id_attribute_length)},
+      opentracing::string_view{span_id_attribute,
+                               static_cast<size_t>(span_id_attribute_length)});
+}
 
-  // make methods
-  static std::vector<PyMethodDef> tracer_methods = {
+//--------------------------------------------------------------------------------------------------
+// instrument
+//--------------------------------------------------------------------------------------------------
+static PyObject* instrument(TracerObject* self, PyObject* args,
+                            PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("qualified_names"),
+                                  const_cast<char*>("tool_id"), nullptr};
+  PyObject* qualified_names = nullptr;
+  int tool_id = 4;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "O|i:instrument",
+                                  keyword_names, &qualified_names,
+                                  &tool_id) == 0) {
+    return nullptr;
+  }
+  std::lock_guard<ObjectMutex> lock_guard{self->auto_instrumentation_mutex};
+  if (self->auto_instrumentation != nullptr) {
+    PyErr_Format(PyExc_RuntimeError,
+                 "tracer is already instrumenting functions");
+    return nullptr;
+  }
+  self->auto_instrumentation = startAutoInstrumentation(
+      reinterpret_cast<PyObject*>(self), qualified_names, tool_id);
+  if (self->auto_instrumentation == nullptr) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// uninstrument
+//--------------------------------------------------------------------------------------------------
+static PyObject* uninstrument(TracerObject* self) noexcept {
+  PythonObjectWrapper auto_instrumentation;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{self->auto_instrumentation_mutex};
+    auto_instrumentation = self->auto_instrumentation;
+    self->auto_instrumentation = nullptr;
+  }
+  if (auto_instrumentation.error()) {
+    Py_RETURN_NONE;
+  }
+  if (!stopAutoInstrumentation(auto_instrumentation)) {
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// exportQueueStats
+//--------------------------------------------------------------------------------------------------
+static PyObject* exportQueueStats(TracerObject* self) noexcept {
+  return self->tracer_bridge->getExportQueueStats();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getScopeManager
+//--------------------------------------------------------------------------------------------------
+static PyObject* getScopeManager(TracerObject* self,
+                                 void* /*ignored*/) noexcept {
+  Py_INCREF(self->scope_manager);
+  return self->scope_manager;
+}
+
+//--------------------------------------------------------------------------------------------------
+// getTracerActiveSpan
+//--------------------------------------------------------------------------------------------------
+static PyObject* getTracerActiveSpan(TracerObject* self,
+                                     void* /*ignored*/) noexcept {
+  return getActiveSpan(getModuleState(self->module), self->scope_manager);
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeTracerMethods
+//--------------------------------------------------------------------------------------------------
+static std::vector<PyMethodDef> makeTracerMethods(
+    const std::vector<PyMethodDef>& extension_methods) {
+  std::vector<PyMethodDef> tracer_methods = {
       {"start_span", reinterpret_cast<PyCFunction>(startSpan),
        METH_VARARGS | METH_KEYWORDS, PyDoc_STR("start a span")},
       {"start_active_span", reinterpret_cast<PyCFunction>(startActiveSpan),
        METH_VARARGS | METH_KEYWORDS, PyDoc_STR("start and activate a span")},
+      {"traced", reinterpret_cast<PyCFunction>(traced),
+       METH_VARARGS | METH_KEYWORDS,
+       PyDoc_STR("makes a decorator that traces calls to a function with "
+                 "an active span")},
       {"inject", reinterpret_cast<PyCFunction>(inject),
        METH_VARARGS | METH_KEYWORDS,
        PyDoc_STR("injects a span's context into a carrier")},
       {"extract", reinterpret_cast<PyCFunction>(extract),
        METH_VARARGS | METH_KEYWORDS,
        PyDoc_STR("extracts a span's context from a carrier")},
+      {"extract_many", reinterpret_cast<PyCFunction>(extractMany),
+       METH_VARARGS | METH_KEYWORDS,
+       PyDoc_STR("extracts span contexts from a batch of carriers")},
+      {"try_extract", reinterpret_cast<PyCFunction>(tryExtract),
+       METH_VARARGS | METH_KEYWORDS,
+       PyDoc_STR("extracts a span's context from a carrier or returns None "
+                 "without raising if it can't")},
+      {"extract_errors", reinterpret_cast<PyCFunction>(extractErrors),
+       METH_NOARGS,
+       PyDoc_STR("returns the number of try_extract failures by error kind")},
+      {"logging_filter", reinterpret_cast<PyCFunction>(loggingFilter),
+       METH_VARARGS | METH_KEYWORDS,
+       PyDoc_STR("makes a logging filter that stamps the active span's ids "
+                 "onto log records")},
+      {"instrument", reinterpret_cast<PyCFunction>(instrument),
+       METH_VARARGS | METH_KEYWORDS,
+       PyDoc_STR("traces calls to the functions with the given qualified "
+                 "names using sys.monitoring")},
+      {"uninstrument", reinterpret_cast<PyCFunction>(uninstrument),
+       METH_NOARGS, PyDoc_STR("stops tracing function calls")},
       {"close", reinterpret_cast<PyCFunction>(close), METH_VARARGS,
        PyDoc_STR("close tracer")},
       {"flush", reinterpret_cast<PyCFunction>(flushPython),
-       METH_VARARGS | METH_KEYWORDS, PyDoc_STR("flush a tracer")}};
+       METH_VARARGS | METH_KEYWORDS, PyDoc_STR("flush a tracer")},
+      {"stats", reinterpret_cast<PyCFunction>(stats), METH_NOARGS,
+       PyDoc_STR("returns counters of the spans, tags, logs and propagation "
+                 "calls handled by the tracer")},
+      {"overhead", reinterpret_cast<PyCFunction>(overhead), METH_NOARGS,
+       PyDoc_STR("returns histograms of the time sampled operations spent in "
+                 "the bridge and in the C++ tracer or None if "
+                 "overhead_sample_interval isn't set")},
+      {"red_metrics", reinterpret_cast<PyCFunction>(redMetrics), METH_NOARGS,
+       PyDoc_STR("returns the count, errors and durations of the spans "
+                 "finished per operation since the last call or None if "
+                 "red_metrics_max_operations isn't set")},
+      {"live_spans", reinterpret_cast<PyCFunction>(liveSpans),
+       METH_VARARGS | METH_KEYWORDS,
+       PyDoc_STR("returns the operation name and age of the unfinished "
+                 "spans started at least older_than seconds ago, oldest "
+                 "first, or None if track_live_spans isn't set")},
+      {"export_queue_stats", reinterpret_cast<PyCFunction>(exportQueueStats),
+       METH_NOARGS,
+       PyDoc_STR("returns the export queue's counters or None if spans are "
+                 "finished synchronously")},
+      {"tail_sampling_stats", reinterpret_cast<PyCFunction>(tailSamplingStats),
+       METH_NOARGS,
+       PyDoc_STR("returns the tail sampling buffer's counters or None if "
+                 "tail_sampling_max_spans isn't set")}};
   for (auto method : extension_methods) {
     tracer_methods.emplace_back(method);
   }
   tracer_methods.emplace_back(PyMethodDef{nullptr, nullptr});
+  return tracer_methods;
+}
 
-  // make getsets
-  static std::vector<PyGetSetDef> tracer_getsets = {
+//--------------------------------------------------------------------------------------------------
+// makeTracerGetsets
+//--------------------------------------------------------------------------------------------------
+static std::vector<PyGetSetDef> makeTracerGetsets(
+    const std::vector<PyGetSetDef>& extension_getsets) {
+  std::vector<PyGetSetDef> tracer_getsets = {
       {const_cast<char*>("scope_manager"),
        reinterpret_cast<getter>(getScopeManager), nullptr,
        const_cast<char*>(PyDoc_STR("Returns the attached ScopeManager"))},
       {const_cast<char*>("active_span"),
-       reinterpret_cast<getter>(getActiveSpan), nullptr,
+       reinterpret_cast<getter>(getTracerActiveSpan), nullptr,
        const_cast<char*>(PyDoc_STR("Returns the active span"))}};
   for (auto getset : extension_getsets) {
     tracer_getsets.emplace_back(getset);
   }
   tracer_getsets.emplace_back(PyGetSetDef{nullptr});
+  return tracer_getsets;
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeTypeDescription
+//--------------------------------------------------------------------------------------------------
+static TypeDescription makeTypeDescription(
+    const std::vector<PyMethodDef>& extension_methods,
+    const std::vector<PyGetSetDef>& extension_getsets) {
+  // The tables are built the first time the module is executed and shared by
+  // the tracer class of every interpreter that imports it.
+  static std::vector<PyMethodDef> tracer_methods =
+      makeTracerMethods(extension_methods);
+  static std::vector<PyGetSetDef> tracer_getsets =
+      makeTracerGetsets(extension_getsets);
 
-  // make type description
   TypeDescription result;
   result.name = PYTHON_BRIDGE_TRACER_MODULE "._Tracer";
   result.size = sizeof(TracerObject);
@@ -275,15 +663,33 @@ static TypeDescription makeTypeDescription(
 //--------------------------------------------------------------------------------------------------
 // makeTracer
 //--------------------------------------------------------------------------------------------------
+PyObject* makeTracer(PyObject* module,
+                     std::shared_ptr<opentracing::Tracer> tracer,
+                     PyObject* scope_manager) noexcept {
+  return makeTracer(module, std::move(tracer), scope_manager, TracerOptions{});
+}
+
 PyObject* makeTracer(std::shared_ptr<opentracing::Tracer> tracer,
-                     PyObject* scope_manager) noexcept try {
-  std::unique_ptr<TracerBridge> tracer_bridge{
-      new TracerBridge{std::move(tracer)}};
-  auto result = newPythonObject<TracerObject>(TracerType);
-  if (result == nullptr) {
+                     PyObject* scope_manager) noexcept {
+  auto module = getSinglePhaseModule();
+  if (module == nullptr) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "makeTracer without a module requires a module made by "
+                    "the three-argument makeModule");
     return nullptr;
   }
-  if (scope_manager == nullptr) {
+  return makeTracer(module, std::move(tracer), scope_manager, TracerOptions{});
+}
+
+static PyObject* makeTracer(PyObject* module,
+                            std::shared_ptr<opentracing::Tracer> tracer,
+                            PyObject* scope_manager,
+                            const TracerOptions& options,
+                            bool is_noop) noexcept try {
+  auto& module_state = getModuleState(module);
+  std::unique_ptr<TracerBridge> tracer_bridge{
+      new TracerBridge{module_state, std::move(tracer), options}};
+  if (scope_manager == nullptr || scope_manager == Py_None) {
     scope_manager = getThreadLocalScopeManager();
     if (scope_manager == nullptr) {
       return nullptr;
@@ -291,14 +697,55 @@ PyObject* makeTracer(std::shared_ptr<opentracing::Tracer> tracer,
   } else {
     Py_INCREF(scope_manager);
   }
+  PythonObjectWrapper scope_manager_wrapper{scope_manager};
+  auto result = newPythonObject<TracerObject>(module_state.tracer_type);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  result->module = module;
+  PythonObjectWrapper noop_span =
+      makeNoopSpan(reinterpret_cast<PyObject*>(result));
+  if (noop_span.error()) {
+    freeSelf(reinterpret_cast<PyObject*>(result));
+    return nullptr;
+  }
+  PythonObjectWrapper noop_scope;
+  if (is_noop) {
+    noop_scope = makeScope(scope_manager, noop_span);
+    if (noop_scope.error()) {
+      detachNoopSpan(noop_span);
+      freeSelf(reinterpret_cast<PyObject*>(result));
+      return nullptr;
+    }
+  }
+  Py_XINCREF(module);
   result->tracer_bridge = tracer_bridge.release();
-  result->scope_manager = scope_manager;
+  result->scope_manager = scope_manager_wrapper.release();
+  result->noop_span = noop_span.release();
+  result->is_noop = is_noop;
+  result->noop_scope = noop_scope.release();
+  result->auto_instrumentation = nullptr;
   return reinterpret_cast<PyObject*>(result);
 } catch (const std::exception& e) {
   PyErr_Format(PyExc_RuntimeError, "%s", e.what());
   return nullptr;
 }
 
+PyObject* makeTracer(PyObject* module,
+                     std::shared_ptr<opentracing::Tracer> tracer,
+                     PyObject* scope_manager,
+                     const TracerOptions& options) noexcept {
+  return makeTracer(module, std::move(tracer), scope_manager, options, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeNoopTracer
+//--------------------------------------------------------------------------------------------------
+PyObject* makeNoopTracer(PyObject* module, PyObject* scope_manager) noexcept {
+  return makeTracer(module, opentracing::MakeNoopTracer(), scope_manager,
+                    TracerOptions{}, true);
+}
+
 //--------------------------------------------------------------------------------------------------
 // extractTracer
 //--------------------------------------------------------------------------------------------------
@@ -312,15 +759,19 @@ opentracing::Tracer& extractTracer(PyObject* tracer_object) noexcept {
 //--------------------------------------------------------------------------------------------------
 bool setupTracerClass(
     PyObject* module, const std::vector<PyMethodDef>& extension_methods,
-    const std::vector<PyGetSetDef>& extension_getsets) noexcept {
+    const std::vector<PyGetSetDef>& extension_getsets) noexcept try {
   auto type_description =
       makeTypeDescription(extension_methods, extension_getsets);
   auto tracer_type = makeType<TracerObject>(type_description);
   if (tracer_type == nullptr) {
     return false;
   }
-  TracerType = tracer_type;
+  Py_INCREF(tracer_type);
+  getModuleState(module).tracer_type = tracer_type;
   auto rcode = PyModule_AddObject(module, "_Tracer", tracer_type);
   return rcode == 0;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "%s", e.what());
+  return false;
 }
 }  // namespace python_bridge_tracer
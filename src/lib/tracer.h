@@ -4,7 +4,42 @@
 
 #include <Python.h>
 
+#include "module_state.h"
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+#include "opentracing/string_view.h"
+
 namespace python_bridge_tracer {
+/**
+ * @param tracer the python tracer
+ * @return the state of the module the tracer was made by
+ */
+ModuleState& getTracerModuleState(PyObject* tracer) noexcept;
+
+/**
+ * Start a span that's a child of the active span and activate it.
+ * @param tracer the python tracer to start the span with
+ * @param operation_name the span's operation name
+ * @param tags the span's tags or nullptr
+ * @param span set to the started span
+ * @return a scope to pass to finishActiveScope
+ */
+PyObject* startActiveScope(PyObject* tracer,
+                           opentracing::string_view operation_name,
+                           PyObject* tags, PythonObjectWrapper& span) noexcept;
+
+/**
+ * Close a scope from startActiveScope and finish its span.
+ * @param scope the scope to close
+ * @param span the scope's span
+ * @param exc_type the type of the exception raised by the span's work or
+ * Py_None
+ * @param exc_value the exception or Py_None
+ * @return true if successful
+ */
+bool finishActiveScope(PyObject* scope, PyObject* span, PyObject* exc_type,
+                       PyObject* exc_value) noexcept;
+
 /**
  * Setup the python tracer class.
  * @param module the module to add the class to
@@ -1,12 +1,23 @@
 #include "tracer_bridge.h"
 
+#include <algorithm>
 #include <sstream>
+#include <cctype>
+#include <unordered_map>
+#include <unordered_set>
 #include <exception>
+#include <mutex>
+#include <system_error>
+#include <type_traits>
 
+#include "noop_span.h"
 #include "span.h"
 #include "span_context.h"
 #include "dict_writer.h"
 #include "dict_reader.h"
+#include "pair_sequence_reader.h"
+#include "pair_sequence_writer.h"
+#include "probes.h"
 #include "python_bridge_tracer/utility.h"
 #include "opentracing_module.h"
 #include "python_bridge_tracer/python_object_wrapper.h"
@@ -42,10 +53,15 @@ static bool getNumReferences(PyObject* references,
 static bool addParentReference(
     PyObject* parent,
     std::vector<std::pair<opentracing::SpanReferenceType, SpanContextBridge>>&
-        cpp_references) noexcept {
+        cpp_references,
+    bool& has_rejected_parent) noexcept {
   if (parent == nullptr || parent == Py_None) {
     return true;
   }
+  if (isNoopSpan(parent) || isNoopSpanContext(parent)) {
+    has_rejected_parent = true;
+    return true;
+  }
   if (isSpanContext(parent)) {
     cpp_references.emplace_back(opentracing::SpanReferenceType::ChildOfRef,
                                 getSpanContext(parent));
@@ -66,19 +82,20 @@ static bool addParentReference(
 // addActiveSpanReference
 //--------------------------------------------------------------------------------------------------
 static bool addActiveSpanReference(
-    PyObject* scope_manager,
+    const ModuleState& module_state, PyObject* scope_manager,
     std::vector<std::pair<opentracing::SpanReferenceType, SpanContextBridge>>&
-        cpp_references) noexcept {
-  PythonObjectWrapper active_scope = PyObject_GetAttrString(scope_manager, "active");
-  if (active_scope.error()) {
+        cpp_references,
+    bool& has_rejected_parent) noexcept {
+  PythonObjectWrapper active_span = getActiveSpan(module_state, scope_manager);
+  if (active_span.error()) {
     return false;
   }
-  if (active_scope == Py_None) {
+  if (active_span == Py_None) {
     return true;
   }
-  PythonObjectWrapper active_span = PyObject_GetAttrString(active_scope, "span");
-  if (active_span.error()) {
-    return false;
+  if (isNoopSpan(active_span)) {
+    has_rejected_parent = true;
+    return true;
   }
   if (!isSpan(active_span)) {
     PyErr_Format(
@@ -129,7 +146,8 @@ static bool getReferenceType(
 static bool addReference(
     PyObject* reference,
     std::vector<std::pair<opentracing::SpanReferenceType, SpanContextBridge>>&
-        cpp_references) noexcept {
+        cpp_references,
+    bool& has_rejected_parent) noexcept {
   PythonObjectWrapper reference_type = PyObject_GetAttrString(reference, "type");
   if (reference_type.error()) {
     return false;
@@ -142,6 +160,10 @@ static bool addReference(
   if (span_context.error()) {
     return false;
   }
+  if (isNoopSpanContext(span_context)) {
+    has_rejected_parent = true;
+    return true;
+  }
   if (!isSpanContext(span_context)) {
     PyErr_Format(PyExc_TypeError,
                  "unexpected type for referenced_context: "
@@ -158,10 +180,11 @@ static bool addReference(
 static bool addReferences(
     PyObject* references, int num_references,
     std::vector<std::pair<opentracing::SpanReferenceType, SpanContextBridge>>&
-        cpp_references) noexcept {
+        cpp_references,
+    bool& has_rejected_parent) noexcept {
   for (int i = 0; i < num_references; ++i) {
     auto reference = PyList_GetItem(references, i);
-    if (!addReference(reference, cpp_references)) {
+    if (!addReference(reference, cpp_references, has_rejected_parent)) {
       return false;
     }
   }
@@ -171,25 +194,30 @@ static bool addReferences(
 //--------------------------------------------------------------------------------------------------
 // getCppReferences
 //--------------------------------------------------------------------------------------------------
+// has_rejected_parent is set if any of the references is to a span that
+// wasn't sampled, in which case the new span inherits the decision.
 static bool getCppReferences(
-    PyObject* scope_manager, PyObject* parent, PyObject* references,
+    const ModuleState& module_state, PyObject* scope_manager, PyObject* parent, PyObject* references,
     bool ignore_active_span,
     std::vector<std::pair<opentracing::SpanReferenceType, SpanContextBridge>>&
-        cpp_references) noexcept {
+        cpp_references,
+    bool& has_rejected_parent) noexcept {
   int num_references;
   if (!getNumReferences(references, num_references)) {
     return false;
   }
   cpp_references.reserve(static_cast<size_t>(num_references) + 2);
-  if (!addParentReference(parent, cpp_references)) {
+  if (!addParentReference(parent, cpp_references, has_rejected_parent)) {
     return false;
   }
   if (!ignore_active_span) {
-    if (!addActiveSpanReference(scope_manager, cpp_references)) {
+    if (!addActiveSpanReference(module_state, scope_manager, cpp_references,
+                                has_rejected_parent)) {
       return false;
     }
   }
-  return addReferences(references, num_references, cpp_references);
+  return addReferences(references, num_references, cpp_references,
+                       has_rejected_parent);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -214,6 +242,20 @@ static bool setTags(SpanBridge& span_bridge, PyObject* tags) noexcept {
   return true;
 }
 
+//--------------------------------------------------------------------------------------------------
+// isPropagationError
+//--------------------------------------------------------------------------------------------------
+static bool isPropagationError(std::error_code error_code,
+                               std::error_code propagation_error) noexcept {
+  // Note: Use string comparison for error category to work around issues
+  // described here with dynamically loaded tracers.
+  //
+  // https://github.com/envoyproxy/envoy/issues/5481#issuecomment-452229998
+  return error_code.category().name() ==
+             opentracing::string_view{propagation_error.category().name()} &&
+         error_code.value() == propagation_error.value();
+}
+
 //--------------------------------------------------------------------------------------------------
 // setPropagationError
 //--------------------------------------------------------------------------------------------------
@@ -222,30 +264,400 @@ static void setPropagationError(std::error_code error_code) noexcept {
     // error was already set
     return;
   }
-  // Note: Use string comparison for error category to work around issues
-  // described here with dynamically loaded tracers.
-  //
-  // https://github.com/envoyproxy/envoy/issues/5481#issuecomment-452229998
-  if (error_code.category().name() ==
-      opentracing::string_view{"OpenTracingPropagationError"}) {
-    if (error_code.value() ==
-        opentracing::span_context_corrupted_error.value()) {
-      PythonObjectWrapper exception = getSpanContextCorruptedException();
-      if (exception.error()) {
-        return;
-      }
-      PyErr_Format(exception, "%s", error_code.message().c_str());
+  if (isPropagationError(error_code,
+                         opentracing::span_context_corrupted_error)) {
+    PythonObjectWrapper exception = getSpanContextCorruptedException();
+    if (exception.error()) {
       return;
     }
+    PyErr_Format(exception, "%s", error_code.message().c_str());
+    return;
   }
   PyErr_Format(PyExc_RuntimeError, "%s", error_code.message().c_str());
 }
 
+//--------------------------------------------------------------------------------------------------
+// setUnsupportedFormatError
+//--------------------------------------------------------------------------------------------------
+static void setUnsupportedFormatError(opentracing::string_view format) noexcept {
+  PythonObjectWrapper exception = getUnsupportedFormatException();
+  if (exception.error()) {
+    return;
+  }
+  PyErr_Format(exception, "unsupported format %s", format.data());
+}
+
+//--------------------------------------------------------------------------------------------------
+// injectCachedKeyValues
+//--------------------------------------------------------------------------------------------------
+static bool injectCachedKeyValues(
+    const SpanContextCache::KeyValues& cached_key_values,
+    PyObject* carrier) noexcept {
+  for (auto& key_value : cached_key_values) {
+    if (PyDict_SetItem(carrier, key_value.first, key_value.second) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// makeExtractedSpanContext
+//--------------------------------------------------------------------------------------------------
+static PyObject* makeExtractedSpanContext(
+    const ModuleState& module_state,
+    std::unique_ptr<opentracing::SpanContext>&& span_context) noexcept {
+  if (span_context == nullptr) {
+    Py_RETURN_NONE;
+  }
+  std::unique_ptr<SpanContextBridge> span_context_bridge{
+      new SpanContextBridge{std::move(span_context)}};
+  return makeSpanContext(module_state, std::move(span_context_bridge));
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendCarrierKeyValue
+//--------------------------------------------------------------------------------------------------
+static void appendCarrierKeyValue(opentracing::string_view s, bool fold_case,
+                                  std::string& carrier_key) {
+  carrier_key.append(std::to_string(s.size()));
+  carrier_key.push_back(':');
+  if (!fold_case) {
+    carrier_key.append(s.data(), s.size());
+    return;
+  }
+  for (auto c : s) {
+    carrier_key.push_back(
+        static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// compareKeyNames
+//--------------------------------------------------------------------------------------------------
+static int compareKeyNames(const std::string& lhs, const std::string& rhs,
+                           bool fold_case) noexcept {
+  if (!fold_case) {
+    return lhs.compare(rhs);
+  }
+  auto n = std::min(lhs.size(), rhs.size());
+  for (size_t i = 0; i < n; ++i) {
+    auto lhs_c = std::tolower(static_cast<unsigned char>(lhs[i]));
+    auto rhs_c = std::tolower(static_cast<unsigned char>(rhs[i]));
+    if (lhs_c != rhs_c) {
+      return lhs_c < rhs_c ? -1 : 1;
+    }
+  }
+  if (lhs.size() == rhs.size()) {
+    return 0;
+  }
+  return lhs.size() < rhs.size() ? -1 : 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// KeyValuesReader
+//--------------------------------------------------------------------------------------------------
+namespace {
+using CarrierKeyValues = std::vector<std::pair<std::string, std::string>>;
+
+// Replays key-values already read from a carrier so that extract_many reads
+// each carrier only once.
+class KeyValuesReader final : public opentracing::HTTPHeadersReader {
+ public:
+  explicit KeyValuesReader(const CarrierKeyValues& key_values) noexcept
+      : key_values_{key_values} {}
+
+  // opentracing::TextMapReader
+  opentracing::expected<void> ForeachKey(
+      std::function<opentracing::expected<void>(opentracing::string_view key,
+                                                opentracing::string_view value)>
+          f) const override {
+    for (auto& key_value : key_values_) {
+      auto result = f(key_value.first, key_value.second);
+      if (!result) {
+        return result;
+      }
+    }
+    return {};
+  }
+
+ private:
+  const CarrierKeyValues& key_values_;
+};
+
+// Records the names of the keys a tracer injects.
+class KeyNamesWriter final : public opentracing::HTTPHeadersWriter {
+ public:
+  // opentracing::TextMapWriter
+  opentracing::expected<void> Set(
+      opentracing::string_view key,
+      opentracing::string_view /*value*/) const override {
+    key_names_.emplace_back(key);
+    return {};
+  }
+
+  const std::vector<std::string>& key_names() const noexcept {
+    return key_names_;
+  }
+
+ private:
+  mutable std::vector<std::string> key_names_;
+};
+
+struct KeyNameHash {
+  bool fold_case;
+
+  size_t operator()(const std::string& key_name) const noexcept {
+    // FNV-1a
+    size_t result = 2166136261u;
+    for (auto c : key_name) {
+      auto byte = fold_case ? std::tolower(static_cast<unsigned char>(c))
+                            : static_cast<unsigned char>(c);
+      result = (result ^ static_cast<size_t>(byte)) * 16777619u;
+    }
+    return result;
+  }
+};
+
+struct KeyNameEqual {
+  bool fold_case;
+
+  bool operator()(const std::string& lhs, const std::string& rhs) const
+      noexcept {
+    return lhs.size() == rhs.size() && compareKeyNames(lhs, rhs, fold_case) == 0;
+  }
+};
+
+// Tracks which carrier keys a tracer uses for propagation so that carriers
+// differing only in unrelated keys (user-agent, content-length, ...) share a
+// key in extract_many.
+//
+// A key is taken to be a propagation key if the tracer writes it when the
+// extracted span context is injected again. Tracers are expected to read no
+// keys beyond those they write.
+class CarrierKeyNames {
+ public:
+  explicit CarrierKeyNames(bool fold_case)
+      : propagation_key_names_{0, KeyNameHash{fold_case},
+                               KeyNameEqual{fold_case}},
+        other_key_names_{0, KeyNameHash{fold_case}, KeyNameEqual{fold_case}},
+        fold_case_{fold_case} {}
+
+  // Serializes the propagation keys of a carrier into carrier_key. If the
+  // carrier has keys that haven't been classified yet, carrier_key is left
+  // empty.
+  void makeCarrierKey(const CarrierKeyValues& key_values,
+                      std::string& carrier_key) {
+    carrier_key.clear();
+    propagation_key_values_.clear();
+    for (auto& key_value : key_values) {
+      if (propagation_key_names_.count(key_value.first) == 1) {
+        propagation_key_values_.push_back(&key_value);
+      } else if (other_key_names_.count(key_value.first) == 0) {
+        return;
+      }
+    }
+    auto fold_case = fold_case_;
+    std::sort(propagation_key_values_.begin(), propagation_key_values_.end(),
+              [fold_case](const CarrierKeyValues::value_type* lhs,
+                          const CarrierKeyValues::value_type* rhs) {
+                auto comparison =
+                    compareKeyNames(lhs->first, rhs->first, fold_case);
+                if (comparison != 0) {
+                  return comparison < 0;
+                }
+                return lhs->second < rhs->second;
+              });
+    carrier_key.push_back('#');
+    for (auto key_value : propagation_key_values_) {
+      appendCarrierKeyValue(key_value->first, fold_case_, carrier_key);
+      appendCarrierKeyValue(key_value->second, false, carrier_key);
+    }
+  }
+
+  // Classifies the keys of a carrier given the key names the tracer injected
+  // for the span context extracted from it.
+  void learn(const CarrierKeyValues& key_values,
+             const std::vector<std::string>& injected_key_names) {
+    for (auto& key_name : injected_key_names) {
+      propagation_key_names_.insert(key_name);
+      other_key_names_.erase(key_name);
+    }
+    for (auto& key_value : key_values) {
+      if (propagation_key_names_.count(key_value.first) == 0) {
+        other_key_names_.insert(key_value.first);
+      }
+    }
+  }
+
+ private:
+  using KeyNameSet = std::unordered_set<std::string, KeyNameHash, KeyNameEqual>;
+  KeyNameSet propagation_key_names_;
+  KeyNameSet other_key_names_;
+  std::vector<const CarrierKeyValues::value_type*> propagation_key_values_;
+  bool fold_case_;
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// readCarrier
+//--------------------------------------------------------------------------------------------------
+// Reads the key-values of a text map or http headers carrier into key_values
+// in the order they were read, or serializes a binary carrier into
+// carrier_key. was_read is left false for carriers that can't be read this way.
+static bool readCarrier(opentracing::string_view format,
+                        const KeyPrefixFilter& key_filter, PyObject* carrier,
+                        CarrierKeyValues& key_values, std::string& carrier_key,
+                        bool& was_read) noexcept try {
+  carrier_key.clear();
+  key_values.clear();
+  was_read = false;
+  if (format == BinaryFormat) {
+    if (PyByteArray_Check(carrier) != 1) {
+      return true;
+    }
+    carrier_key.push_back('#');
+    carrier_key.append(PyByteArray_AsString(carrier),
+                       static_cast<size_t>(PyByteArray_Size(carrier)));
+    was_read = true;
+    return true;
+  }
+  auto callback = [&key_values](opentracing::string_view key,
+                                opentracing::string_view value) {
+    key_values.emplace_back(key, value);
+    return opentracing::expected<void>{};
+  };
+  opentracing::expected<void> was_successful;
+  if (PyDict_Check(carrier) == 1) {
+    was_successful = DictReader{carrier, key_filter}.ForeachKey(callback);
+  } else if (PyList_Check(carrier) == 1 || PyTuple_Check(carrier) == 1) {
+    was_successful =
+        PairSequenceReader{carrier, key_filter, format == HttpHeadersFormat}
+            .ForeachKey(callback);
+  } else {
+    return true;
+  }
+  if (!was_successful) {
+    return false;
+  }
+  was_read = true;
+  return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to read carrier: %s", e.what());
+  return false;
+}
+
 //--------------------------------------------------------------------------------------------------
 // constructor
 //--------------------------------------------------------------------------------------------------
-TracerBridge::TracerBridge(std::shared_ptr<opentracing::Tracer> tracer) noexcept
-    : tracer_{std::move(tracer)} {}
+TracerBridge::TracerBridge(const ModuleState& module_state,
+                           std::shared_ptr<opentracing::Tracer> tracer,
+                           const TracerOptions& options) noexcept
+    : module_state_(module_state),
+      tracer_{std::move(tracer)},
+      propagation_key_filter_{options.propagation_key_prefixes},
+      extract_error_counts_{},
+      sampling_policy_{options},
+      max_logs_per_span_{options.max_logs_per_span},
+      max_log_bytes_per_span_{options.max_log_bytes_per_span},
+      max_value_length_{options.max_value_length},
+      value_truncation_marker_{options.value_truncation_marker} {
+  if (options.export_queue_size > 0) {
+    try {
+      export_queue_.reset(new ExportQueue{options.export_queue_size});
+    } catch (const std::system_error& /*e*/) {
+      // The worker thread couldn't be started, so finish spans synchronously.
+    }
+  }
+  if (options.overhead_sample_interval > 0) {
+    overhead_profile_.reset(
+        new OverheadProfile{options.overhead_sample_interval});
+  }
+  if (options.red_metrics_max_operations > 0) {
+    red_metrics_.reset(new RedMetrics{options.red_metrics_max_operations});
+  }
+  if (options.track_live_spans) {
+    live_span_registry_.reset(new LiveSpanRegistry{});
+  }
+  if (options.tail_sampling_max_spans > 0) {
+    // Spans are started through the buffer; the vendor tracer only sees kept
+    // traces.
+    tail_sampling_tracer_ =
+        std::make_shared<TailSamplingTracer>(std::move(tracer_), options);
+    tracer_ = tail_sampling_tracer_;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// flushExportQueue
+//--------------------------------------------------------------------------------------------------
+bool TracerBridge::flushExportQueue(std::chrono::microseconds timeout) noexcept {
+  if (export_queue_ == nullptr) {
+    return true;
+  }
+  return export_queue_->flush(timeout);
+}
+
+//--------------------------------------------------------------------------------------------------
+// getExportQueueStats
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::getExportQueueStats() const noexcept {
+  if (export_queue_ == nullptr) {
+    Py_RETURN_NONE;
+  }
+  auto num_pushed = export_queue_->num_pushed();
+  auto num_finished = export_queue_->num_finished();
+  return Py_BuildValue(
+      "{s:n,s:K,s:K,s:K}", "capacity",
+      static_cast<Py_ssize_t>(export_queue_->capacity()), "queued",
+      static_cast<unsigned long long>(num_pushed - std::min(num_pushed, num_finished)),
+      "finished", static_cast<unsigned long long>(num_finished), "overflowed",
+      static_cast<unsigned long long>(export_queue_->num_overflowed()));
+}
+
+//--------------------------------------------------------------------------------------------------
+// getTailSamplingStats
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::getTailSamplingStats() const noexcept {
+  if (tail_sampling_tracer_ == nullptr) {
+    Py_RETURN_NONE;
+  }
+  return tail_sampling_tracer_->getStats();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getOverhead
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::getOverhead() noexcept {
+  if (overhead_profile_ == nullptr) {
+    Py_RETURN_NONE;
+  }
+  return overhead_profile_->toPyDict();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getRedMetrics
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::getRedMetrics() noexcept {
+  if (red_metrics_ == nullptr) {
+    Py_RETURN_NONE;
+  }
+  return red_metrics_->takeSnapshot();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getLiveSpans
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::getLiveSpans(double older_than) const noexcept {
+  if (live_span_registry_ == nullptr) {
+    Py_RETURN_NONE;
+  }
+  // Clamped so that the conversion can't overflow; no span is that old.
+  const double MaxOlderThan = 1.0e9;
+  return live_span_registry_->toPyList(
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>{std::min(older_than, MaxOlderThan)}));
+}
 
 //--------------------------------------------------------------------------------------------------
 // makeSpan
@@ -253,13 +665,39 @@ TracerBridge::TracerBridge(std::shared_ptr<opentracing::Tracer> tracer) noexcept
 std::unique_ptr<SpanBridge> TracerBridge::makeSpan(
     opentracing::string_view operation_name, PyObject* scope_manager,
     PyObject* parent, PyObject* references, PyObject* tags, double start_time,
-    bool ignore_active_span) noexcept {
+    bool ignore_active_span, bool& is_rejected) noexcept {
+  is_rejected = false;
+  SamplingPolicy::OperationRules* operation_rules = nullptr;
+  if (sampling_policy_.is_enabled()) {
+    operation_rules = sampling_policy_.lookup(operation_name);
+    if (operation_rules != nullptr && operation_rules->is_denied) {
+      is_rejected = true;
+      return nullptr;
+    }
+  }
   std::vector<std::pair<opentracing::SpanReferenceType, SpanContextBridge>>
       cpp_references;
-  if (!getCppReferences(scope_manager, parent, references, ignore_active_span,
-                        cpp_references)) {
+  bool has_rejected_parent = false;
+  if (!getCppReferences(module_state_, scope_manager, parent, references,
+                        ignore_active_span, cpp_references,
+                        has_rejected_parent)) {
+    return nullptr;
+  }
+  if (has_rejected_parent) {
+    is_rejected = true;
     return nullptr;
   }
+  if (sampling_policy_.is_enabled()) {
+    if (operation_rules != nullptr && operation_rules->rate_limit != nullptr &&
+        !operation_rules->rate_limit->acquire()) {
+      is_rejected = true;
+      return nullptr;
+    }
+    if (cpp_references.empty() && !sampling_policy_.sampleRoot()) {
+      is_rejected = true;
+      return nullptr;
+    }
+  }
   opentracing::StartSpanOptions options;
   options.references.reserve(cpp_references.size());
   for (auto& reference : cpp_references) {
@@ -270,8 +708,30 @@ std::unique_ptr<SpanBridge> TracerBridge::makeSpan(
     options.start_system_timestamp = toTimestamp(start_time);
   }
 
-  auto span = tracer_->StartSpanWithOptions(operation_name, options);
-  std::unique_ptr<SpanBridge> span_bridge{new SpanBridge{std::move(span)}};
+  std::unique_ptr<opentracing::Span> span;
+  {
+    VendorTimer vendor_timer;
+    span = tracer_->StartSpanWithOptions(operation_name, options);
+  }
+  stats_.increment(TracerStats::SpansStarted);
+  std::unique_ptr<SpanBridge> span_bridge{
+      new SpanBridge{std::move(span), this}};
+  PYTHON_BRIDGE_TRACER_PROBE2(span__start, operation_name.data(),
+                              operation_name.size());
+  if (red_metrics_ != nullptr || live_span_registry_ != nullptr ||
+      PYTHON_BRIDGE_TRACER_PROBE_ENABLED(span__finish)) {
+    span_bridge->setStartTimestamp(
+        start_time != 0
+            ? opentracing::convert_time_point<std::chrono::steady_clock>(
+                  options.start_system_timestamp)
+            : std::chrono::steady_clock::now());
+  }
+  if (red_metrics_ != nullptr) {
+    span_bridge->trackRedMetrics(*red_metrics_, operation_name);
+  }
+  if (live_span_registry_ != nullptr) {
+    span_bridge->trackLiveSpan(*live_span_registry_, operation_name);
+  }
   if (!setTags(*span_bridge, tags)) {
     return nullptr;
   }
@@ -282,6 +742,7 @@ std::unique_ptr<SpanBridge> TracerBridge::makeSpan(
 // inject
 //--------------------------------------------------------------------------------------------------
 PyObject* TracerBridge::inject(PyObject* args, PyObject* keywords) noexcept {
+  OverheadScope overhead_scope{overhead_profile_.get(), OverheadProfile::Inject};
   static char* keyword_names[] = {
     const_cast<char*>("span_context"), 
     const_cast<char*>("format"), 
@@ -296,52 +757,98 @@ PyObject* TracerBridge::inject(PyObject* args, PyObject* keywords) noexcept {
                                   &carrier) == 0) {
     return nullptr;
   }
+  if (isNoopSpanContext(span_context)) {
+    // The span wasn't sampled so there's nothing to propagate.
+    Py_RETURN_NONE;
+  }
   if (!isSpanContext(span_context)) {
     PyErr_Format(PyExc_TypeError,
                  "span_context must be a " PYTHON_BRIDGE_TRACER_MODULE
                  "._SpanContext");
     return nullptr;
   }
+  stats_.increment(TracerStats::Injects);
   opentracing::string_view format{format_data, static_cast<size_t>(format_length)};
+  auto& span_context_bridge = getSpanContext(span_context);
+  auto& cache = span_context_bridge.cache();
   bool was_successful = false;
   if (format == BinaryFormat) {
     was_successful =
-        injectBinary(getSpanContext(span_context).span_context(), carrier);
+        injectBinary(span_context_bridge.span_context(), cache, carrier);
   } else if (format == TextMapFormat) {
     was_successful = inject<opentracing::TextMapWriter>(
-        getSpanContext(span_context).span_context(), carrier);
+        span_context_bridge.span_context(), cache, cache.text_map(), carrier);
   } else if (format == HttpHeadersFormat) {
     was_successful = inject<opentracing::HTTPHeadersWriter>(
-        getSpanContext(span_context).span_context(), carrier);
+        span_context_bridge.span_context(), cache, cache.http_headers(),
+        carrier);
   } else {
-    PythonObjectWrapper exception = getUnsupportedFormatException();
-    if (exception.error()) {
-      return nullptr;
-    }
-    PyErr_Format(exception, "unsupported format %s", format.data());
-    return nullptr;
+    setUnsupportedFormatError(format);
   }
+  PYTHON_BRIDGE_TRACER_PROBE2(inject, format_data,
+                              static_cast<int>(was_successful));
   if (!was_successful) {
+    stats_.increment(TracerStats::InjectFailures);
     return nullptr;
   }
   Py_RETURN_NONE;
 }
 
 template <class Carrier>
-bool TracerBridge::inject(const opentracing::SpanContext& span_context, PyObject* carrier) noexcept {
-  DictWriter dict_writer{carrier};
-  auto result = tracer_->Inject(span_context, static_cast<Carrier&>(dict_writer));
-  if (!result) {
-    setPropagationError(result.error());
-    return false;
+bool TracerBridge::inject(
+    const opentracing::SpanContext& span_context, SpanContextCache& cache,
+    std::shared_ptr<const SpanContextCache::KeyValues>& cached_key_values,
+    PyObject* carrier) noexcept try {
+  if (PyList_Check(carrier) == 1) {
+    PairSequenceWriter pair_sequence_writer{
+        carrier, std::is_same<Carrier, opentracing::HTTPHeadersWriter>::value};
+    VendorTimer vendor_timer;
+    auto result = tracer_->Inject(
+        span_context, static_cast<Carrier&>(pair_sequence_writer));
+    if (!result) {
+      setPropagationError(result.error());
+      return false;
+    }
+    return true;
+  }
+  std::shared_ptr<const SpanContextCache::KeyValues> key_values;
+  uint64_t generation;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{cache.mutex()};
+    key_values = cached_key_values;
+    generation = cache.generation();
+  }
+  if (key_values != nullptr) {
+    stats_.increment(TracerStats::InjectCacheHits);
+    return injectCachedKeyValues(*key_values, carrier);
+  }
+  std::shared_ptr<SpanContextCache::KeyValues> new_key_values{
+      new SpanContextCache::KeyValues{}};
+  DictWriter dict_writer{carrier, new_key_values.get()};
+  {
+    VendorTimer vendor_timer;
+    auto result =
+        tracer_->Inject(span_context, static_cast<Carrier&>(dict_writer));
+    if (!result) {
+      setPropagationError(result.error());
+      return false;
+    }
+  }
+  std::lock_guard<ObjectMutex> lock_guard{cache.mutex()};
+  if (cache.generation() == generation) {
+    cached_key_values = std::move(new_key_values);
   }
   return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to inject: %s", e.what());
+  return false;
 }
 
 //--------------------------------------------------------------------------------------------------
 // extract
 //--------------------------------------------------------------------------------------------------
 PyObject* TracerBridge::extract(PyObject* args, PyObject* keywords) noexcept {
+  OverheadScope overhead_scope{overhead_profile_.get(), OverheadProfile::Extract};
   static char* keyword_names[] = {const_cast<char*>("format"),
                                   const_cast<char*>("carrier"), nullptr};
   const char* format_data = nullptr;
@@ -354,46 +861,280 @@ PyObject* TracerBridge::extract(PyObject* args, PyObject* keywords) noexcept {
   }
   opentracing::string_view format{format_data,
                                   static_cast<size_t>(format_length)};
-  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> span_context_maybe;
-  if (format == BinaryFormat) {
-    span_context_maybe = extractBinary(carrier);
-  } else if (format == TextMapFormat) {
-    span_context_maybe = extract<opentracing::TextMapReader>(carrier);
-  } else if (format == HttpHeadersFormat) {
-    span_context_maybe = extract<opentracing::HTTPHeadersReader>(carrier);
-  } else {
-    PythonObjectWrapper exception = getUnsupportedFormatException();
-    if (exception.error()) {
-      return nullptr;
-    }
-    PyErr_Format(exception, "unsupported format %s", format.data());
+  stats_.increment(TracerStats::Extracts);
+  auto extract_function = getExtractFunction(format);
+  if (extract_function == nullptr) {
+    stats_.increment(TracerStats::ExtractFailures);
+    setUnsupportedFormatError(format);
     return nullptr;
   }
+  auto span_context_maybe = (this->*extract_function)(carrier);
+  PYTHON_BRIDGE_TRACER_PROBE2(extract, format_data,
+                              span_context_maybe ? 1 : 0);
   if (!span_context_maybe) {
+    stats_.increment(TracerStats::ExtractFailures);
     setPropagationError(span_context_maybe.error());
     return nullptr;
   }
-  std::unique_ptr<opentracing::SpanContext> span_context{std::move(*span_context_maybe)};
-  if (span_context == nullptr) {
-    Py_RETURN_NONE;
-  }
-  std::unique_ptr<SpanContextBridge> span_context_bridge{
-      new SpanContextBridge{std::move(span_context)}};
-  return makeSpanContext(std::move(span_context_bridge));
+  return makeExtractedSpanContext(module_state_,
+                                  std::move(*span_context_maybe));
 }
 
 template <class Carrier>
 opentracing::expected<std::unique_ptr<opentracing::SpanContext>>
 TracerBridge::extract(PyObject* carrier) noexcept {
-  DictReader dict_reader{carrier};
+  if (PyList_Check(carrier) == 1 || PyTuple_Check(carrier) == 1) {
+    PairSequenceReader pair_sequence_reader{
+        carrier, propagation_key_filter_,
+        std::is_same<Carrier, opentracing::HTTPHeadersReader>::value};
+    VendorTimer vendor_timer;
+    return tracer_->Extract(static_cast<Carrier&>(pair_sequence_reader));
+  }
+  DictReader dict_reader{carrier, propagation_key_filter_};
+  VendorTimer vendor_timer;
   return tracer_->Extract(static_cast<Carrier&>(dict_reader));
 }
 
+//--------------------------------------------------------------------------------------------------
+// extractMany
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::extractMany(PyObject* args, PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("format"),
+                                  const_cast<char*>("carriers"), nullptr};
+  const char* format_data = nullptr;
+  int format_length = 0;
+  PyObject* carriers = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "s#O:extract_many",
+                                  keyword_names, &format_data, &format_length,
+                                  &carriers) == 0) {
+    return nullptr;
+  }
+  opentracing::string_view format{format_data,
+                                  static_cast<size_t>(format_length)};
+  auto extract_function = getExtractFunction(format);
+  if (extract_function == nullptr) {
+    setUnsupportedFormatError(format);
+    return nullptr;
+  }
+  auto num_carriers = PySequence_Size(carriers);
+  if (num_carriers == -1) {
+    return nullptr;
+  }
+  PythonObjectWrapper result = PyList_New(num_carriers);
+  if (result.error()) {
+    return nullptr;
+  }
+  try {
+    // Maps serialized propagation headers to the span context extracted from
+    // them. The span contexts are borrowed from the result list.
+    std::unordered_map<std::string, PyObject*> span_contexts;
+    CarrierKeyNames carrier_key_names{format == HttpHeadersFormat};
+    CarrierKeyValues key_values;
+    std::string carrier_key;
+    bool was_read;
+    for (Py_ssize_t i = 0; i < num_carriers; ++i) {
+      PythonObjectWrapper carrier = PySequence_GetItem(carriers, i);
+      if (carrier.error()) {
+        return nullptr;
+      }
+      if (!readCarrier(format, propagation_key_filter_, carrier, key_values,
+                       carrier_key, was_read)) {
+        return nullptr;
+      }
+      auto is_key_value_carrier = was_read && format != BinaryFormat;
+      if (is_key_value_carrier) {
+        carrier_key_names.makeCarrierKey(key_values, carrier_key);
+      }
+      if (!carrier_key.empty()) {
+        auto iter = span_contexts.find(carrier_key);
+        if (iter != span_contexts.end()) {
+          Py_INCREF(iter->second);
+          PyList_SetItem(result, i, iter->second);
+          continue;
+        }
+      }
+      stats_.increment(TracerStats::Extracts);
+      opentracing::expected<std::unique_ptr<opentracing::SpanContext>>
+          span_context_maybe;
+      if (!is_key_value_carrier) {
+        span_context_maybe = (this->*extract_function)(carrier);
+      } else {
+        // Reuse the key-values already read from the carrier.
+        KeyValuesReader key_values_reader{key_values};
+        VendorTimer vendor_timer;
+        if (format == HttpHeadersFormat) {
+          span_context_maybe = tracer_->Extract(
+              static_cast<const opentracing::HTTPHeadersReader&>(
+                  key_values_reader));
+        } else {
+          span_context_maybe = tracer_->Extract(
+              static_cast<const opentracing::TextMapReader&>(
+                  key_values_reader));
+        }
+      }
+      PYTHON_BRIDGE_TRACER_PROBE2(extract, format_data,
+                                  span_context_maybe ? 1 : 0);
+      PyObject* span_context;
+      if (!span_context_maybe) {
+        stats_.increment(TracerStats::ExtractFailures);
+      }
+      if (is_key_value_carrier && carrier_key.empty() && span_context_maybe &&
+          *span_context_maybe != nullptr) {
+        // The carrier has keys not seen before in this batch. Inject the
+        // span context to find out which of them are propagation keys.
+        KeyNamesWriter key_names_writer;
+        opentracing::expected<void> was_successful;
+        {
+          VendorTimer vendor_timer;
+          if (format == HttpHeadersFormat) {
+            was_successful = tracer_->Inject(
+                **span_context_maybe,
+                static_cast<const opentracing::HTTPHeadersWriter&>(
+                    key_names_writer));
+          } else {
+            was_successful = tracer_->Inject(
+                **span_context_maybe,
+                static_cast<const opentracing::TextMapWriter&>(
+                    key_names_writer));
+          }
+        }
+        if (was_successful) {
+          carrier_key_names.learn(key_values, key_names_writer.key_names());
+          carrier_key_names.makeCarrierKey(key_values, carrier_key);
+        }
+      }
+      if (span_context_maybe) {
+        span_context = makeExtractedSpanContext(
+            module_state_, std::move(*span_context_maybe));
+        if (span_context == nullptr) {
+          return nullptr;
+        }
+      } else if (isPropagationError(
+                     span_context_maybe.error(),
+                     opentracing::span_context_corrupted_error)) {
+        // A single malformed message shouldn't fail the batch.
+        span_context = Py_None;
+        Py_INCREF(span_context);
+      } else {
+        setPropagationError(span_context_maybe.error());
+        return nullptr;
+      }
+      PyList_SetItem(result, i, span_context);
+      if (!carrier_key.empty()) {
+        span_contexts.emplace(carrier_key, span_context);
+      }
+    }
+  } catch (const std::exception& e) {
+    PyErr_Format(PyExc_RuntimeError, "extract_many failed: %s", e.what());
+    return nullptr;
+  }
+  return result.release();
+}
+
+//--------------------------------------------------------------------------------------------------
+// tryExtract
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::tryExtract(PyObject* args, PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("format"),
+                                  const_cast<char*>("carrier"), nullptr};
+  const char* format_data = nullptr;
+  int format_length = 0;
+  PyObject* carrier = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "s#O:try_extract",
+                                  keyword_names, &format_data, &format_length,
+                                  &carrier) == 0) {
+    return nullptr;
+  }
+  opentracing::string_view format{format_data,
+                                  static_cast<size_t>(format_length)};
+  stats_.increment(TracerStats::Extracts);
+  auto extract_function = getExtractFunction(format);
+  if (extract_function == nullptr) {
+    stats_.increment(TracerStats::ExtractFailures);
+    extract_error_counts_[UnsupportedFormatError].fetch_add(
+        1, std::memory_order_relaxed);
+    Py_RETURN_NONE;
+  }
+  auto span_context_maybe = (this->*extract_function)(carrier);
+  PYTHON_BRIDGE_TRACER_PROBE2(extract, format_data,
+                              span_context_maybe ? 1 : 0);
+  if (span_context_maybe) {
+    return makeExtractedSpanContext(module_state_,
+                                  std::move(*span_context_maybe));
+  }
+  stats_.increment(TracerStats::ExtractFailures);
+  auto error_code = span_context_maybe.error();
+  ExtractError error;
+  if (error_code == python_error) {
+    // Only swallow the error raised for a carrier of the wrong type; anything
+    // else, such as a MemoryError or a TypeError from reading the carrier,
+    // propagates.
+    PythonObjectWrapper exception = getInvalidCarrierException();
+    if (exception.error() || PyErr_ExceptionMatches(exception) == 0) {
+      return nullptr;
+    }
+    PyErr_Clear();
+    error = InvalidCarrierError;
+  } else if (isPropagationError(error_code,
+                                opentracing::invalid_carrier_error)) {
+    error = InvalidCarrierError;
+  } else if (isPropagationError(error_code,
+                                opentracing::span_context_corrupted_error)) {
+    error = SpanContextCorruptedError;
+  } else {
+    error = OtherExtractError;
+  }
+  extract_error_counts_[error].fetch_add(1, std::memory_order_relaxed);
+  Py_RETURN_NONE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// extractErrors
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerBridge::extractErrors() const noexcept {
+  static const char* const error_names[NumExtractErrors] = {
+      "unsupported_format", "invalid_carrier", "span_context_corrupted",
+      "other"};
+  PythonObjectWrapper result = PyDict_New();
+  if (result.error()) {
+    return nullptr;
+  }
+  for (int i = 0; i < NumExtractErrors; ++i) {
+    PythonObjectWrapper count = PyLong_FromUnsignedLongLong(
+        extract_error_counts_[i].load(std::memory_order_relaxed));
+    if (count.error()) {
+      return nullptr;
+    }
+    if (PyDict_SetItemString(result, error_names[i], count) != 0) {
+      return nullptr;
+    }
+  }
+  return result.release();
+}
+
+//--------------------------------------------------------------------------------------------------
+// getExtractFunction
+//--------------------------------------------------------------------------------------------------
+TracerBridge::ExtractFunction TracerBridge::getExtractFunction(
+    opentracing::string_view format) noexcept {
+  if (format == BinaryFormat) {
+    return &TracerBridge::extractBinary;
+  }
+  if (format == TextMapFormat) {
+    return &TracerBridge::extract<opentracing::TextMapReader>;
+  }
+  if (format == HttpHeadersFormat) {
+    return &TracerBridge::extract<opentracing::HTTPHeadersReader>;
+  }
+  return nullptr;
+}
+
 //--------------------------------------------------------------------------------------------------
 // injectBinary
 //--------------------------------------------------------------------------------------------------
 bool TracerBridge::injectBinary(const opentracing::SpanContext& span_context,
-                                PyObject* carrier) noexcept {
+                                SpanContextCache& cache,
+                                PyObject* carrier) noexcept try {
   if (PyByteArray_Check(carrier) != 1) {
     PythonObjectWrapper exception = getInvalidCarrierException();
     if (exception.error()) {
@@ -402,20 +1143,43 @@ bool TracerBridge::injectBinary(const opentracing::SpanContext& span_context,
     PyErr_Format(exception, "carrier must be a bytearray");
     return false;
   }
-  std::ostringstream oss;
-  auto was_successful = tracer_->Inject(span_context, oss);
-  if (!was_successful) {
-    setPropagationError(was_successful.error());
-    return false;
+  std::shared_ptr<const std::string> binary;
+  uint64_t generation;
+  {
+    std::lock_guard<ObjectMutex> lock_guard{cache.mutex()};
+    binary = cache.binary();
+    generation = cache.generation();
+  }
+  if (binary == nullptr) {
+    std::ostringstream oss;
+    {
+      VendorTimer vendor_timer;
+      auto was_successful = tracer_->Inject(span_context, oss);
+      if (!was_successful) {
+        setPropagationError(was_successful.error());
+        return false;
+      }
+    }
+    binary = std::make_shared<const std::string>(oss.str());
+    std::lock_guard<ObjectMutex> lock_guard{cache.mutex()};
+    if (cache.generation() == generation) {
+      cache.binary() = binary;
+    }
+  } else {
+    stats_.increment(TracerStats::InjectCacheHits);
   }
-  auto s = oss.str();
+  auto& s = *binary;
   auto size = PyByteArray_Size(carrier);
   if (PyByteArray_Resize(carrier, size + static_cast<Py_ssize_t>(s.size())) != 0) {
     return false;
   }
   auto data = PyByteArray_AsString(carrier);
   std::copy(s.begin(), s.end(), data + size);
+  stats_.increment(TracerStats::BinaryBytesInjected, s.size());
   return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_RuntimeError, "failed to inject: %s", e.what());
+  return false;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -434,6 +1198,7 @@ TracerBridge::extractBinary(PyObject* carrier) noexcept {
   auto data = PyByteArray_AsString(carrier);
   auto size = PyByteArray_Size(carrier);
   std::istringstream iss{std::string{data, static_cast<size_t>(size)}};
+  VendorTimer vendor_timer;
   return tracer_->Extract(iss);
 }
 }  // namespace python_bridge_tracer
@@ -2,7 +2,24 @@
 
 #include <Python.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "export_queue.h"
+#include "key_prefix_filter.h"
+#include "live_span_registry.h"
+#include "module_state.h"
+#include "overhead_profile.h"
+#include "red_metrics.h"
+#include "sampling_policy.h"
 #include "span_bridge.h"
+#include "span_context_cache.h"
+#include "tail_sampling_tracer.h"
+#include "tracer_stats.h"
+
+#include "python_bridge_tracer/tracer_options.h"
 
 #include "opentracing/tracer.h"
 
@@ -12,12 +29,111 @@ namespace python_bridge_tracer {
  */
 class TracerBridge {
  public:
-   explicit TracerBridge(std::shared_ptr<opentracing::Tracer> tracer) noexcept;
+   TracerBridge(const ModuleState& module_state,
+                std::shared_ptr<opentracing::Tracer> tracer,
+                const TracerOptions& options) noexcept;
 
    /**
     * @return the OpenTracing-C++ tracer associated with the bridge.
     */
-   opentracing::Tracer& tracer() noexcept { return *tracer_; }
+   opentracing::Tracer& tracer() noexcept {
+     if (tail_sampling_tracer_ != nullptr) {
+       return tail_sampling_tracer_->tracer();
+     }
+     return *tracer_;
+   }
+
+   /**
+    * @return the counters of the work done through the bridge.
+    */
+   TracerStats& stats() noexcept { return stats_; }
+
+   /**
+    * @return the maximum number of log records a span keeps or zero for no
+    * limit.
+    */
+   size_t max_logs_per_span() const noexcept { return max_logs_per_span_; }
+
+   /**
+    * @return the maximum total size of the log records a span keeps or zero
+    * for no limit.
+    */
+   size_t max_log_bytes_per_span() const noexcept {
+     return max_log_bytes_per_span_;
+   }
+
+   /**
+    * @return the length string tag and log values are cut to or zero for no
+    * limit.
+    */
+   size_t max_value_length() const noexcept { return max_value_length_; }
+
+   /**
+    * @return the marker appended to truncated values.
+    */
+   opentracing::string_view value_truncation_marker() const noexcept {
+     return value_truncation_marker_;
+   }
+
+   /**
+    * @return the profile that sampled operations are timed into or nullptr if
+    * overhead profiling isn't enabled.
+    */
+   OverheadProfile* overhead_profile() noexcept {
+     return overhead_profile_.get();
+   }
+
+   /**
+    * @return a dictionary with the overhead profile's histograms or Py_None if
+    * overhead profiling isn't enabled.
+    */
+   PyObject* getOverhead() noexcept;
+
+   /**
+    * @return the per-operation metrics finished spans are aggregated into or
+    * nullptr if RED metrics aren't enabled.
+    */
+   RedMetrics* red_metrics() noexcept { return red_metrics_.get(); }
+
+   /**
+    * @return a dictionary with the RED metrics recorded since the last call or
+    * Py_None if RED metrics aren't enabled.
+    */
+   PyObject* getRedMetrics() noexcept;
+
+   /**
+    * @param older_than the minimum age in seconds of the spans reported; it
+    * must be non-negative and finite
+    * @return a list of the unfinished spans at least older_than old or
+    * Py_None if live spans aren't tracked.
+    */
+   PyObject* getLiveSpans(double older_than) const noexcept;
+
+   /**
+    * @return the queue spans are finished through or nullptr if spans are
+    * finished synchronously.
+    */
+   ExportQueue* export_queue() noexcept { return export_queue_.get(); }
+
+   /**
+    * Wait for the spans in the export queue to be finished. Must be called
+    * without holding the GIL.
+    * @param timeout the maximum time to wait or zero to wait indefinitely
+    * @return true if the queued spans were finished before the timeout
+    */
+   bool flushExportQueue(std::chrono::microseconds timeout) noexcept;
+
+   /**
+    * @return a dictionary with the export queue's counters or Py_None if the
+    * export queue isn't enabled.
+    */
+   PyObject* getExportQueueStats() const noexcept;
+
+   /**
+    * @return a dictionary with the tail sampling buffer's counters or Py_None
+    * if tail sampling isn't enabled.
+    */
+   PyObject* getTailSamplingStats() const noexcept;
 
    /**
     * Create a new span.
@@ -28,13 +144,16 @@ class TracerBridge {
     * @tags a dictionary of tags to add to the span
     * @param start_time the start time of the span in seconds since epoch
     * @param ignore_active_span whether add a child_of reference to the active span.
+    * @param is_rejected set to true if the sampling policy or a parent
+    * rejected the span, in which case nullptr is returned without an error.
     * @param a SpanBridge for the newly created span.
     */
    std::unique_ptr<SpanBridge> makeSpan(opentracing::string_view operation_name,
                                         PyObject* scope_manager,
                                         PyObject* parent, PyObject* references,
                                         PyObject* tags, double start_time,
-                                        bool ignore_active_span) noexcept;
+                                        bool ignore_active_span,
+                                        bool& is_rejected) noexcept;
 
    /**
     * Inject span context into a carrier.
@@ -52,13 +171,70 @@ class TracerBridge {
     */
    PyObject* extract(PyObject* args, PyObject* keywords) noexcept;
 
+   /**
+    * Extract span contexts from a batch of carriers.
+    *
+    * The format is dispatched once for the batch and carriers with identical
+    * propagation headers share a single span context object.
+    * @param args python function arguments
+    * @param keywrods python function keywords
+    * @return a list with the extracted span context or Py_None for each carrier
+    */
+   PyObject* extractMany(PyObject* args, PyObject* keywords) noexcept;
+
+   /**
+    * Extract span context from a carrier without raising on propagation
+    * errors. Failures are counted by kind instead.
+    * @param args python function arguments
+    * @param keywrods python function keywords
+    * @return the extracted span context or Py_None
+    */
+   PyObject* tryExtract(PyObject* args, PyObject* keywords) noexcept;
+
+   /**
+    * @return a dictionary mapping each kind of propagation error to the number
+    * of times try_extract encountered it.
+    */
+   PyObject* extractErrors() const noexcept;
+
   private:
+   enum ExtractError {
+     UnsupportedFormatError,
+     InvalidCarrierError,
+     SpanContextCorruptedError,
+     OtherExtractError,
+     NumExtractErrors
+   };
+
+   using ExtractFunction =
+       opentracing::expected<std::unique_ptr<opentracing::SpanContext>> (
+           TracerBridge::*)(PyObject* carrier);
+
+   const ModuleState& module_state_;
    std::shared_ptr<opentracing::Tracer> tracer_;
+   KeyPrefixFilter propagation_key_filter_;
+   std::array<std::atomic<uint64_t>, NumExtractErrors> extract_error_counts_;
+   SamplingPolicy sampling_policy_;
+   std::unique_ptr<ExportQueue> export_queue_;
+   TracerStats stats_;
+   std::unique_ptr<OverheadProfile> overhead_profile_;
+   std::unique_ptr<RedMetrics> red_metrics_;
+   std::shared_ptr<TailSamplingTracer> tail_sampling_tracer_;
+   std::unique_ptr<LiveSpanRegistry> live_span_registry_;
+   size_t max_logs_per_span_;
+   size_t max_log_bytes_per_span_;
+   size_t max_value_length_;
+   std::string value_truncation_marker_;
 
-   bool injectBinary(const opentracing::SpanContext& span_context, PyObject* carrier) noexcept;
+   bool injectBinary(const opentracing::SpanContext& span_context,
+                     SpanContextCache& cache, PyObject* carrier) noexcept;
 
    template <class Carrier>
-   bool inject(const opentracing::SpanContext& span_context, PyObject* carrier) noexcept;
+   bool inject(const opentracing::SpanContext& span_context,
+               SpanContextCache& cache,
+               std::shared_ptr<const SpanContextCache::KeyValues>&
+                   cached_key_values,
+               PyObject* carrier) noexcept;
 
    opentracing::expected<std::unique_ptr<opentracing::SpanContext>>
    extractBinary(PyObject* carrier) noexcept;
@@ -66,5 +242,7 @@ class TracerBridge {
    template <class Carrier>
    opentracing::expected<std::unique_ptr<opentracing::SpanContext>> extract(
        PyObject* carrier) noexcept;
+
+   ExtractFunction getExtractFunction(opentracing::string_view format) noexcept;
 };
 } // namespace python_bridge_tracer
@@ -0,0 +1,336 @@
+#include "python_bridge_tracer/tracer_options.h"
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+#include "python_bridge_tracer/python_string_wrapper.h"
+#include "python_bridge_tracer/utility.h"
+
+namespace python_bridge_tracer {
+// Caps on the options converted into durations and token bucket rates, so
+// that the conversions can't overflow.
+const double MaxOperationRateLimit = 1.0e6;
+const double MaxTailSamplingMinDuration = 3600;
+
+//--------------------------------------------------------------------------------------------------
+// parseStringList
+//--------------------------------------------------------------------------------------------------
+static bool parseStringList(const char* name, PyObject* value,
+                            std::vector<std::string>& result) noexcept try {
+  if (PyList_Check(value) == 0 && PyTuple_Check(value) == 0) {
+    PyErr_Format(PyExc_TypeError, "%s must be a list of strings", name);
+    return false;
+  }
+  auto size = PySequence_Size(value);
+  result.clear();
+  result.reserve(static_cast<size_t>(size));
+  for (Py_ssize_t i = 0; i < size; ++i) {
+    PythonObjectWrapper item = PySequence_GetItem(value, i);
+    if (item.error()) {
+      return false;
+    }
+    if (!isString(item)) {
+      PyErr_Format(PyExc_TypeError, "%s must be a list of strings", name);
+      return false;
+    }
+    PythonStringWrapper item_str{item};
+    if (item_str.error()) {
+      return false;
+    }
+    result.emplace_back(static_cast<opentracing::string_view>(item_str));
+  }
+  return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to parse %s: %s", name, e.what());
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseString
+//--------------------------------------------------------------------------------------------------
+static bool parseString(const char* name, PyObject* value,
+                        std::string& result) noexcept try {
+  if (!isString(value)) {
+    PyErr_Format(PyExc_TypeError, "%s must be a string", name);
+    return false;
+  }
+  PythonStringWrapper value_str{value};
+  if (value_str.error()) {
+    return false;
+  }
+  auto value_view = static_cast<opentracing::string_view>(value_str);
+  result.assign(value_view.data(), value_view.size());
+  return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to parse %s: %s", name, e.what());
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseBool
+//--------------------------------------------------------------------------------------------------
+static bool parseBool(const char* name, PyObject* value,
+                      bool& result) noexcept {
+  if (PyBool_Check(value) == 0) {
+    PyErr_Format(PyExc_TypeError, "%s must be a bool", name);
+    return false;
+  }
+  result = value == Py_True;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseDouble
+//--------------------------------------------------------------------------------------------------
+static bool parseDouble(const char* name, PyObject* value, double min_value,
+                        double max_value, double& result) noexcept {
+  if (PyFloat_Check(value) == 0 && !isInt(value)) {
+    PyErr_Format(PyExc_TypeError, "%s must be a number", name);
+    return false;
+  }
+  result = PyFloat_AsDouble(value);
+  if (result == -1.0 && PyErr_Occurred() != nullptr) {
+    return false;
+  }
+  if (!(result >= min_value && result <= max_value)) {
+    PyErr_Format(PyExc_ValueError, "%s must be between %g and %g", name,
+                 min_value, max_value);
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseSize
+//--------------------------------------------------------------------------------------------------
+static bool parseSize(const char* name, PyObject* value, size_t& result) noexcept {
+  long value_long;
+  if (!isInt(value) || !toLong(value, value_long)) {
+    if (PyErr_Occurred() == nullptr) {
+      PyErr_Format(PyExc_TypeError, "%s must be an integer", name);
+    }
+    return false;
+  }
+  if (value_long < 0) {
+    PyErr_Format(PyExc_ValueError, "%s must be non-negative", name);
+    return false;
+  }
+  result = static_cast<size_t>(value_long);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseRateLimits
+//--------------------------------------------------------------------------------------------------
+static bool parseRateLimits(
+    const char* name, PyObject* value,
+    std::vector<std::pair<std::string, double>>& result) noexcept try {
+  if (PyDict_Check(value) == 0) {
+    PyErr_Format(PyExc_TypeError,
+                 "%s must be a dict mapping strings to numbers", name);
+    return false;
+  }
+  result.clear();
+  PyObject* key;
+  PyObject* rate;
+  Py_ssize_t position = 0;
+  while (PyDict_Next(value, &position, &key, &rate) == 1) {
+    if (!isString(key)) {
+      PyErr_Format(PyExc_TypeError,
+                   "%s must be a dict mapping strings to numbers", name);
+      return false;
+    }
+    PythonStringWrapper key_str{key};
+    if (key_str.error()) {
+      return false;
+    }
+    double rate_value;
+    if (!parseDouble(name, rate, 0, MaxOperationRateLimit, rate_value)) {
+      return false;
+    }
+    result.emplace_back(static_cast<opentracing::string_view>(key_str),
+                        rate_value);
+  }
+  return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to parse %s: %s", name, e.what());
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseTracerOptions
+//--------------------------------------------------------------------------------------------------
+bool parseTracerOptions(PyObject* options, TracerOptions& tracer_options) noexcept try {
+  if (options == nullptr || options == Py_None) {
+    return true;
+  }
+  if (PyDict_Check(options) == 0) {
+    PyErr_Format(PyExc_TypeError, "tracer options must be a dict");
+    return false;
+  }
+  PyObject* key;
+  PyObject* value;
+  Py_ssize_t position = 0;
+  while (PyDict_Next(options, &position, &key, &value) == 1) {
+    PythonStringWrapper key_str{key};
+    if (key_str.error()) {
+      return false;
+    }
+    auto name = static_cast<opentracing::string_view>(key_str);
+    if (name == "propagation_key_prefixes") {
+      if (!parseStringList("propagation_key_prefixes", value,
+                           tracer_options.propagation_key_prefixes)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "sample_rate") {
+      if (!parseDouble("sample_rate", value, 0, 1,
+                       tracer_options.sample_rate)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "denied_operations") {
+      if (!parseStringList("denied_operations", value,
+                           tracer_options.denied_operations)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "operation_rate_limits") {
+      if (!parseRateLimits("operation_rate_limits", value,
+                           tracer_options.operation_rate_limits)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "export_queue_size") {
+      if (!parseSize("export_queue_size", value,
+                     tracer_options.export_queue_size)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "overhead_sample_interval") {
+      if (!parseSize("overhead_sample_interval", value,
+                     tracer_options.overhead_sample_interval)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "red_metrics_max_operations") {
+      if (!parseSize("red_metrics_max_operations", value,
+                     tracer_options.red_metrics_max_operations)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "tail_sampling_max_spans") {
+      if (!parseSize("tail_sampling_max_spans", value,
+                     tracer_options.tail_sampling_max_spans)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "tail_sampling_min_duration") {
+      if (!parseDouble("tail_sampling_min_duration", value, 0,
+                       MaxTailSamplingMinDuration,
+                       tracer_options.tail_sampling_min_duration)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "tail_sampling_operations") {
+      if (!parseStringList("tail_sampling_operations", value,
+                           tracer_options.tail_sampling_operations)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "max_logs_per_span") {
+      if (!parseSize("max_logs_per_span", value,
+                     tracer_options.max_logs_per_span)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "max_log_bytes_per_span") {
+      if (!parseSize("max_log_bytes_per_span", value,
+                     tracer_options.max_log_bytes_per_span)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "max_value_length") {
+      if (!parseSize("max_value_length", value,
+                     tracer_options.max_value_length)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "value_truncation_marker") {
+      if (!parseString("value_truncation_marker", value,
+                       tracer_options.value_truncation_marker)) {
+        return false;
+      }
+      continue;
+    }
+    if (name == "track_live_spans") {
+      if (!parseBool("track_live_spans", value,
+                     tracer_options.track_live_spans)) {
+        return false;
+      }
+      continue;
+    }
+    PyErr_Format(PyExc_TypeError, "unknown tracer option '%s'",
+                 std::string{name}.c_str());
+    return false;
+  }
+  return true;
+} catch (const std::exception& e) {
+  PyErr_Format(PyExc_MemoryError, "failed to parse tracer options: %s",
+               e.what());
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// splitTracerOptions
+//--------------------------------------------------------------------------------------------------
+bool splitTracerOptions(PyObject* keywords, char** keyword_names,
+                        PythonObjectWrapper& named_keywords,
+                        PythonObjectWrapper& option_keywords) noexcept {
+  if (keywords == nullptr) {
+    return true;
+  }
+  named_keywords = PyDict_New();
+  if (named_keywords.error()) {
+    return false;
+  }
+  option_keywords = PyDict_New();
+  if (option_keywords.error()) {
+    return false;
+  }
+  PyObject* key;
+  PyObject* value;
+  Py_ssize_t position = 0;
+  while (PyDict_Next(keywords, &position, &key, &value) == 1) {
+    PythonStringWrapper key_str{key};
+    if (key_str.error()) {
+      return false;
+    }
+    auto is_named = false;
+    for (auto keyword_name = keyword_names; *keyword_name != nullptr;
+         ++keyword_name) {
+      if (static_cast<opentracing::string_view>(key_str) ==
+          opentracing::string_view{*keyword_name}) {
+        is_named = true;
+        break;
+      }
+    }
+    auto& destination = is_named ? named_keywords : option_keywords;
+    if (PyDict_SetItem(destination, key, value) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,65 @@
+#include "tracer_stats.h"
+
+#include "python_bridge_tracer/python_object_wrapper.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+TracerStats::TracerStats() noexcept {
+  for (auto& shard : shards_) {
+    for (auto& count : shard.counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// getShardIndex
+//--------------------------------------------------------------------------------------------------
+// Threads are assigned shards round-robin, so up to NumShards threads never
+// share a cache line.
+size_t TracerStats::getShardIndex() noexcept {
+  static std::atomic<size_t> next_shard_index{0};
+  thread_local size_t shard_index =
+      next_shard_index.fetch_add(1, std::memory_order_relaxed) % NumShards;
+  return shard_index;
+}
+
+//--------------------------------------------------------------------------------------------------
+// get
+//--------------------------------------------------------------------------------------------------
+uint64_t TracerStats::get(Counter counter) const noexcept {
+  uint64_t result = 0;
+  for (auto& shard : shards_) {
+    result += shard.counts[counter].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// toPyDict
+//--------------------------------------------------------------------------------------------------
+PyObject* TracerStats::toPyDict() const noexcept {
+  static const char* const counter_names[NumCounters] = {
+      "spans_started", "spans_finished", "unfinished_spans_deallocated",
+      "tags_set", "logs_set", "logs_dropped", "injects", "inject_failures",
+      "inject_cache_hits", "extracts", "extract_failures",
+      "binary_bytes_injected"};
+  PythonObjectWrapper result = PyDict_New();
+  if (result.error()) {
+    return nullptr;
+  }
+  for (int i = 0; i < NumCounters; ++i) {
+    PythonObjectWrapper count =
+        PyLong_FromUnsignedLongLong(get(static_cast<Counter>(i)));
+    if (count.error()) {
+      return nullptr;
+    }
+    if (PyDict_SetItemString(result, counter_names[i], count) != 0) {
+      return nullptr;
+    }
+  }
+  return result.release();
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Python.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace python_bridge_tracer {
+/**
+ * Counters of the work done by a tracer bridge.
+ *
+ * Each thread increments its own cache-line padded shard with relaxed atomics
+ * so that counting on the hot path doesn't contend; the shards are only
+ * summed when the statistics are read.
+ */
+class TracerStats {
+ public:
+  enum Counter {
+    SpansStarted,
+    SpansFinished,
+    UnfinishedSpansDeallocated,
+    TagsSet,
+    LogsSet,
+    LogsDropped,
+    Injects,
+    InjectFailures,
+    InjectCacheHits,
+    Extracts,
+    ExtractFailures,
+    BinaryBytesInjected,
+    NumCounters
+  };
+
+  TracerStats() noexcept;
+
+  TracerStats(const TracerStats&) = delete;
+  TracerStats& operator=(const TracerStats&) = delete;
+
+  /**
+   * Add to a counter.
+   * @param counter the counter to add to
+   * @param amount the amount to add
+   */
+  void increment(Counter counter, uint64_t amount = 1) noexcept {
+    shards_[getShardIndex()].counts[counter].fetch_add(
+        amount, std::memory_order_relaxed);
+  }
+
+  /**
+   * @param counter the counter to read
+   * @return the counter's value summed across threads
+   */
+  uint64_t get(Counter counter) const noexcept;
+
+  /**
+   * @return a dictionary mapping each counter's name to its value
+   */
+  PyObject* toPyDict() const noexcept;
+
+ private:
+  static const size_t NumShards = 16;
+  static const size_t CacheLineSize = 64;
+
+  // Tracer bridges are allocated with new, which doesn't honor over-aligned
+  // types before C++17, so rather than relying on alignas the counters of
+  // adjacent shards are kept at least a full cache line apart.
+  struct Shard {
+    std::atomic<uint64_t> counts[NumCounters];
+    char padding[2 * CacheLineSize -
+                 (NumCounters * sizeof(uint64_t)) % CacheLineSize];
+  };
+
+  std::array<Shard, NumShards> shards_;
+
+  static size_t getShardIndex() noexcept;
+};
+} // namespace python_bridge_tracer
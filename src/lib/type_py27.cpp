@@ -1,4 +1,5 @@
 #include "python_bridge_tracer/type.h"
+#include "python_bridge_tracer/utility.h"
 #include "python_bridge_tracer/version.h"
 
 #ifndef PYTHON_BRIDGE_TRACER_PY3
@@ -12,5 +13,9 @@ PyObject* makeTypeImpl(PyTypeObject& type) noexcept {
   Py_INCREF(type_obj);
   return type_obj;
 }
+
+bool hasDealloc(PyObject* object, void* dealloc) noexcept {
+  return toVoidPtr(Py_TYPE(object)->tp_dealloc) == dealloc;
+}
 }  // namespace python_bridge_tracer
 #endif
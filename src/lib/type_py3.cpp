@@ -26,6 +26,27 @@ static std::vector<PyType_Slot> makeTypeSlots(
   if (type_description.getset != nullptr) {
     result.push_back(PyType_Slot{Py_tp_getset, type_description.getset});
   }
+  if (type_description.call != nullptr) {
+    result.push_back(PyType_Slot{Py_tp_call, type_description.call});
+  }
+  if (type_description.descr_get != nullptr) {
+    result.push_back(PyType_Slot{Py_tp_descr_get, type_description.descr_get});
+  }
+  if (type_description.iter != nullptr) {
+    result.push_back(PyType_Slot{Py_tp_iter, type_description.iter});
+  }
+  if (type_description.iternext != nullptr) {
+    result.push_back(PyType_Slot{Py_tp_iternext, type_description.iternext});
+  }
+  if (type_description.traverse != nullptr) {
+    result.push_back(PyType_Slot{Py_tp_traverse, type_description.traverse});
+  }
+  if (type_description.clear != nullptr) {
+    result.push_back(PyType_Slot{Py_tp_clear, type_description.clear});
+  }
+  if (type_description.await != nullptr) {
+    result.push_back(PyType_Slot{Py_am_await, type_description.await});
+  }
   result.push_back(PyType_Slot{0, nullptr});
   return result;
 }
@@ -37,10 +58,27 @@ PyObject* makeTypeImpl(const TypeDescription& type_description) noexcept {
   assert(type_description.name != nullptr);
   assert(type_description.size > 0);
   auto type_slots = makeTypeSlots(type_description);
+  unsigned flags = Py_TPFLAGS_DEFAULT;
+  if (type_description.traverse != nullptr) {
+    flags |= Py_TPFLAGS_HAVE_GC;
+  }
   PyType_Spec type_spec = {type_description.name,
-                           static_cast<int>(type_description.size), 0,
-                           Py_TPFLAGS_DEFAULT, type_slots.data()};
+                           static_cast<int>(type_description.size), 0, flags,
+                           type_slots.data()};
   return PyType_FromSpec(&type_spec);
 }
+
+//--------------------------------------------------------------------------------------------------
+// hasDealloc
+//--------------------------------------------------------------------------------------------------
+bool hasDealloc(PyObject* object, void* dealloc) noexcept {
+  auto type = Py_TYPE(object);
+  // PyType_GetSlot only supports heap types, which all of the bridge's classes
+  // are.
+  if ((PyType_GetFlags(type) & Py_TPFLAGS_HEAPTYPE) == 0) {
+    return false;
+  }
+  return PyType_GetSlot(type, Py_tp_dealloc) == dealloc;
+}
 }  // namespace python_bridge_tracer
 #endif
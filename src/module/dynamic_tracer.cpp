@@ -22,6 +22,14 @@ class DynamicSpanContext final : public opentracing::SpanContext {
     span_context_->ForeachBaggageItem(callback);
   }
 
+  std::string ToTraceID() const noexcept override {
+    return span_context_->ToTraceID();
+  }
+
+  std::string ToSpanID() const noexcept override {
+    return span_context_->ToSpanID();
+  }
+
  private:
    std::shared_ptr<const opentracing::Tracer> tracer_;
    std::unique_ptr<opentracing::SpanContext> span_context_;
@@ -1,35 +1,145 @@
 #include <Python.h>
 
 #include "python_bridge_tracer/module.h"
+#include "python_bridge_tracer/python_object_wrapper.h"
 
 #include "dynamic_tracer.h"
+#include "recording_tracer.h"
+#include "shm_ring_recorder.h"
+#include "uds_batch_reporter.h"
 
 namespace python_bridge_tracer {
+// Bounds uds_reporter_linger so that it converts to microseconds without
+// overflowing.
+const double MaxUdsReporterLinger = 3600;
+
 //--------------------------------------------------------------------------------------------------
 // loadTracer
 //--------------------------------------------------------------------------------------------------
-static PyObject* loadTracer(PyObject* /*self*/, PyObject* args, PyObject* keywords) noexcept try {
+static PyObject* loadTracer(PyObject* self, PyObject* args, PyObject* keywords) noexcept try {
   static char* keyword_names[] = {const_cast<char*>("library"),
                                   const_cast<char*>("config"),
-                                  const_cast<char*>("scope_manager"), nullptr};
+                                  const_cast<char*>("scope_manager"),
+                                  const_cast<char*>("shm_recorder_path"),
+                                  const_cast<char*>("shm_recorder_slots"),
+                                  const_cast<char*>("uds_reporter_path"),
+                                  const_cast<char*>("uds_reporter_batch_size"),
+                                  const_cast<char*>("uds_reporter_linger"),
+                                  nullptr};
+  PythonObjectWrapper named_keywords;
+  PythonObjectWrapper option_keywords;
+  if (!splitTracerOptions(keywords, keyword_names, named_keywords, option_keywords)) {
+    return nullptr;
+  }
   char* library;
-  char* config;
+  char* config = nullptr;
   PyObject* scope_manager = nullptr;
-  if (PyArg_ParseTupleAndKeywords(args, keywords, "ss|O:load_tracer", keyword_names, 
-        &library, &config, &scope_manager) == 0) {
+  char* shm_recorder_path = nullptr;
+  Py_ssize_t shm_recorder_slots = 4096;
+  char* uds_reporter_path = nullptr;
+  Py_ssize_t uds_reporter_batch_size = 100;
+  double uds_reporter_linger = 0.1;
+  if (PyArg_ParseTupleAndKeywords(
+          args, named_keywords, "z|zOznznd:load_tracer", keyword_names,
+          &library, &config, &scope_manager, &shm_recorder_path,
+          &shm_recorder_slots, &uds_reporter_path, &uds_reporter_batch_size,
+          &uds_reporter_linger) == 0) {
+    return nullptr;
+  }
+  if (shm_recorder_slots <= 0) {
+    PyErr_Format(PyExc_ValueError, "shm_recorder_slots must be positive");
+    return nullptr;
+  }
+  if (uds_reporter_batch_size <= 0) {
+    PyErr_Format(PyExc_ValueError, "uds_reporter_batch_size must be positive");
+    return nullptr;
+  }
+  if (!(uds_reporter_linger >= 0 &&
+        uds_reporter_linger <= MaxUdsReporterLinger)) {
+    PyErr_Format(PyExc_ValueError,
+                 "uds_reporter_linger must be between 0 and %d seconds",
+                 static_cast<int>(MaxUdsReporterLinger));
     return nullptr;
   }
-  return makeTracer(makeDynamicTracer(library, config), scope_manager);
+  if (shm_recorder_path != nullptr && uds_reporter_path != nullptr) {
+    PyErr_Format(PyExc_ValueError,
+                 "shm_recorder_path and uds_reporter_path are exclusive");
+    return nullptr;
+  }
+  if (library != nullptr &&
+      (shm_recorder_path != nullptr || uds_reporter_path != nullptr)) {
+    PyErr_Format(PyExc_ValueError,
+                 "shm_recorder_path and uds_reporter_path can't be used with "
+                 "library %s",
+                 library);
+    return nullptr;
+  }
+  TracerOptions options;
+  if (!parseTracerOptions(option_keywords, options)) {
+    return nullptr;
+  }
+  if (library == nullptr && shm_recorder_path != nullptr) {
+    auto recorder = makeShmRingRecorder(
+        shm_recorder_path, static_cast<size_t>(shm_recorder_slots));
+    return makeTracer(self, makeRecordingTracer(std::move(recorder)),
+                      scope_manager, options);
+  }
+  if (library == nullptr && uds_reporter_path != nullptr) {
+    auto recorder = makeUdsBatchReporter(
+        uds_reporter_path, static_cast<size_t>(uds_reporter_batch_size),
+        std::chrono::microseconds{
+            static_cast<std::chrono::microseconds::rep>(
+                uds_reporter_linger * 1.0e6)});
+    return makeTracer(self, makeRecordingTracer(std::move(recorder)),
+                      scope_manager, options);
+  }
+  if (library == nullptr) {
+    // The no-op tracer has nothing to configure, so reject rather than drop
+    // a config or tracer options that the caller expects to take effect.
+    if (config != nullptr) {
+      PyErr_Format(PyExc_TypeError, "load_tracer got a config without a library");
+      return nullptr;
+    }
+    if (!option_keywords.error() && PyDict_Size(option_keywords) > 0) {
+      PyErr_Format(PyExc_TypeError,
+                   "load_tracer got tracer options without a library, "
+                   "shm_recorder_path or uds_reporter_path");
+      return nullptr;
+    }
+    return makeNoopTracer(self, scope_manager);
+  }
+  if (config == nullptr) {
+    PyErr_Format(PyExc_TypeError, "load_tracer requires a config for library %s",
+                 library);
+    return nullptr;
+  }
+  return makeTracer(self, makeDynamicTracer(library, config), scope_manager,
+                    options);
 } catch(const std::exception& e) {
   PyErr_Format(PyExc_RuntimeError, "failed to load tracer: %s", e.what());
   return nullptr;
 }
 
+//--------------------------------------------------------------------------------------------------
+// noopTracer
+//--------------------------------------------------------------------------------------------------
+static PyObject* noopTracer(PyObject* self, PyObject* args, PyObject* keywords) noexcept {
+  static char* keyword_names[] = {const_cast<char*>("scope_manager"), nullptr};
+  PyObject* scope_manager = nullptr;
+  if (PyArg_ParseTupleAndKeywords(args, keywords, "|O:noop_tracer", keyword_names,
+        &scope_manager) == 0) {
+    return nullptr;
+  }
+  return makeNoopTracer(self, scope_manager);
+}
+
 //--------------------------------------------------------------------------------------------------
 // flush
 //--------------------------------------------------------------------------------------------------
-void flush(opentracing::Tracer& /*tracer*/, std::chrono::microseconds /*timeout*/) noexcept {
-  // Do nothing not part of the OpenTracing API.
+void flush(opentracing::Tracer& tracer, std::chrono::microseconds timeout) noexcept {
+  // Plugins can't be flushed since it's not part of the OpenTracing API, but
+  // the built-in recorders can.
+  flushRecordingTracer(tracer, timeout);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -37,8 +147,25 @@ void flush(opentracing::Tracer& /*tracer*/, std::chrono::microseconds /*timeout*
 //--------------------------------------------------------------------------------------------------
 static PyMethodDef ModuleMethods[] = {
     {"load_tracer", reinterpret_cast<PyCFunction>(loadTracer),
-     METH_VARARGS | METH_KEYWORDS, PyDoc_STR("loads a C++ opentracing plugin")},
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("loads a C++ opentracing plugin or, if library is None, a "
+               "tracer that records spans into the shared memory ring at "
+               "shm_recorder_path, a tracer that sends batches of spans to "
+               "the unix socket at uds_reporter_path, or a no-op tracer; "
+               "additional keyword arguments are tracer options such as "
+               "propagation_key_prefixes, which the no-op tracer doesn't "
+               "accept")},
+    {"noop_tracer", reinterpret_cast<PyCFunction>(noopTracer),
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("makes a tracer that does nothing")},
     {nullptr, nullptr}};
+
+//--------------------------------------------------------------------------------------------------
+// execModule
+//--------------------------------------------------------------------------------------------------
+static int execModule(PyObject* module) noexcept {
+  return setupClasses(module) ? 0 : -1;
+}
 } // namespace python_bridge_tracer
 
 //--------------------------------------------------------------------------------------------------
@@ -47,13 +174,7 @@ static PyMethodDef ModuleMethods[] = {
 extern "C" {
 PYTHON_BRIDGE_TRACER_DEFINE_MODULE(bridge_tracer) {
   using namespace python_bridge_tracer;
-  auto module = makeModule("bridge_tracer", "bridge a c++ tracer", ModuleMethods);
-  if (module == nullptr) {
-    PYTHON_BRIDGE_TRACER_MODULE_RETURN(nullptr);
-  }
-  if (!setupClasses(module)) {
-    PYTHON_BRIDGE_TRACER_MODULE_RETURN(nullptr);
-  }
-  PYTHON_BRIDGE_TRACER_MODULE_RETURN(module);
+  PYTHON_BRIDGE_TRACER_MODULE_RETURN(makeModule(
+      "bridge_tracer", "bridge a c++ tracer", ModuleMethods, execModule));
 }
 } // extern "C"
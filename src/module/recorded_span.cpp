@@ -0,0 +1,46 @@
+#include "recorded_span.h"
+
+#include <cstdio>
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// copyValue
+//--------------------------------------------------------------------------------------------------
+opentracing::Value copyValue(const opentracing::Value& value) {
+  if (value.is<opentracing::string_view>()) {
+    return std::string{value.get<opentracing::string_view>()};
+  }
+  if (value.is<const char*>()) {
+    return std::string{value.get<const char*>()};
+  }
+  return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendValue
+//--------------------------------------------------------------------------------------------------
+void appendValue(const opentracing::Value& value, std::string& s) {
+  if (value.is<bool>()) {
+    s.append(value.get<bool>() ? "true" : "false");
+  } else if (value.is<double>()) {
+    char buffer[32];
+    auto length = std::snprintf(buffer, sizeof(buffer), "%.17g",
+                                value.get<double>());
+    s.append(buffer, static_cast<size_t>(length));
+  } else if (value.is<int64_t>()) {
+    s.append(std::to_string(value.get<int64_t>()));
+  } else if (value.is<uint64_t>()) {
+    s.append(std::to_string(value.get<uint64_t>()));
+  } else if (value.is<std::string>()) {
+    s.append(value.get<std::string>());
+  } else if (value.is<opentracing::string_view>()) {
+    auto& string_view = value.get<opentracing::string_view>();
+    s.append(string_view.data(), string_view.size());
+  } else if (value.is<const char*>()) {
+    s.append(value.get<const char*>());
+  } else if (value.is<std::nullptr_t>()) {
+    s.append("null");
+  }
+  // Lists and dictionaries aren't produced by the bridge and are left empty.
+}
+} // namespace python_bridge_tracer
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opentracing/span.h>
+
+namespace python_bridge_tracer {
+/**
+ * A span finished by the built-in recording tracer.
+ */
+struct RecordedSpan {
+  uint64_t trace_id;
+  uint64_t span_id;
+  uint64_t parent_span_id;  // 0 if the span has no parent
+  std::string operation_name;
+  opentracing::SystemTime start_timestamp;
+  opentracing::SteadyClock::duration duration;
+  std::vector<std::pair<std::string, opentracing::Value>> tags;
+  std::vector<opentracing::LogRecord> logs;
+};
+
+/**
+ * Interface for the sinks of the built-in recording tracer.
+ */
+class Recorder {
+ public:
+  virtual ~Recorder() noexcept = default;
+
+  /**
+   * Record a finished span. Called from the thread that finished the span.
+   * @param span the finished span
+   */
+  virtual void recordSpan(const RecordedSpan& span) noexcept = 0;
+
+  /**
+   * Wait until the spans recorded so far are delivered.
+   * @param timeout how long to wait or zero to wait indefinitely
+   */
+  virtual void flush(std::chrono::microseconds /*timeout*/) noexcept {}
+};
+
+/**
+ * Copy a tag or log value so that it no longer references memory owned by the
+ * caller.
+ * @param value the value to copy
+ * @return a value that owns its string data
+ */
+opentracing::Value copyValue(const opentracing::Value& value);
+
+/**
+ * Append the string representation of a tag or log value.
+ * @param value the value to convert
+ * @param s the string to append to
+ */
+void appendValue(const opentracing::Value& value, std::string& s);
+} // namespace python_bridge_tracer
@@ -0,0 +1,533 @@
+#include "recording_tracer.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <random>
+#include <unordered_map>
+
+namespace python_bridge_tracer {
+using Baggage = std::unordered_map<std::string, std::string>;
+
+const opentracing::string_view TraceIdKey = "ot-tracer-traceid";
+const opentracing::string_view SpanIdKey = "ot-tracer-spanid";
+const opentracing::string_view SampledKey = "ot-tracer-sampled";
+const opentracing::string_view BaggagePrefix = "ot-baggage-";
+
+//--------------------------------------------------------------------------------------------------
+// generateId
+//--------------------------------------------------------------------------------------------------
+static uint64_t generateId() noexcept {
+  thread_local std::mt19937_64 random_number_generator{std::random_device{}()};
+  uint64_t result;
+  do {
+    result = random_number_generator();
+  } while (result == 0);
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// toHex
+//--------------------------------------------------------------------------------------------------
+static std::string toHex(uint64_t id) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(id));
+  return buffer;
+}
+
+//--------------------------------------------------------------------------------------------------
+// parseHexId
+//--------------------------------------------------------------------------------------------------
+static bool parseHexId(opentracing::string_view s, uint64_t& id) {
+  if (s.size() == 0 || s.size() > 16) {
+    return false;
+  }
+  id = 0;
+  for (auto c : s) {
+    id <<= 4;
+    if (c >= '0' && c <= '9') {
+      id |= static_cast<uint64_t>(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      id |= static_cast<uint64_t>(c - 'a' + 10);
+    } else if (c >= 'A' && c <= 'F') {
+      id |= static_cast<uint64_t>(c - 'A' + 10);
+    } else {
+      return false;
+    }
+  }
+  return id != 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// startsWithIgnoreCase
+//--------------------------------------------------------------------------------------------------
+// HTTP header keys may have their case changed in transit.
+static bool startsWithIgnoreCase(opentracing::string_view s,
+                                 opentracing::string_view prefix) noexcept {
+  if (s.size() < prefix.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < prefix.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(s.data()[i])) !=
+        std::tolower(static_cast<unsigned char>(prefix.data()[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// equalsIgnoreCase
+//--------------------------------------------------------------------------------------------------
+static bool equalsIgnoreCase(opentracing::string_view lhs,
+                             opentracing::string_view rhs) noexcept {
+  return lhs.size() == rhs.size() && startsWithIgnoreCase(lhs, rhs);
+}
+
+//--------------------------------------------------------------------------------------------------
+// writeUint
+//--------------------------------------------------------------------------------------------------
+// The binary format uses big-endian integers.
+static void writeUint(std::ostream& writer, uint64_t x, int num_bytes) {
+  char buffer[8];
+  for (int i = num_bytes - 1; i >= 0; --i) {
+    buffer[i] = static_cast<char>(x & 0xff);
+    x >>= 8;
+  }
+  writer.write(buffer, num_bytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+// readUint
+//--------------------------------------------------------------------------------------------------
+static bool readUint(std::istream& reader, uint64_t& x, int num_bytes) {
+  char buffer[8];
+  if (!reader.read(buffer, num_bytes)) {
+    return false;
+  }
+  x = 0;
+  for (int i = 0; i < num_bytes; ++i) {
+    x = (x << 8) | static_cast<unsigned char>(buffer[i]);
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// readString
+//--------------------------------------------------------------------------------------------------
+static bool readString(std::istream& reader, std::string& s) {
+  uint64_t size;
+  if (!readUint(reader, size, 4)) {
+    return false;
+  }
+  // Guard against allocating for a corrupted size.
+  const uint64_t max_size = 1 << 20;
+  if (size > max_size) {
+    return false;
+  }
+  s.resize(static_cast<size_t>(size));
+  return size == 0 ||
+         static_cast<bool>(reader.read(&s[0], static_cast<std::streamsize>(size)));
+}
+
+//--------------------------------------------------------------------------------------------------
+// RecordingSpanContext
+//--------------------------------------------------------------------------------------------------
+namespace {
+class RecordingSpanContext final : public opentracing::SpanContext {
+ public:
+  RecordingSpanContext(uint64_t trace_id, uint64_t span_id,
+                       Baggage&& baggage) noexcept
+      : trace_id_{trace_id}, span_id_{span_id}, baggage_{std::move(baggage)} {}
+
+  uint64_t trace_id() const noexcept { return trace_id_; }
+
+  uint64_t span_id() const noexcept { return span_id_; }
+
+  void setBaggageItem(opentracing::string_view key,
+                      opentracing::string_view value) {
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    baggage_[key] = value;
+  }
+
+  std::string baggageItem(opentracing::string_view key) const {
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    auto iter = baggage_.find(key);
+    if (iter == baggage_.end()) {
+      return {};
+    }
+    return iter->second;
+  }
+
+  void ForeachBaggageItem(
+      std::function<bool(const std::string&, const std::string&)> callback)
+      const override {
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    for (auto& item : baggage_) {
+      if (!callback(item.first, item.second)) {
+        return;
+      }
+    }
+  }
+
+  std::string ToTraceID() const noexcept override { return toHex(trace_id_); }
+
+  std::string ToSpanID() const noexcept override { return toHex(span_id_); }
+
+ private:
+  uint64_t trace_id_;
+  uint64_t span_id_;
+  mutable std::mutex mutex_;
+  Baggage baggage_;
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// RecordingSpan
+//--------------------------------------------------------------------------------------------------
+namespace {
+class RecordingSpan final : public opentracing::Span {
+ public:
+  RecordingSpan(std::shared_ptr<const opentracing::Tracer> tracer,
+                Recorder& recorder, RecordedSpan&& span,
+                opentracing::SteadyTime start_steady_timestamp,
+                Baggage&& baggage) noexcept
+      : tracer_{std::move(tracer)},
+        recorder_{recorder},
+        span_{std::move(span)},
+        start_steady_timestamp_{start_steady_timestamp},
+        context_{span_.trace_id, span_.span_id, std::move(baggage)} {}
+
+  ~RecordingSpan() noexcept override {
+    FinishWithOptions(opentracing::FinishSpanOptions{});
+  }
+
+ private:
+  std::shared_ptr<const opentracing::Tracer> tracer_;
+  Recorder& recorder_;
+  std::mutex mutex_;
+  RecordedSpan span_;
+  opentracing::SteadyTime start_steady_timestamp_;
+  RecordingSpanContext context_;
+  std::atomic<bool> is_finished_{false};
+
+  void FinishWithOptions(const opentracing::FinishSpanOptions&
+                             finish_span_options) noexcept override try {
+    if (is_finished_.exchange(true)) {
+      return;
+    }
+    auto finish_steady_timestamp = finish_span_options.finish_steady_timestamp;
+    if (finish_steady_timestamp == opentracing::SteadyTime{}) {
+      finish_steady_timestamp = opentracing::SteadyClock::now();
+    }
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    span_.duration = finish_steady_timestamp - start_steady_timestamp_;
+    for (auto& log_record : finish_span_options.log_records) {
+      span_.logs.emplace_back();
+      auto& log_record_copy = span_.logs.back();
+      log_record_copy.timestamp = log_record.timestamp;
+      for (auto& field : log_record.fields) {
+        log_record_copy.fields.emplace_back(field.first, copyValue(field.second));
+      }
+    }
+    recorder_.recordSpan(span_);
+  } catch (const std::exception& /*e*/) {
+    // Drop the span if it can't be copied.
+  }
+
+  void SetOperationName(opentracing::string_view name) noexcept override try {
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    span_.operation_name = name;
+  } catch (const std::exception& /*e*/) {
+  }
+
+  void SetTag(opentracing::string_view key,
+              const opentracing::Value& value) noexcept override try {
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    for (auto& tag : span_.tags) {
+      if (tag.first == key) {
+        tag.second = copyValue(value);
+        return;
+      }
+    }
+    span_.tags.emplace_back(key, copyValue(value));
+  } catch (const std::exception& /*e*/) {
+  }
+
+  void SetBaggageItem(opentracing::string_view restricted_key,
+                      opentracing::string_view value) noexcept override try {
+    context_.setBaggageItem(restricted_key, value);
+  } catch (const std::exception& /*e*/) {
+  }
+
+  std::string BaggageItem(opentracing::string_view restricted_key) const
+      noexcept override try {
+    return context_.baggageItem(restricted_key);
+  } catch (const std::exception& /*e*/) {
+    return {};
+  }
+
+  void Log(std::initializer_list<
+           std::pair<opentracing::string_view, opentracing::Value>>
+               fields) noexcept override try {
+    opentracing::LogRecord log_record;
+    log_record.timestamp = opentracing::SystemClock::now();
+    for (auto& field : fields) {
+      log_record.fields.emplace_back(field.first, copyValue(field.second));
+    }
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    span_.logs.emplace_back(std::move(log_record));
+  } catch (const std::exception& /*e*/) {
+  }
+
+  const opentracing::SpanContext& context() const noexcept override {
+    return context_;
+  }
+
+  const opentracing::Tracer& tracer() const noexcept override { return *tracer_; }
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// RecordingTracer
+//--------------------------------------------------------------------------------------------------
+namespace {
+class RecordingTracer final : public opentracing::Tracer,
+                              public std::enable_shared_from_this<RecordingTracer> {
+ public:
+  explicit RecordingTracer(std::unique_ptr<Recorder>&& recorder) noexcept
+      : recorder_{std::move(recorder)} {}
+
+  void flush(std::chrono::microseconds timeout) noexcept {
+    recorder_->flush(timeout);
+  }
+
+ private:
+  std::unique_ptr<Recorder> recorder_;
+
+  std::unique_ptr<opentracing::Span> StartSpanWithOptions(
+      opentracing::string_view operation_name,
+      const opentracing::StartSpanOptions& options) const noexcept override try {
+    RecordedSpan span;
+    span.parent_span_id = 0;
+    Baggage baggage;
+    for (auto& reference : options.references) {
+      auto span_context =
+          dynamic_cast<const RecordingSpanContext*>(reference.second);
+      if (span_context == nullptr) {
+        continue;
+      }
+      if (span.parent_span_id == 0) {
+        span.trace_id = span_context->trace_id();
+        span.parent_span_id = span_context->span_id();
+      }
+      span_context->ForeachBaggageItem(
+          [&baggage](const std::string& key, const std::string& value) {
+            baggage.emplace(key, value);
+            return true;
+          });
+    }
+    span.span_id = generateId();
+    if (span.parent_span_id == 0) {
+      span.trace_id = span.span_id;
+    }
+    span.operation_name = operation_name;
+    span.start_timestamp = options.start_system_timestamp;
+    auto start_steady_timestamp = options.start_steady_timestamp;
+    if (span.start_timestamp == opentracing::SystemTime{}) {
+      span.start_timestamp = opentracing::SystemClock::now();
+    }
+    if (start_steady_timestamp == opentracing::SteadyTime{}) {
+      start_steady_timestamp =
+          options.start_system_timestamp == opentracing::SystemTime{}
+              ? opentracing::SteadyClock::now()
+              : opentracing::convert_time_point<opentracing::SteadyClock>(
+                    span.start_timestamp);
+    }
+    span.tags.reserve(options.tags.size());
+    for (auto& tag : options.tags) {
+      span.tags.emplace_back(tag.first, copyValue(tag.second));
+    }
+    return std::unique_ptr<opentracing::Span>{new RecordingSpan{
+        shared_from_this(), *recorder_, std::move(span),
+        start_steady_timestamp, std::move(baggage)}};
+  } catch (const std::exception& /*e*/) {
+    return nullptr;
+  }
+
+  opentracing::expected<void> Inject(const opentracing::SpanContext& sc,
+                                     std::ostream& writer) const override {
+    auto span_context = dynamic_cast<const RecordingSpanContext*>(&sc);
+    if (span_context == nullptr) {
+      return opentracing::make_unexpected(
+          opentracing::invalid_span_context_error);
+    }
+    std::vector<std::pair<std::string, std::string>> baggage;
+    span_context->ForeachBaggageItem(
+        [&baggage](const std::string& key, const std::string& value) {
+          baggage.emplace_back(key, value);
+          return true;
+        });
+    writeUint(writer, span_context->trace_id(), 8);
+    writeUint(writer, span_context->span_id(), 8);
+    writeUint(writer, baggage.size(), 4);
+    for (auto& item : baggage) {
+      writeUint(writer, item.first.size(), 4);
+      writer.write(item.first.data(),
+                   static_cast<std::streamsize>(item.first.size()));
+      writeUint(writer, item.second.size(), 4);
+      writer.write(item.second.data(),
+                   static_cast<std::streamsize>(item.second.size()));
+    }
+    if (!writer) {
+      return opentracing::make_unexpected(
+          std::make_error_code(std::errc::io_error));
+    }
+    return {};
+  }
+
+  opentracing::expected<void> Inject(
+      const opentracing::SpanContext& sc,
+      const opentracing::TextMapWriter& writer) const override {
+    return this->InjectImpl(sc, writer);
+  }
+
+  opentracing::expected<void> Inject(
+      const opentracing::SpanContext& sc,
+      const opentracing::HTTPHeadersWriter& writer) const override {
+    return this->InjectImpl(sc, writer);
+  }
+
+  template <class Writer>
+  opentracing::expected<void> InjectImpl(const opentracing::SpanContext& sc,
+                                         const Writer& writer) const {
+    auto span_context = dynamic_cast<const RecordingSpanContext*>(&sc);
+    if (span_context == nullptr) {
+      return opentracing::make_unexpected(
+          opentracing::invalid_span_context_error);
+    }
+    auto result = writer.Set(TraceIdKey, toHex(span_context->trace_id()));
+    if (!result) {
+      return result;
+    }
+    result = writer.Set(SpanIdKey, toHex(span_context->span_id()));
+    if (!result) {
+      return result;
+    }
+    result = writer.Set(SampledKey, "true");
+    if (!result) {
+      return result;
+    }
+    std::string key;
+    span_context->ForeachBaggageItem(
+        [&](const std::string& baggage_key, const std::string& value) {
+          key.assign(BaggagePrefix.data(), BaggagePrefix.size());
+          key.append(baggage_key);
+          result = writer.Set(key, value);
+          return static_cast<bool>(result);
+        });
+    return result;
+  }
+
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> Extract(
+      std::istream& reader) const override {
+    if (reader.peek() == std::istream::traits_type::eof()) {
+      return std::unique_ptr<opentracing::SpanContext>{};
+    }
+    uint64_t trace_id;
+    uint64_t span_id;
+    uint64_t num_baggage_items;
+    if (!readUint(reader, trace_id, 8) || !readUint(reader, span_id, 8) ||
+        !readUint(reader, num_baggage_items, 4)) {
+      return opentracing::make_unexpected(
+          opentracing::span_context_corrupted_error);
+    }
+    Baggage baggage;
+    std::string key;
+    std::string value;
+    for (uint64_t i = 0; i < num_baggage_items; ++i) {
+      if (!readString(reader, key) || !readString(reader, value)) {
+        return opentracing::make_unexpected(
+            opentracing::span_context_corrupted_error);
+      }
+      baggage[key] = value;
+    }
+    return std::unique_ptr<opentracing::SpanContext>{
+        new RecordingSpanContext{trace_id, span_id, std::move(baggage)}};
+  }
+
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> Extract(
+      const opentracing::TextMapReader& reader) const override {
+    return this->ExtractImpl(reader);
+  }
+
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> Extract(
+      const opentracing::HTTPHeadersReader& reader) const override {
+    return this->ExtractImpl(reader);
+  }
+
+  template <class Reader>
+  opentracing::expected<std::unique_ptr<opentracing::SpanContext>> ExtractImpl(
+      const Reader& reader) const {
+    uint64_t trace_id = 0;
+    uint64_t span_id = 0;
+    auto is_corrupted = false;
+    Baggage baggage;
+    auto result = reader.ForeachKey(
+        [&](opentracing::string_view key,
+            opentracing::string_view value) -> opentracing::expected<void> {
+          if (equalsIgnoreCase(key, TraceIdKey)) {
+            is_corrupted = is_corrupted || !parseHexId(value, trace_id);
+          } else if (equalsIgnoreCase(key, SpanIdKey)) {
+            is_corrupted = is_corrupted || !parseHexId(value, span_id);
+          } else if (startsWithIgnoreCase(key, BaggagePrefix)) {
+            baggage[std::string{key.data() + BaggagePrefix.size(),
+                                key.size() - BaggagePrefix.size()}] = value;
+          }
+          return {};
+        });
+    if (!result) {
+      return opentracing::make_unexpected(result.error());
+    }
+    if (trace_id == 0 && span_id == 0 && baggage.empty() && !is_corrupted) {
+      return std::unique_ptr<opentracing::SpanContext>{};
+    }
+    if (is_corrupted || trace_id == 0 || span_id == 0) {
+      return opentracing::make_unexpected(
+          opentracing::span_context_corrupted_error);
+    }
+    return std::unique_ptr<opentracing::SpanContext>{
+        new RecordingSpanContext{trace_id, span_id, std::move(baggage)}};
+  }
+
+  void Close() noexcept override {
+    recorder_->flush(std::chrono::microseconds::zero());
+  }
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// makeRecordingTracer
+//--------------------------------------------------------------------------------------------------
+std::shared_ptr<opentracing::Tracer> makeRecordingTracer(
+    std::unique_ptr<Recorder>&& recorder) {
+  return std::make_shared<RecordingTracer>(std::move(recorder));
+}
+
+//--------------------------------------------------------------------------------------------------
+// flushRecordingTracer
+//--------------------------------------------------------------------------------------------------
+bool flushRecordingTracer(opentracing::Tracer& tracer,
+                          std::chrono::microseconds timeout) noexcept {
+  auto recording_tracer = dynamic_cast<RecordingTracer*>(&tracer);
+  if (recording_tracer == nullptr) {
+    return false;
+  }
+  recording_tracer->flush(timeout);
+  return true;
+}
+}  // namespace python_bridge_tracer
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+
+#include <opentracing/tracer.h>
+
+#include "recorded_span.h"
+
+namespace python_bridge_tracer {
+/**
+ * Create a tracer that generates its own ids and hands finished spans to a
+ * recorder instead of loading a vendor plugin.
+ *
+ * Span contexts are propagated with the ot-tracer-traceid, ot-tracer-spanid
+ * and ot-baggage-* keys.
+ * @param recorder the sink for finished spans
+ * @return the tracer
+ */
+std::shared_ptr<opentracing::Tracer> makeRecordingTracer(
+    std::unique_ptr<Recorder>&& recorder);
+
+/**
+ * Flush the recorder of a tracer made by makeRecordingTracer.
+ * @param tracer the tracer
+ * @param timeout how long to wait or zero to wait indefinitely
+ * @return false if tracer isn't a recording tracer
+ */
+bool flushRecordingTracer(opentracing::Tracer& tracer,
+                          std::chrono::microseconds timeout) noexcept;
+}  // namespace python_bridge_tracer
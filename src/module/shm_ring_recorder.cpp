@@ -0,0 +1,153 @@
+#include "shm_ring_recorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "shm_ring/shm_ring_format.h"
+
+namespace python_bridge_tracer {
+//--------------------------------------------------------------------------------------------------
+// makeError
+//--------------------------------------------------------------------------------------------------
+static std::runtime_error makeError(const char* path, const char* what) {
+  return std::runtime_error{std::string{what} + " " + path + ": " +
+                            std::strerror(errno)};
+}
+
+//--------------------------------------------------------------------------------------------------
+// toNanoseconds
+//--------------------------------------------------------------------------------------------------
+template <class Duration>
+static int64_t toNanoseconds(Duration duration) noexcept {
+  return static_cast<int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendTag
+//--------------------------------------------------------------------------------------------------
+static bool appendTag(const std::string& key, const std::string& value,
+                      shm_ring::SpanRecord& record) noexcept {
+  const size_t max_length = 255;
+  if (key.size() > max_length || value.size() > max_length) {
+    return false;
+  }
+  auto length = 2 + key.size() + value.size();
+  if (record.tags_length + length > shm_ring::MaxTagsLength) {
+    return false;
+  }
+  auto data = record.tags + record.tags_length;
+  data[0] = static_cast<char>(key.size());
+  data[1] = static_cast<char>(value.size());
+  std::memcpy(data + 2, key.data(), key.size());
+  std::memcpy(data + 2 + key.size(), value.data(), value.size());
+  record.tags_length = static_cast<uint16_t>(record.tags_length + length);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// encodeSpan
+//--------------------------------------------------------------------------------------------------
+static void encodeSpan(const RecordedSpan& span, shm_ring::SpanRecord& record) {
+  record.trace_id = span.trace_id;
+  record.span_id = span.span_id;
+  record.parent_span_id = span.parent_span_id;
+  record.start_timestamp = toNanoseconds(span.start_timestamp.time_since_epoch());
+  record.duration = toNanoseconds(span.duration);
+  record.flags = 0;
+  auto operation_name_length = span.operation_name.size();
+  if (operation_name_length > shm_ring::MaxOperationNameLength) {
+    operation_name_length = shm_ring::MaxOperationNameLength;
+    record.flags |= shm_ring::TruncatedOperationNameFlag;
+  }
+  record.operation_name_length = static_cast<uint16_t>(operation_name_length);
+  std::memcpy(record.operation_name, span.operation_name.data(),
+              operation_name_length);
+  record.tags_length = 0;
+  std::string value;
+  for (auto& tag : span.tags) {
+    if (tag.first == "error" && tag.second.is<bool>() && tag.second.get<bool>()) {
+      record.flags |= shm_ring::ErrorFlag;
+    }
+    value.clear();
+    appendValue(tag.second, value);
+    if (!appendTag(tag.first, value, record)) {
+      record.flags |= shm_ring::TruncatedTagsFlag;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// ShmRingRecorder
+//--------------------------------------------------------------------------------------------------
+namespace {
+class ShmRingRecorder final : public Recorder {
+ public:
+  ShmRingRecorder(shm_ring::Header* header, size_t size) noexcept
+      : header_{header}, size_{size} {}
+
+  ~ShmRingRecorder() noexcept override { ::munmap(header_, size_); }
+
+  void recordSpan(const RecordedSpan& span) noexcept override try {
+    shm_ring::SpanRecord record;
+    encodeSpan(span, record);
+
+    // Publish the record with a seqlock so that readers can detect when they
+    // copy a slot that's being overwritten.
+    auto index = header_->write_index.fetch_add(1, std::memory_order_relaxed);
+    auto& slot =
+        shm_ring::getSlots(header_)[index & (header_->slot_count - 1)];
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void*>(&slot.record), &record, sizeof(record));
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+  } catch (const std::exception& /*e*/) {
+    // Drop the span if its tags can't be converted.
+  }
+
+ private:
+  shm_ring::Header* header_;
+  size_t size_;
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// makeShmRingRecorder
+//--------------------------------------------------------------------------------------------------
+std::unique_ptr<Recorder> makeShmRingRecorder(const char* path,
+                                              size_t slot_count) {
+  uint64_t slot_count_prime = 1;
+  while (slot_count_prime < slot_count) {
+    slot_count_prime *= 2;
+  }
+  auto size = shm_ring::getFileSize(slot_count_prime);
+  auto fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    throw makeError(path, "failed to open");
+  }
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    ::close(fd);
+    throw makeError(path, "failed to resize");
+  }
+  auto data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw makeError(path, "failed to map");
+  }
+
+  // The truncated file is zero filled, so only the header needs to be written.
+  auto header = static_cast<shm_ring::Header*>(data);
+  header->version = shm_ring::Version;
+  header->record_size = sizeof(shm_ring::SpanRecord);
+  header->slot_count = slot_count_prime;
+  header->write_index.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = shm_ring::Magic;
+  return std::unique_ptr<Recorder>{new ShmRingRecorder{header, size}};
+}
+}  // namespace python_bridge_tracer
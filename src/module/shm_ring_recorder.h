@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+
+#include "recorded_span.h"
+
+namespace python_bridge_tracer {
+/**
+ * Create a recorder that writes finished spans into a shared memory ring
+ * buffer (see shm_ring/shm_ring_format.h) so that a separate reader process
+ * can export them.
+ * @param path the path of the file to create, usually under /dev/shm
+ * @param slot_count the number of records the ring holds; rounded up to a power
+ * of two
+ * @return the recorder
+ */
+std::unique_ptr<Recorder> makeShmRingRecorder(const char* path,
+                                              size_t slot_count);
+}  // namespace python_bridge_tracer
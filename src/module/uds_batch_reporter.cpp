@@ -0,0 +1,320 @@
+#include "uds_batch_reporter.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace python_bridge_tracer {
+const size_t BatchHeaderSize = 8;
+
+// Batches beyond this that are waiting to be sent are dropped.
+const size_t MaxPendingBatches = 64;
+
+const size_t MaxIovecs = 64;
+
+//--------------------------------------------------------------------------------------------------
+// writeUint
+//--------------------------------------------------------------------------------------------------
+static void writeUint(uint64_t x, int num_bytes, char* data) noexcept {
+  for (int i = num_bytes - 1; i >= 0; --i) {
+    data[i] = static_cast<char>(x & 0xff);
+    x >>= 8;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendUint
+//--------------------------------------------------------------------------------------------------
+static void appendUint(uint64_t x, int num_bytes, std::string& s) {
+  char buffer[8];
+  writeUint(x, num_bytes, buffer);
+  s.append(buffer, static_cast<size_t>(num_bytes));
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendString
+//--------------------------------------------------------------------------------------------------
+static void appendString(const std::string& value, std::string& s) {
+  appendUint(value.size(), 4, s);
+  s.append(value);
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendField
+//--------------------------------------------------------------------------------------------------
+static void appendField(const std::string& key, const opentracing::Value& value,
+                        std::string& s) {
+  appendString(key, s);
+  auto length_position = s.size();
+  s.append(4, '\0');
+  appendValue(value, s);
+  writeUint(s.size() - length_position - 4, 4, &s[length_position]);
+}
+
+//--------------------------------------------------------------------------------------------------
+// toNanoseconds
+//--------------------------------------------------------------------------------------------------
+template <class Duration>
+static uint64_t toNanoseconds(Duration duration) noexcept {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+//--------------------------------------------------------------------------------------------------
+// encodeSpan
+//--------------------------------------------------------------------------------------------------
+static void encodeSpan(const RecordedSpan& span, std::string& s) {
+  appendUint(span.trace_id, 8, s);
+  appendUint(span.span_id, 8, s);
+  appendUint(span.parent_span_id, 8, s);
+  appendUint(toNanoseconds(span.start_timestamp.time_since_epoch()), 8, s);
+  appendUint(toNanoseconds(span.duration), 8, s);
+  appendString(span.operation_name, s);
+  appendUint(span.tags.size(), 4, s);
+  for (auto& tag : span.tags) {
+    appendField(tag.first, tag.second, s);
+  }
+  appendUint(span.logs.size(), 4, s);
+  for (auto& log_record : span.logs) {
+    appendUint(toNanoseconds(log_record.timestamp.time_since_epoch()), 8, s);
+    appendUint(log_record.fields.size(), 4, s);
+    for (auto& field : log_record.fields) {
+      appendField(field.first, field.second, s);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// UdsBatchReporter
+//--------------------------------------------------------------------------------------------------
+namespace {
+class UdsBatchReporter final : public Recorder {
+ public:
+  UdsBatchReporter(const sockaddr_un& address, size_t batch_size,
+                   std::chrono::microseconds linger)
+      : address_(address), batch_size_{batch_size}, linger_{linger} {
+    thread_ = std::thread{&UdsBatchReporter::run, this};
+  }
+
+  ~UdsBatchReporter() noexcept override {
+    {
+      std::lock_guard<std::mutex> lock_guard{mutex_};
+      exit_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+    if (socket_ != -1) {
+      ::close(socket_);
+    }
+  }
+
+  void recordSpan(const RecordedSpan& span) noexcept override try {
+    // Encode outside of the lock so that appending to the batch is the only
+    // work serialized between threads.
+    thread_local std::string encoding;
+    encoding.clear();
+    encodeSpan(span, encoding);
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    if (batch_num_spans_ == 0) {
+      batch_.assign(BatchHeaderSize, '\0');
+      batch_start_ = std::chrono::steady_clock::now();
+    }
+    batch_.append(encoding);
+    ++batch_num_spans_;
+    if (batch_num_spans_ >= batch_size_) {
+      sealBatch();
+      condition_.notify_one();
+    } else if (batch_num_spans_ == 1) {
+      // Wake the sender so it starts waiting out the linger time.
+      condition_.notify_one();
+    }
+  } catch (const std::exception& /*e*/) {
+    // Drop the span if it can't be encoded.
+  }
+
+  void flush(std::chrono::microseconds timeout) noexcept override {
+    std::unique_lock<std::mutex> lock{mutex_};
+    sealBatch();
+    auto target = num_sealed_;
+    condition_.notify_one();
+    auto is_flushed = [this, target] { return num_done_ >= target; };
+    if (timeout == std::chrono::microseconds::zero()) {
+      flushed_condition_.wait(lock, is_flushed);
+    } else {
+      flushed_condition_.wait_for(lock, timeout, is_flushed);
+    }
+  }
+
+ private:
+  sockaddr_un address_;
+  size_t batch_size_;
+  std::chrono::microseconds linger_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::condition_variable flushed_condition_;
+  std::string batch_;
+  size_t batch_num_spans_{0};
+  std::chrono::steady_clock::time_point batch_start_;
+  std::vector<std::string> pending_batches_;
+  uint64_t num_sealed_{0};
+  uint64_t num_done_{0};
+  bool exit_{false};
+  bool stopped_{false};
+
+  // Only accessed by the sending thread.
+  int socket_{-1};
+
+  std::thread thread_;
+
+  // Requires mutex_ to be held.
+  void sealBatch() {
+    if (batch_num_spans_ == 0) {
+      return;
+    }
+    writeUint(batch_.size() - 4, 4, &batch_[0]);
+    writeUint(batch_num_spans_, 4, &batch_[4]);
+    ++num_sealed_;
+    if (!stopped_ && pending_batches_.size() < MaxPendingBatches) {
+      pending_batches_.emplace_back(std::move(batch_));
+    } else {
+      ++num_done_;
+    }
+    batch_.clear();
+    batch_num_spans_ = 0;
+  }
+
+  void run() noexcept try {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+      if (!pending_batches_.empty()) {
+        std::vector<std::string> batches;
+        batches.swap(pending_batches_);
+        lock.unlock();
+        sendBatches(batches);
+        lock.lock();
+        num_done_ += batches.size();
+        flushed_condition_.notify_all();
+        continue;
+      }
+      if (batch_num_spans_ == 0) {
+        if (exit_) {
+          return;
+        }
+        condition_.wait(lock);
+        continue;
+      }
+      auto deadline = batch_start_ + linger_;
+      if (!exit_ && std::chrono::steady_clock::now() < deadline) {
+        condition_.wait_until(lock, deadline);
+        continue;
+      }
+      sealBatch();
+    }
+  } catch (const std::exception& /*e*/) {
+    // Only reachable if the thread can't allocate or wait; stop sending and
+    // count everything as done so that flush doesn't wait on this thread.
+    std::lock_guard<std::mutex> lock_guard{mutex_};
+    stopped_ = true;
+    pending_batches_.clear();
+    num_done_ = num_sealed_;
+    flushed_condition_.notify_all();
+  }
+
+  bool connect() noexcept {
+    socket_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_ == -1) {
+      return false;
+    }
+    // Don't let a stalled collector block flushing indefinitely.
+    timeval send_timeout = {1, 0};
+    ::setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, &send_timeout,
+                 sizeof(send_timeout));
+    if (::connect(socket_, reinterpret_cast<const sockaddr*>(&address_),
+                  sizeof(address_)) != 0) {
+      ::close(socket_);
+      socket_ = -1;
+      return false;
+    }
+    return true;
+  }
+
+  bool sendAll(iovec* iovecs, size_t num_iovecs) noexcept {
+    msghdr message = {};
+    message.msg_iov = iovecs;
+    message.msg_iovlen = num_iovecs;
+    while (message.msg_iovlen > 0) {
+      auto num_written = ::sendmsg(socket_, &message, MSG_NOSIGNAL);
+      if (num_written == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      auto remaining = static_cast<size_t>(num_written);
+      while (message.msg_iovlen > 0 && remaining >= message.msg_iov->iov_len) {
+        remaining -= message.msg_iov->iov_len;
+        ++message.msg_iov;
+        --message.msg_iovlen;
+      }
+      if (remaining > 0) {
+        message.msg_iov->iov_base =
+            static_cast<char*>(message.msg_iov->iov_base) + remaining;
+        message.msg_iov->iov_len -= remaining;
+      }
+    }
+    return true;
+  }
+
+  void sendBatches(std::vector<std::string>& batches) noexcept {
+    if (socket_ == -1 && !connect()) {
+      return;
+    }
+    iovec iovecs[MaxIovecs];
+    for (size_t first = 0; first < batches.size(); first += MaxIovecs) {
+      auto num_iovecs = std::min(batches.size() - first, MaxIovecs);
+      for (size_t i = 0; i < num_iovecs; ++i) {
+        auto& batch = batches[first + i];
+        iovecs[i].iov_base = &batch[0];
+        iovecs[i].iov_len = batch.size();
+      }
+      if (!sendAll(iovecs, num_iovecs)) {
+        // A partially written batch leaves the stream unusable, so reconnect
+        // for the next batches.
+        ::close(socket_);
+        socket_ = -1;
+        return;
+      }
+    }
+  }
+};
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+// makeUdsBatchReporter
+//--------------------------------------------------------------------------------------------------
+std::unique_ptr<Recorder> makeUdsBatchReporter(const char* path,
+                                               size_t batch_size,
+                                               std::chrono::microseconds linger) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (std::strlen(path) >= sizeof(address.sun_path)) {
+    throw std::runtime_error{std::string{"socket path is too long: "} + path};
+  }
+  std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  return std::unique_ptr<Recorder>{
+      new UdsBatchReporter{address, std::max<size_t>(batch_size, 1), linger}};
+}
+}  // namespace python_bridge_tracer
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include "recorded_span.h"
+
+namespace python_bridge_tracer {
+/**
+ * Create a recorder that appends finished spans to a batch and sends full or
+ * lingering batches to a collector listening on a Unix domain stream socket.
+ *
+ * Sending is done on a background thread using vectored writes. Batches that
+ * can't be sent are dropped.
+ *
+ * The wire format uses big-endian integers. Each batch is
+ *
+ *     u32 length of the rest of the batch
+ *     u32 number of spans
+ *     spans...
+ *
+ * and each span is
+ *
+ *     u64 trace_id, u64 span_id, u64 parent_span_id (0 if none)
+ *     i64 start_timestamp (nanoseconds since the unix epoch)
+ *     i64 duration (nanoseconds)
+ *     string operation_name
+ *     u32 number of tags, followed by (string key, string value) pairs
+ *     u32 number of logs, each an i64 timestamp (nanoseconds since the unix
+ *     epoch) followed by a u32 number of fields and (string key, string value)
+ *     pairs
+ *
+ * where a string is a u32 length followed by its bytes. Tag and log values are
+ * converted to strings.
+ * @param path the path of the collector's socket
+ * @param batch_size the number of spans at which a batch is sent
+ * @param linger how long a partial batch waits for more spans before it's sent
+ * @return the recorder
+ */
+std::unique_ptr<Recorder> makeUdsBatchReporter(const char* path,
+                                               size_t batch_size,
+                                               std::chrono::microseconds linger);
+}  // namespace python_bridge_tracer
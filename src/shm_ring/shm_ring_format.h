@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace python_bridge_tracer {
+namespace shm_ring {
+/**
+ * Layout of the shared memory ring buffer that the shm recorder writes finished
+ * spans into.
+ *
+ * The file starts with a Header followed by slot_count Slots. A writer claims
+ * a slot by incrementing write_index and publishes it with a seqlock: while the
+ * record for index i is being written the slot's sequence is 2*i + 1 and once
+ * it's complete the sequence is 2*i + 2. A reader copies a record and then
+ * checks that the sequence didn't change.
+ *
+ * All integers are in the host's byte order.
+ */
+const uint64_t Magic = 0x474e495254425450ULL;  // "PTBTRING"
+const uint32_t Version = 1;
+
+/**
+ * Set in SpanRecord::flags.
+ */
+const uint32_t ErrorFlag = 1;
+const uint32_t TruncatedOperationNameFlag = 2;
+const uint32_t TruncatedTagsFlag = 4;
+
+const size_t MaxOperationNameLength = 64;
+const size_t MaxTagsLength = 144;
+
+/**
+ * A finished span.
+ *
+ * Tags are encoded in tags as a sequence of (key length, value length, key,
+ * value) entries where the lengths are single bytes. Values are converted to
+ * strings. Tags that don't fit are dropped and TruncatedTagsFlag is set.
+ */
+struct SpanRecord {
+  uint64_t trace_id;
+  uint64_t span_id;
+  uint64_t parent_span_id;  // 0 if the span has no parent
+
+  int64_t start_timestamp;  // nanoseconds since the unix epoch
+  int64_t duration;         // nanoseconds
+
+  uint32_t flags;
+  uint16_t operation_name_length;
+  uint16_t tags_length;
+
+  char operation_name[MaxOperationNameLength];
+  char tags[MaxTagsLength];
+};
+
+static_assert(sizeof(SpanRecord) == 256, "unexpected SpanRecord size");
+
+struct Slot {
+  std::atomic<uint64_t> sequence;
+  SpanRecord record;
+};
+
+struct Header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t slot_count;  // a power of two
+  std::atomic<uint64_t> write_index;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "std::atomic<uint64_t> must have the same layout as uint64_t");
+
+/**
+ * @param slot_count the number of slots in the ring
+ * @return the size of the ring buffer's file
+ */
+inline size_t getFileSize(uint64_t slot_count) noexcept {
+  return sizeof(Header) + static_cast<size_t>(slot_count) * sizeof(Slot);
+}
+
+/**
+ * @param header the start of the mapped file
+ * @return the ring's slots
+ */
+inline Slot* getSlots(Header* header) noexcept {
+  return reinterpret_cast<Slot*>(header + 1);
+}
+
+inline const Slot* getSlots(const Header* header) noexcept {
+  return reinterpret_cast<const Slot*>(header + 1);
+}
+} // namespace shm_ring
+} // namespace python_bridge_tracer
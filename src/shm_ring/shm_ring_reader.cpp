@@ -0,0 +1,102 @@
+#include "shm_ring/shm_ring_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace python_bridge_tracer {
+namespace shm_ring {
+//--------------------------------------------------------------------------------------------------
+// makeError
+//--------------------------------------------------------------------------------------------------
+static std::runtime_error makeError(const char* path, const char* what) {
+  return std::runtime_error{std::string{what} + " " + path + ": " +
+                            std::strerror(errno)};
+}
+
+//--------------------------------------------------------------------------------------------------
+// constructor
+//--------------------------------------------------------------------------------------------------
+ShmRingReader::ShmRingReader(const char* path) {
+  auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    throw makeError(path, "failed to open");
+  }
+  struct stat file_status;
+  if (::fstat(fd, &file_status) != 0) {
+    ::close(fd);
+    throw makeError(path, "failed to stat");
+  }
+  size_ = static_cast<size_t>(file_status.st_size);
+  if (size_ < sizeof(Header)) {
+    ::close(fd);
+    throw std::runtime_error{std::string{path} + " is not a span ring buffer"};
+  }
+  auto data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw makeError(path, "failed to map");
+  }
+  header_ = static_cast<const Header*>(data);
+  if (header_->magic != Magic || header_->version != Version ||
+      header_->record_size != sizeof(SpanRecord) ||
+      getFileSize(header_->slot_count) > size_) {
+    ::munmap(data, size_);
+    throw std::runtime_error{std::string{path} + " is not a span ring buffer"};
+  }
+  auto write_index = header_->write_index.load(std::memory_order_acquire);
+  if (write_index > header_->slot_count) {
+    next_index_ = write_index - header_->slot_count;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// destructor
+//--------------------------------------------------------------------------------------------------
+ShmRingReader::~ShmRingReader() noexcept {
+  ::munmap(const_cast<Header*>(header_), size_);
+}
+
+//--------------------------------------------------------------------------------------------------
+// read
+//--------------------------------------------------------------------------------------------------
+bool ShmRingReader::read(SpanRecord& record) noexcept {
+  auto slot_count = header_->slot_count;
+  auto slots = getSlots(header_);
+  while (true) {
+    auto write_index = header_->write_index.load(std::memory_order_acquire);
+    if (next_index_ >= write_index) {
+      return false;
+    }
+    if (write_index - next_index_ > slot_count) {
+      num_lost_ += write_index - slot_count - next_index_;
+      next_index_ = write_index - slot_count;
+    }
+    auto& slot = slots[next_index_ & (slot_count - 1)];
+    auto expected_sequence = 2 * next_index_ + 2;
+    auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence < expected_sequence) {
+      // The writer that claimed the slot hasn't finished yet.
+      return false;
+    }
+    if (sequence == expected_sequence) {
+      std::memcpy(static_cast<void*>(&record), &slot.record, sizeof(record));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        ++next_index_;
+        return true;
+      }
+    }
+    // The record was overwritten before or while it was copied.
+    ++num_lost_;
+    ++next_index_;
+  }
+}
+} // namespace shm_ring
+} // namespace python_bridge_tracer
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "shm_ring/shm_ring_format.h"
+
+namespace python_bridge_tracer {
+namespace shm_ring {
+/**
+ * Reads the spans recorded into a shared memory ring buffer. The reader never
+ * blocks the writers; records that are overwritten before they can be read
+ * are counted as lost.
+ */
+class ShmRingReader {
+ public:
+  /**
+   * Map an existing ring buffer. Reading starts at the oldest record still in
+   * the ring.
+   * @param path the path of the ring buffer's file
+   * @throw std::runtime_error if the file can't be mapped or isn't a ring buffer
+   */
+  explicit ShmRingReader(const char* path);
+
+  ShmRingReader(const ShmRingReader&) = delete;
+  ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+  ~ShmRingReader() noexcept;
+
+  /**
+   * Copy the next record.
+   * @param record the record to copy into
+   * @return true if a record was copied or false if no complete record is
+   * available yet
+   */
+  bool read(SpanRecord& record) noexcept;
+
+  /**
+   * @return the number of records overwritten before they could be read
+   */
+  uint64_t num_lost() const noexcept { return num_lost_; }
+
+ private:
+  const Header* header_{nullptr};
+  size_t size_{0};
+  uint64_t next_index_{0};
+  uint64_t num_lost_{0};
+};
+} // namespace shm_ring
+} // namespace python_bridge_tracer
@@ -1,7 +1,14 @@
 import tempfile
 import os
 import sys
+import socket
+import struct
+import subprocess
+import time
+import gc
+import inspect
 import json
+import logging
 import unittest
 import opentracing
 
@@ -9,17 +16,89 @@ for pyversion in os.listdir('binary'):
     sys.path.append('binary/' + pyversion)
 import bridge_tracer
 
-def make_mock_tracer(scope_manager = None):
+def make_mock_tracer(scope_manager = None, **options):
     traces_path = os.path.join(tempfile.mkdtemp(prefix='python-bridge-test.'), 'traces.json')
     tracer = bridge_tracer.load_tracer(
             'external/io_opentracing_cpp/mocktracer/libmocktracer_plugin.so',
-            '{ "output_file" : "%s" }' % traces_path)
+            '{ "output_file" : "%s" }' % traces_path,
+            scope_manager=scope_manager,
+            **options)
     return tracer, traces_path
 
 def read_spans(traces_path):
     with open(traces_path) as f:
         return json.loads(f.read())
 
+def read_uds_batches(connection, num_batches):
+    def read(size):
+        chunk = connection.recv(size, socket.MSG_WAITALL)
+        if len(chunk) != size:
+            raise EOFError()
+        return chunk
+    def read_uint(size):
+        return struct.unpack({4: '>I', 8: '>Q'}[size], read(size))[0]
+    def read_string():
+        return read(read_uint(4)).decode()
+    def read_fields():
+        return dict((read_string(), read_string()) for _ in range(read_uint(4)))
+    batches = []
+    for _ in range(num_batches):
+        read_uint(4)
+        spans = []
+        for _ in range(read_uint(4)):
+            span = {}
+            for key in ['trace_id', 'span_id', 'parent_span_id', 'start_timestamp', 'duration']:
+                span[key] = read_uint(8)
+            span['operation_name'] = read_string()
+            span['tags'] = read_fields()
+            span['logs'] = [(read_uint(8), read_fields()) for _ in range(read_uint(4))]
+            spans.append(span)
+        batches.append(spans)
+    return batches
+
+def read_usdt_probes(path):
+    with open(path, 'rb') as f:
+        elf = f.read()
+    section_offset, = struct.unpack_from('<Q', elf, 0x28)
+    section_size, num_sections, names_index = struct.unpack_from('<HHH', elf, 0x3a)
+    def read_section(index):
+        name, _, _, _, offset, size = struct.unpack_from(
+                '<IIQQQQ', elf, section_offset + index * section_size)
+        return name, elf[offset:offset + size]
+    names = read_section(names_index)[1]
+    probes = {}
+    for index in range(num_sections):
+        name, data = read_section(index)
+        if names[name:names.index(b'\0', name)] != b'.note.stapsdt':
+            continue
+        position = 0
+        while position < len(data):
+            name_size, description_size, _ = struct.unpack_from('<III', data, position)
+            position += 12 + (name_size + 3) // 4 * 4
+            semaphore, = struct.unpack_from('<Q', data, position + 16)
+            description = data[position + 24:position + description_size]
+            provider, probe, arguments = description.split(b'\0')[:3]
+            probes[probe.decode()] = (provider.decode(), len(arguments.split()),
+                                      semaphore != 0)
+            position += (description_size + 3) // 4 * 4
+    return probes
+
+def instrumented_function(x):
+    return x * 2
+
+def failing_instrumented_function():
+    raise RuntimeError('failed')
+
+class InstrumentedClass(object):
+    def method(self):
+        return instrumented_function(1) + uninstrumented_function()
+
+def uninstrumented_function():
+    return 1
+
+def uninstrumenting_function(tracer):
+    tracer.uninstrument()
+
 class TestTracer(unittest.TestCase):
     def test_start_span(self):
         tracer, traces_path = make_mock_tracer()
@@ -300,5 +379,883 @@ class TestTracer(unittest.TestCase):
         tracer, traces_path = make_mock_tracer()
         print(tracer.scope_manager)
 
+    def test_propagation_cached(self):
+        tracer, traces_path = make_mock_tracer()
+        span1 = tracer.start_span('abc')
+        carrier1 = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier1)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 0)
+        carrier2 = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier2)
+        self.assertEqual(carrier1, carrier2)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 1)
+        span1.set_baggage_item('abc', '123')
+        carrier3 = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier3)
+        self.assertNotEqual(carrier1, carrier3)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 1)
+        span_context = tracer.extract(opentracing.Format.TEXT_MAP, carrier3)
+        self.assertEqual(span_context.baggage, {'abc':'123'})
+        span1.set_tag('sampling.priority', 1)
+        carrier4 = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier4)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 1)
+        self.assertEqual(carrier3, carrier4)
+        carrier5 = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier5)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 2)
+        binary_carrier1 = bytearray()
+        tracer.inject(span1.context, opentracing.Format.BINARY, binary_carrier1)
+        binary_carrier2 = bytearray()
+        tracer.inject(span1.context, opentracing.Format.BINARY, binary_carrier2)
+        self.assertEqual(binary_carrier1, binary_carrier2)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 3)
+        span1.set_baggage_item('xyz', '456')
+        binary_carrier3 = bytearray()
+        tracer.inject(span1.context, opentracing.Format.BINARY, binary_carrier3)
+        self.assertNotEqual(binary_carrier1, binary_carrier3)
+        self.assertEqual(tracer.stats()['inject_cache_hits'], 3)
+
+    def test_propagation_asgi_headers(self):
+        tracer, traces_path = make_mock_tracer()
+        span1 = tracer.start_span('abc')
+        span1.set_baggage_item('abc', '123')
+        headers = [(b'host', b'example.com')]
+        tracer.inject(span1.context, opentracing.Format.HTTP_HEADERS, headers)
+        self.assertTrue(len(headers) >= 2)
+        for key, value in headers:
+            self.assertIsInstance(key, bytes)
+            self.assertIsInstance(value, bytes)
+            self.assertEqual(key, key.lower())
+        span_context = tracer.extract(opentracing.Format.HTTP_HEADERS, headers)
+        self.assertEqual(span_context.baggage, {'abc':'123'})
+
+    def test_propagation_grpc_metadata(self):
+        tracer, traces_path = make_mock_tracer()
+        span1 = tracer.start_span('abc')
+        span1.set_baggage_item('abc', '123')
+        metadata = []
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, metadata)
+        self.assertTrue(len(metadata) >= 1)
+        for key, value in metadata:
+            self.assertIsInstance(key, str)
+        span_context = tracer.extract(opentracing.Format.TEXT_MAP, tuple(metadata))
+        self.assertEqual(span_context.baggage, {'abc':'123'})
+        # The mocktracer's only key is lowercase, so use the recording tracer,
+        # whose baggage keys keep the case of the baggage item.
+        ring_path = os.path.join(tempfile.mkdtemp(prefix='python-bridge-test.'), 'spans')
+        tracer = bridge_tracer.load_tracer(None, shm_recorder_path=ring_path)
+        span1 = tracer.start_span('abc')
+        span1.set_baggage_item('MixedCase', '123')
+        metadata = []
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, metadata)
+        self.assertIn('ot-baggage-MixedCase', [key for key, _ in metadata])
+        span_context = tracer.extract(opentracing.Format.TEXT_MAP, metadata)
+        self.assertEqual(span_context.baggage, {'MixedCase':'123'})
+        headers = []
+        tracer.inject(span1.context, opentracing.Format.HTTP_HEADERS, headers)
+        self.assertIn(b'ot-baggage-mixedcase', [key for key, _ in headers])
+        tracer.close()
+
+    def test_propagation_key_prefixes(self):
+        tracer, traces_path = make_mock_tracer(propagation_key_prefixes=['X-OT-'])
+        span1 = tracer.start_span('abc')
+        span1.set_baggage_item('abc', '123')
+        carrier = {'content-type': 'text/plain', 'user-agent': 'test'}
+        tracer.inject(span1.context, opentracing.Format.HTTP_HEADERS, carrier)
+        span_context = tracer.extract(opentracing.Format.HTTP_HEADERS, carrier)
+        self.assertEqual(span_context.baggage, {'abc':'123'})
+        with self.assertRaises(TypeError):
+            make_mock_tracer(propagation_key_prefixes='x-ot-')
+        with self.assertRaises(TypeError):
+            make_mock_tracer(no_such_option=1)
+
+    def test_propagation_extract_many(self):
+        tracer, traces_path = make_mock_tracer()
+        span1 = tracer.start_span('abc')
+        span2 = tracer.start_span('xyz')
+        carrier1 = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier1)
+        carrier2 = {}
+        tracer.inject(span2.context, opentracing.Format.TEXT_MAP, carrier2)
+        span_contexts = tracer.extract_many(opentracing.Format.TEXT_MAP,
+                                            [carrier1, {}, dict(carrier1), carrier2])
+        self.assertEqual(len(span_contexts), 4)
+        self.assertIsNotNone(span_contexts[0])
+        self.assertIsNone(span_contexts[1])
+        self.assertIs(span_contexts[0], span_contexts[2])
+        self.assertIsNotNone(span_contexts[3])
+        self.assertIsNot(span_contexts[0], span_contexts[3])
+        self.assertEqual(span_contexts[0].span_id, span1.context.span_id)
+        self.assertEqual(span_contexts[3].span_id, span2.context.span_id)
+        headers = {}
+        tracer.inject(span1.context, opentracing.Format.HTTP_HEADERS, headers)
+        headers1 = dict(headers, **{'user-agent': 'curl', 'content-length': '12'})
+        headers2 = dict(headers, **{'User-Agent': 'wget', 'content-length': '0'})
+        headers3 = dict(headers, **{'user-agent': 'curl'})
+        extracts = tracer.stats()['extracts']
+        span_contexts = tracer.extract_many(opentracing.Format.HTTP_HEADERS,
+                                            [headers1, headers2, headers3])
+        self.assertIsNotNone(span_contexts[0])
+        self.assertIs(span_contexts[0], span_contexts[1])
+        self.assertIs(span_contexts[0], span_contexts[2])
+        self.assertEqual(tracer.stats()['extracts'], extracts + 1)
+        binary_carrier = bytearray()
+        tracer.inject(span1.context, opentracing.Format.BINARY, binary_carrier)
+        span_contexts = tracer.extract_many(opentracing.Format.BINARY,
+                                            (binary_carrier, binary_carrier))
+        self.assertIs(span_contexts[0], span_contexts[1])
+        self.assertEqual(tracer.extract_many(opentracing.Format.TEXT_MAP, []), [])
+        with self.assertRaises(opentracing.UnsupportedFormatException):
+            tracer.extract_many('no-such-format', [carrier1])
+        with self.assertRaises(opentracing.InvalidCarrierException):
+            tracer.extract_many(opentracing.Format.BINARY, [{}])
+
+    def test_propagation_try_extract(self):
+        tracer, traces_path = make_mock_tracer()
+        span1 = tracer.start_span('abc')
+        carrier = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier)
+        self.assertIsNotNone(tracer.try_extract(opentracing.Format.TEXT_MAP, carrier))
+        self.assertIsNone(tracer.try_extract(opentracing.Format.TEXT_MAP, {}))
+        self.assertIsNone(tracer.try_extract('no-such-format', carrier))
+        self.assertIsNone(tracer.try_extract(opentracing.Format.BINARY, {}))
+        with self.assertRaises(TypeError):
+            tracer.try_extract(opentracing.Format.TEXT_MAP,
+                               dict((key, 123) for key in carrier))
+        self.assertEqual(tracer.extract_errors(), {
+            'unsupported_format': 1,
+            'invalid_carrier': 1,
+            'span_context_corrupted': 0,
+            'other': 0,
+        })
+
+    def test_context_ids(self):
+        tracer, traces_path = make_mock_tracer()
+        span1 = tracer.start_span('abc')
+        span2 = tracer.start_span('xyz', child_of=span1)
+        context = span1.context
+        self.assertIs(context.trace_id, context.trace_id)
+        self.assertIs(context.span_id, span1.context.span_id)
+        self.assertEqual(span2.context.trace_id, context.trace_id)
+        if context.span_id is not None:
+            self.assertNotEqual(span2.context.span_id, context.span_id)
+        carrier = {}
+        tracer.inject(context, opentracing.Format.TEXT_MAP, carrier)
+        span_context = tracer.extract(opentracing.Format.TEXT_MAP, carrier)
+        self.assertEqual(span_context.trace_id, context.trace_id)
+
+    def test_logging_filter(self):
+        tracer, traces_path = make_mock_tracer()
+        logging_filter = tracer.logging_filter()
+        record = logging.LogRecord('test', logging.INFO, __file__, 1, 'abc', None, None)
+        self.assertTrue(logging_filter.filter(record))
+        self.assertIsNone(record.trace_id)
+        self.assertIsNone(record.span_id)
+        with tracer.start_active_span('abc') as scope:
+            self.assertTrue(logging_filter.filter(record))
+            self.assertEqual(record.trace_id, scope.span.context.trace_id)
+            self.assertEqual(record.span_id, scope.span.context.span_id)
+        self.assertTrue(logging_filter.filter(record))
+        self.assertIsNone(record.trace_id)
+        self.assertIsNone(record.span_id)
+        logging_filter = tracer.logging_filter(trace_id_attribute='dd.trace_id')
+        logging_filter.filter(record)
+        self.assertTrue(hasattr(record, 'dd.trace_id'))
+        class RecordingHandler(logging.Handler):
+            def __init__(self):
+                logging.Handler.__init__(self)
+                self.records = []
+            def emit(self, record):
+                self.records.append(record)
+        handler = RecordingHandler()
+        logger = logging.getLogger('test_logging_filter')
+        logger.propagate = False
+        logger.setLevel(logging.INFO)
+        logger.addFilter(logging_filter)
+        logger.addHandler(handler)
+        with tracer.start_active_span('xyz') as scope:
+            logger.info('abc')
+            logger.info('def')
+        logger.info('ghi')
+        self.assertEqual([getattr(record, 'dd.trace_id') for record in handler.records],
+                         [scope.span.context.trace_id] * 2 + [None])
+        self.assertEqual([record.span_id for record in handler.records],
+                         [scope.span.context.span_id] * 2 + [None])
+
+    def test_sampling_denied_operations(self):
+        tracer, traces_path = make_mock_tracer(denied_operations=['health'])
+        span1 = tracer.start_span('health')
+        self.assertIs(tracer.start_span('health'), span1)
+        self.assertIs(span1.tracer, tracer)
+        span1.set_tag('abc', 123).log_kv({'abc': 123}).set_baggage_item('abc', '123')
+        self.assertIsNone(span1.get_baggage_item('abc'))
+        self.assertEqual(span1.context.baggage, {})
+        span2 = tracer.start_span('abc', child_of=span1)
+        self.assertIs(span2, span1)
+        span3 = tracer.start_span('abc', child_of=span1.context)
+        self.assertIs(span3, span1)
+        carrier = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier)
+        self.assertEqual(carrier, {})
+        with tracer.start_active_span('health') as scope:
+            self.assertIs(scope.span, span1)
+            with tracer.start_active_span('abc') as child_scope:
+                self.assertIs(child_scope.span, span1)
+        with tracer.start_active_span('abc') as scope:
+            span4 = tracer.start_span('xyz')
+            span4.finish()
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual([span['operation_name'] for span in spans], ['xyz', 'abc'])
+
+    def test_sampling_sample_rate(self):
+        tracer, traces_path = make_mock_tracer(sample_rate=0.0)
+        span1 = tracer.start_span('abc')
+        span1.finish()
+        parent_tracer, parent_traces_path = make_mock_tracer()
+        parent = parent_tracer.start_span('abc')
+        carrier = {}
+        parent_tracer.inject(parent.context, opentracing.Format.TEXT_MAP, carrier)
+        span_context = tracer.extract(opentracing.Format.TEXT_MAP, carrier)
+        span2 = tracer.start_span('xyz', child_of=span_context)
+        span2.finish()
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual([span['operation_name'] for span in spans], ['xyz'])
+        with self.assertRaises(ValueError):
+            make_mock_tracer(sample_rate=2.0)
+
+    def test_sampling_rate_limits(self):
+        tracer, traces_path = make_mock_tracer(operation_rate_limits={'chatty': 1})
+        span1 = tracer.start_span('chatty')
+        span2 = tracer.start_span('chatty')
+        self.assertIsNot(span1, span2)
+        self.assertIs(tracer.start_span('chatty'), span2)
+        span1.finish()
+        span2.finish()
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 1)
+        with self.assertRaises(TypeError):
+            make_mock_tracer(operation_rate_limits=['chatty'])
+
+    def test_noop_tracer(self):
+        for tracer in [bridge_tracer.noop_tracer(), bridge_tracer.load_tracer(None)]:
+            span = tracer.start_span('abc', tags={'abc': 123})
+            self.assertIs(tracer.start_span('xyz'), span)
+            self.assertIs(span.tracer, tracer)
+            span.set_tag('abc', 123).log_kv({'abc': 123})
+            span.finish()
+            with tracer.start_active_span('abc') as scope:
+                self.assertIs(scope.span, span)
+            carrier = {}
+            tracer.inject(span.context, opentracing.Format.TEXT_MAP, carrier)
+            self.assertEqual(carrier, {})
+            self.assertIsNone(tracer.extract(opentracing.Format.TEXT_MAP, carrier))
+            self.assertEqual(tracer.extract_many(opentracing.Format.TEXT_MAP,
+                                                 [carrier, carrier]), [None, None])
+            tracer.close()
+        with self.assertRaises(TypeError):
+            bridge_tracer.load_tracer('libtracer.so')
+        with self.assertRaises(TypeError):
+            bridge_tracer.load_tracer(None, '{}')
+        with self.assertRaises(TypeError):
+            bridge_tracer.load_tracer(None, sample_rate=0.5)
+
+    def test_export_queue(self):
+        tracer, traces_path = make_mock_tracer(export_queue_size=16)
+        for i in range(10):
+            span = tracer.start_span('abc')
+            span.set_tag('i', i)
+            span.finish()
+        with tracer.start_active_span('xyz') as scope:
+            # Finishing twice mustn't queue the span twice.
+            scope.span.finish()
+        tracer.flush()
+        stats = tracer.export_queue_stats()
+        self.assertEqual(stats['capacity'], 16)
+        self.assertEqual(stats['finished'], 11)
+        self.assertEqual(stats['queued'], 0)
+        self.assertEqual(stats['overflowed'], 0)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 11)
+        self.assertEqual(sorted(span['tags']['i'] for span in spans[:10]), list(range(10)))
+        # Spans that don't fit in the queue are finished synchronously with
+        # their logs.
+        tracer, traces_path = make_mock_tracer(export_queue_size=2)
+        for i in range(1000):
+            span = tracer.start_span('abc')
+            span.log_kv({'i': i})
+            span.finish()
+        tracer.flush()
+        stats = tracer.export_queue_stats()
+        self.assertEqual(stats['finished'] + stats['overflowed'], 1000)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 1000)
+        self.assertEqual(sorted(int(span['logs'][0]['fields'][0]['value']) for span in spans),
+                         list(range(1000)))
+        tracer, traces_path = make_mock_tracer()
+        self.assertIsNone(tracer.export_queue_stats())
+        with self.assertRaises(ValueError):
+            make_mock_tracer(export_queue_size=-1)
+
+    def test_shm_recorder(self):
+        ring_path = os.path.join(tempfile.mkdtemp(prefix='python-bridge-test.'), 'spans')
+        tracer = bridge_tracer.load_tracer(None, shm_recorder_path=ring_path,
+                                           shm_recorder_slots=4)
+        span1 = tracer.start_span('abc', tags={'abc': 123})
+        carrier = {}
+        tracer.inject(span1.context, opentracing.Format.TEXT_MAP, carrier)
+        span2 = tracer.start_span('xyz', child_of=tracer.extract(opentracing.Format.TEXT_MAP, carrier))
+        span2.set_tag('error', True)
+        span2.finish()
+        span1.finish()
+        output = subprocess.check_output(['tools/shm_ring_dump', ring_path])
+        records = [json.loads(line) for line in output.decode().splitlines()]
+        self.assertEqual([record['operation_name'] for record in records], ['xyz', 'abc'])
+        self.assertEqual(records[0]['trace_id'], records[1]['trace_id'])
+        self.assertEqual(records[0]['parent_span_id'], records[1]['span_id'])
+        self.assertIsNone(records[1]['parent_span_id'])
+        self.assertTrue(records[0]['error'])
+        self.assertEqual(records[1]['tags'], {'abc': '123'})
+        for i in range(5):
+            tracer.start_span(str(i)).finish()
+        output = subprocess.check_output(['tools/shm_ring_dump', ring_path])
+        records = [json.loads(line) for line in output.decode().splitlines()]
+        self.assertEqual([record['operation_name'] for record in records], ['1', '2', '3', '4'])
+        tracer.close()
+
+    def test_uds_reporter(self):
+        socket_path = os.path.join(tempfile.mkdtemp(prefix='python-bridge-test.'), 'collector')
+        collector = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        collector.bind(socket_path)
+        collector.listen(1)
+        tracer = bridge_tracer.load_tracer(None, uds_reporter_path=socket_path,
+                                           uds_reporter_batch_size=2, uds_reporter_linger=60)
+        with tracer.start_active_span('abc') as scope:
+            scope.span.log_kv({'event': 'xyz'})
+            for i in range(2):
+                tracer.start_span(str(i), tags={'i': i}).finish()
+        tracer.flush()
+        connection, _ = collector.accept()
+        connection.settimeout(10)
+        batches = read_uds_batches(connection, 2)
+        self.assertEqual([[span['operation_name'] for span in batch] for batch in batches],
+                         [['0', '1'], ['abc']])
+        child, parent = batches[0][0], batches[1][0]
+        self.assertEqual(child['tags'], {'i': '0'})
+        self.assertEqual(child['trace_id'], parent['trace_id'])
+        self.assertEqual(child['parent_span_id'], parent['span_id'])
+        self.assertEqual(parent['parent_span_id'], 0)
+        self.assertEqual([fields for _, fields in parent['logs']], [{'event': 'xyz'}])
+        tracer.close()
+        connection.close()
+        collector.close()
+        with self.assertRaises(ValueError):
+            bridge_tracer.load_tracer(None, uds_reporter_path=socket_path,
+                                      uds_reporter_batch_size=0)
+        with self.assertRaises(ValueError):
+            bridge_tracer.load_tracer(None, uds_reporter_path=socket_path,
+                                      uds_reporter_linger=1e300)
+        with self.assertRaises(ValueError):
+            make_mock_tracer(uds_reporter_path=socket_path)
+
+    def test_stats(self):
+        tracer, traces_path = make_mock_tracer()
+        self.assertEqual(set(tracer.stats().values()), {0})
+        span1 = tracer.start_span('abc', tags={'abc': 123})
+        span1.set_tag('xyz', 'qrs').log_kv({'abc': 123})
+        carrier = bytearray()
+        tracer.inject(span1.context, opentracing.Format.BINARY, carrier)
+        tracer.extract(opentracing.Format.BINARY, carrier)
+        with self.assertRaises(opentracing.UnsupportedFormatException):
+            tracer.extract('unsupported', {})
+        span1.finish()
+        span1.finish()
+        span2 = tracer.start_span('xyz')
+        del span2
+        stats = tracer.stats()
+        self.assertEqual(stats['spans_started'], 2)
+        self.assertEqual(stats['spans_finished'], 1)
+        self.assertEqual(stats['unfinished_spans_deallocated'], 1)
+        self.assertEqual(stats['tags_set'], 2)
+        self.assertEqual(stats['logs_set'], 1)
+        self.assertEqual(stats['injects'], 1)
+        self.assertEqual(stats['inject_failures'], 0)
+        self.assertEqual(stats['extracts'], 2)
+        self.assertEqual(stats['extract_failures'], 1)
+        self.assertEqual(stats['binary_bytes_injected'], len(carrier))
+
+    def test_overhead(self):
+        tracer, traces_path = make_mock_tracer(overhead_sample_interval=2)
+        for i in range(10):
+            span = tracer.start_span('abc')
+            span.set_tag('abc', i)
+            span.log_kv({'abc': i})
+            tracer.inject(span.context, opentracing.Format.TEXT_MAP, {})
+            span.finish()
+        tracer.extract(opentracing.Format.TEXT_MAP, {})
+        overhead = tracer.overhead()
+        self.assertEqual(set(overhead.keys()),
+                         {'start_span', 'set_tag', 'log_kv', 'finish', 'inject', 'extract'})
+        for operation in ['start_span', 'set_tag', 'log_kv', 'finish', 'inject']:
+            for component in ['bridge', 'vendor']:
+                summary = overhead[operation][component]
+                self.assertEqual(summary['count'], 5)
+                self.assertTrue(0 <= summary['p50'] <= summary['p99'] <= summary['max'])
+        self.assertGreater(overhead['start_span']['bridge']['mean'], 0)
+        self.assertEqual(overhead['log_kv']['vendor']['max'], 0)
+        self.assertEqual(overhead['extract']['bridge']['count'], 0)
+        tracer, traces_path = make_mock_tracer()
+        self.assertIsNone(tracer.overhead())
+        with self.assertRaises(ValueError):
+            make_mock_tracer(overhead_sample_interval=-1)
+
+    def test_red_metrics(self):
+        tracer, traces_path = make_mock_tracer(red_metrics_max_operations=2)
+        for i in range(4):
+            with tracer.start_span('abc') as span:
+                span.set_tag('error', i == 0)
+        try:
+            with tracer.start_span('xyz'):
+                raise RuntimeError('failed')
+        except RuntimeError:
+            pass
+        span = tracer.start_span('first', start_time=time.time() - 1)
+        span.set_operation_name('second')
+        span.finish()
+        span.finish()
+        metrics = tracer.red_metrics()
+        self.assertEqual(set(metrics.keys()), {'abc', 'xyz', None})
+        self.assertEqual(metrics['abc']['count'], 4)
+        self.assertEqual(metrics['abc']['errors'], 1)
+        self.assertEqual(metrics['xyz']['count'], 1)
+        self.assertEqual(metrics['xyz']['errors'], 1)
+        self.assertEqual(metrics[None]['count'], 1)
+        self.assertGreaterEqual(metrics[None]['duration']['max'], 0.9)
+        self.assertEqual(tracer.red_metrics(), {})
+        tracer, traces_path = make_mock_tracer(red_metrics_max_operations=500)
+        for _ in range(2):
+            for i in range(1000):
+                tracer.start_span(str(i)).finish()
+        metrics = tracer.red_metrics()
+        self.assertEqual(len(metrics), 501)
+        self.assertEqual(sum(metrics[str(i)]['count'] for i in range(1000) if str(i) in metrics), 1000)
+        self.assertEqual(metrics[None]['count'], 1000)
+        tracer, traces_path = make_mock_tracer()
+        self.assertIsNone(tracer.red_metrics())
+
+    def test_usdt_probes(self):
+        probes = read_usdt_probes(bridge_tracer.__file__)
+        if not probes:
+            if os.environ.get('EXPECT_USDT_PROBES'):
+                self.fail('bridge_tracer has no USDT probes')
+            self.skipTest('built without --define usdt=enabled')
+        self.assertEqual(probes, {
+            'span__start': ('python_bridge_tracer', 2, True),
+            'span__finish': ('python_bridge_tracer', 2, True),
+            'inject': ('python_bridge_tracer', 2, True),
+            'extract': ('python_bridge_tracer', 2, True),
+            'tracer__flush': ('python_bridge_tracer', 1, True),
+            'tracer__close': ('python_bridge_tracer', 0, True),
+        })
+
+    def test_tail_sampling(self):
+        tracer, traces_path = make_mock_tracer(
+                tail_sampling_max_spans=4,
+                tail_sampling_min_duration=1.0,
+                tail_sampling_operations=['keep', 'keep.early'])
+        def start_trace(root_operation_name, child_operation_name, **root_options):
+            root = tracer.start_span(root_operation_name, **root_options)
+            child = tracer.start_span(child_operation_name, child_of=root)
+            return root, child
+        root, child = start_trace('discarded', 'discarded.child')
+        child.finish()
+        root.finish()
+        root, child = start_trace('error', 'error.child')
+        child.set_tag('error', True)
+        child.finish()
+        root.finish()
+        root, child = start_trace('operation', 'keep')
+        child.finish()
+        root.finish()
+        root, child = start_trace('slow', 'slow.child', start_time=time.time() - 2)
+        child.finish()
+        root.finish()
+        # Provisional ids aren't cached, so the ids read after an injection
+        # are the wrapped tracer's, for both span contexts and log records.
+        root = tracer.start_span('injected')
+        logging_filter = tracer.logging_filter()
+        record = logging.LogRecord('test', logging.INFO, __file__, 1, 'abc', None, None)
+        with tracer.start_active_span('injected.child', child_of=root) as scope:
+            child = scope.span
+            provisional_ids = (child.context.trace_id, child.context.span_id)
+            self.assertIsNotNone(provisional_ids[0])
+            self.assertTrue(logging_filter.filter(record))
+            self.assertEqual((record.trace_id, record.span_id), provisional_ids)
+            tracer.inject(child.context, opentracing.Format.TEXT_MAP, {})
+            injected_ids = (child.context.trace_id, child.context.span_id)
+            self.assertTrue(logging_filter.filter(record))
+            self.assertEqual((record.trace_id, record.span_id), injected_ids)
+        root.finish()
+        root = tracer.start_span('evicted')
+        for i in range(5):
+            tracer.start_span('evicted.child', child_of=root).finish()
+        root.finish()
+        # A kept operation decides the trace, so its spans aren't evicted.
+        root = tracer.start_span('early')
+        tracer.start_span('keep.early', child_of=root).finish()
+        for i in range(5):
+            tracer.start_span('early.child', child_of=root).finish()
+        root.finish()
+        self.assertEqual(tracer.tail_sampling_stats(), {
+            'capacity': 4,
+            'buffered_spans': 0,
+            'kept_traces': 5,
+            'discarded_traces': 1,
+            'evicted_traces': 1,
+            'evicted_spans': 5,
+        })
+        tracer.close()
+        spans = read_spans(traces_path)
+        operation_names = [span['operation_name'] for span in spans]
+        self.assertEqual(sorted(operation_names), sorted([
+            'error.child', 'error', 'keep', 'operation', 'slow.child', 'slow',
+            'injected.child', 'injected', 'early', 'keep.early'] +
+            ['early.child'] * 5))
+        spans = dict((span['operation_name'], span) for span in spans)
+        # Once a span is started in the wrapped tracer its ids are reported.
+        injected_context = spans['injected.child']['span_context']
+        self.assertEqual(injected_ids, (str(injected_context['trace_id']),
+                                        str(injected_context['span_id'])))
+        for root_operation_name, child_operation_name in [
+                ('error', 'error.child'), ('operation', 'keep'), ('slow', 'slow.child'),
+                ('injected', 'injected.child')]:
+            root_context = spans[root_operation_name]['span_context']
+            child = spans[child_operation_name]
+            self.assertEqual(child['span_context']['trace_id'], root_context['trace_id'])
+            self.assertEqual(child['references'][0]['span_id'], root_context['span_id'])
+        tracer, traces_path = make_mock_tracer()
+        self.assertIsNone(tracer.tail_sampling_stats())
+        for min_duration in [-1.0, float('inf'), float('nan'), 1e300]:
+            with self.assertRaises(ValueError):
+                make_mock_tracer(tail_sampling_max_spans=4,
+                                 tail_sampling_min_duration=min_duration)
+        for rate in [-1.0, float('inf'), float('nan'), 1e300]:
+            with self.assertRaises(ValueError):
+                make_mock_tracer(operation_rate_limits={'chatty': rate})
+
+    def test_instrument(self):
+        if sys.version_info < (3, 12):
+            tracer, traces_path = make_mock_tracer()
+            with self.assertRaises(NotImplementedError):
+                tracer.instrument([__name__ + '.instrumented_function'])
+            self.skipTest('sys.monitoring requires Python 3.12')
+        tracer, traces_path = make_mock_tracer()
+        tracer.instrument([
+            __name__ + '.instrumented_function',
+            __name__ + '.failing_instrumented_function',
+            __name__ + '.InstrumentedClass.method',
+        ])
+        with self.assertRaises(RuntimeError):
+            tracer.instrument([])
+        self.assertEqual(InstrumentedClass().method(), 3)
+        with self.assertRaises(RuntimeError):
+            failing_instrumented_function()
+        tracer.uninstrument()
+        self.assertEqual(instrumented_function(2), 4)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual([span['operation_name'] for span in spans], [
+            __name__ + '.instrumented_function',
+            __name__ + '.InstrumentedClass.method',
+            __name__ + '.failing_instrumented_function',
+        ])
+        self.assertEqual(spans[0]['references'][0]['span_id'],
+                         spans[1]['span_context']['span_id'])
+        self.assertTrue(spans[2]['tags']['error'])
+        self.assertIsNone(tracer.active_span)
+
+    def test_uninstrument_during_call(self):
+        if sys.version_info < (3, 12):
+            self.skipTest('sys.monitoring requires Python 3.12')
+        tracer, traces_path = make_mock_tracer()
+        tracer.instrument([__name__ + '.uninstrumenting_function'], tool_id=5)
+        uninstrumenting_function(tracer)
+        self.assertIsNone(tracer.active_span)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual([span['operation_name'] for span in spans],
+                         [__name__ + '.uninstrumenting_function'])
+
+    def test_instrumenting_tracer_is_freed(self):
+        if sys.version_info < (3, 12):
+            self.skipTest('sys.monitoring requires Python 3.12')
+        tracer, _ = make_mock_tracer()
+        tracer.instrument([__name__ + '.instrumented_function'], tool_id=5)
+        self.assertIsNotNone(sys.monitoring.get_tool(5))
+        del tracer
+        self.assertIsNone(sys.monitoring.get_tool(5))
+
+    def test_traced(self):
+        tracer, traces_path = make_mock_tracer()
+        @tracer.traced('inner', tags={'a': 1})
+        def inner(x):
+            return x + 1
+        @tracer.traced('outer')
+        def outer(x):
+            return inner(x) * 2
+        class Traced(object):
+            @tracer.traced('method')
+            def method(self, x):
+                return self, x
+        @tracer.traced('failing')
+        def failing():
+            raise RuntimeError('failed')
+        self.assertEqual(outer(1), 4)
+        self.assertEqual(inner.__name__, 'inner')
+        self.assertEqual(inner.__wrapped__(1), 2)
+        obj = Traced()
+        self.assertEqual(obj.method(2), (obj, 2))
+        with self.assertRaises(RuntimeError):
+            failing()
+        self.assertIsNone(tracer.active_span)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual([span['operation_name'] for span in spans],
+                         ['inner', 'outer', 'method', 'failing'])
+        self.assertEqual(spans[0]['tags']['a'], 1)
+        self.assertEqual(spans[0]['references'][0]['span_id'],
+                         spans[1]['span_context']['span_id'])
+        self.assertTrue('error' not in spans[1]['tags'])
+        self.assertTrue(spans[3]['tags']['error'])
+
+    def test_traced_coroutine(self):
+        if sys.version_info < (3, 7):
+            self.skipTest('contextvars requires Python 3.7')
+        import asyncio
+        from opentracing.scope_managers.contextvars import ContextVarsScopeManager
+        tracer, traces_path = make_mock_tracer(ContextVarsScopeManager())
+        @tracer.traced('inner')
+        def inner():
+            pass
+        @tracer.traced('coroutine')
+        async def coroutine(x):
+            await asyncio.sleep(0.01)
+            inner()
+            return x
+        @tracer.traced('failing')
+        async def failing():
+            await asyncio.sleep(0)
+            raise RuntimeError('failed')
+        self.assertTrue(inspect.iscoroutinefunction(coroutine))
+        self.assertTrue(asyncio.iscoroutinefunction(coroutine))
+        self.assertFalse(inspect.iscoroutinefunction(inner))
+        self.assertTrue(gc.is_tracked(coroutine))
+        async def run():
+            self.assertEqual(await coroutine(1), 1)
+            self.assertEqual(await asyncio.create_task(coroutine(2)), 2)
+            with self.assertRaises(RuntimeError):
+                await failing()
+        asyncio.run(run())
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual([span['operation_name'] for span in spans],
+                         ['inner', 'coroutine', 'inner', 'coroutine', 'failing'])
+        self.assertEqual(spans[0]['references'][0]['span_id'],
+                         spans[1]['span_context']['span_id'])
+        self.assertTrue(spans[4]['tags']['error'])
+        fields = dict((field['key'], field['value'])
+                      for field in spans[4]['logs'][0]['fields'])
+        self.assertEqual(fields, {'event': 'error', 'error.kind': 'RuntimeError',
+                                  'message': 'failed'})
+
+    def test_subinterpreter(self):
+        try:
+            import _xxsubinterpreters as interpreters
+        except ImportError:
+            self.skipTest('_xxsubinterpreters is unavailable')
+        interpreter = interpreters.create()
+        try:
+            interpreters.run_string(interpreter, """if True:
+                import sys
+                sys.path = %r
+                import bridge_tracer
+                tracer = bridge_tracer.noop_tracer()
+                with tracer.start_active_span('abc') as scope:
+                    assert tracer.active_span is scope.span
+                """ % [os.path.abspath(path) for path in sys.path])
+        finally:
+            interpreters.destroy(interpreter)
+        tracer, traces_path = make_mock_tracer()
+        tracer.start_span('abc').finish()
+        tracer.close()
+        self.assertEqual(len(read_spans(traces_path)), 1)
+
+    def test_concurrent_span_updates(self):
+        # Exercises the per-span locking of the free-threaded build; with the
+        # GIL it checks that nothing is lost when threads interleave.
+        import sysconfig
+        import threading
+        if sysconfig.get_config_var('Py_GIL_DISABLED'):
+            # Importing the module mustn't have re-enabled the GIL.
+            self.assertFalse(sys._is_gil_enabled())
+        tracer, traces_path = make_mock_tracer()
+        span = tracer.start_span('abc')
+        num_threads = 8
+        num_iterations = 500
+        start = threading.Event()
+        errors = []
+        def update(thread_index):
+            start.wait()
+            try:
+                for i in range(num_iterations):
+                    span.set_tag('tag%d' % thread_index, i)
+                    span.log_kv({'thread': thread_index, 'i': i})
+                    carrier = {}
+                    tracer.inject(span.context, opentracing.Format.TEXT_MAP,
+                                  carrier)
+                    tracer.extract(opentracing.Format.TEXT_MAP, carrier)
+                    if i % 100 == 0:
+                        span.set_baggage_item('thread%d' % thread_index, str(i))
+            except Exception as e:
+                errors.append(e)
+        threads = [threading.Thread(target=update, args=(thread_index,))
+                   for thread_index in range(num_threads)]
+        for thread in threads:
+            thread.start()
+        start.set()
+        for thread in threads:
+            thread.join()
+        self.assertEqual(errors, [])
+        span.finish()
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 1)
+        self.assertEqual(len(spans[0]['logs']), num_threads * num_iterations)
+        for thread_index in range(num_threads):
+            self.assertEqual(spans[0]['tags']['tag%d' % thread_index],
+                             num_iterations - 1)
+
+    def test_static_tracer_module(self):
+        try:
+            import static_mocktracer
+        except ImportError:
+            self.skipTest('static_mocktracer is only built for Python 3')
+        traces_path = os.path.join(tempfile.mkdtemp(prefix='python-bridge-test.'), 'traces.json')
+        tracer = static_mocktracer.load_tracer(
+                '{ "output_file" : "%s" }' % traces_path, sample_rate=1.0)
+        with tracer.start_active_span('abc') as scope:
+            scope.span.set_tag('a', 1)
+            tracer.start_span('xyz').finish()
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 2)
+        self.assertEqual(spans[1]['operation_name'], 'abc')
+        self.assertEqual(spans[1]['tags']['a'], 1)
+        with self.assertRaises(RuntimeError):
+            static_mocktracer.load_tracer('not json')
+
+    def test_max_logs_per_span(self):
+        tracer, traces_path = make_mock_tracer(max_logs_per_span=2,
+                                               max_log_bytes_per_span=16)
+        span1 = tracer.start_span('abc')
+        for i in range(5):
+            span1.log_kv({'i': i})
+        span1.log_kv({'big': 'x' * 100})
+        span1.finish()
+        span2 = tracer.start_span('xyz')
+        span2.log_kv({'i': 0})
+        span2.finish()
+        stats = tracer.stats()
+        self.assertEqual(stats['logs_set'], 7)
+        self.assertEqual(stats['logs_dropped'], 4)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 2)
+        self.assertEqual([log['fields'] for log in spans[0]['logs']],
+                         [[{'key': 'i', 'value': '3'}],
+                          [{'key': 'i', 'value': '4'}]])
+        self.assertEqual(spans[0]['tags']['dropped_logs'], 4)
+        self.assertEqual(len(spans[1]['logs']), 1)
+        self.assertNotIn('dropped_logs', spans[1]['tags'])
+        tracer, traces_path = make_mock_tracer(max_log_bytes_per_span=3)
+        try:
+            with tracer.start_span('abc') as span:
+                for _ in range(5):
+                    span.log_kv({})
+                raise RuntimeError('failed')
+        except RuntimeError:
+            pass
+        self.assertEqual(tracer.stats()['logs_dropped'], 3)
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans[0]['logs']), 3)
+        self.assertEqual(spans[0]['tags']['dropped_logs'], 3)
+        self.assertTrue(spans[0]['tags']['error'])
+
+    def test_max_value_length(self):
+        tracer, traces_path = make_mock_tracer(max_value_length=4,
+                                               value_truncation_marker='<cut>')
+        span = tracer.start_span('abc', tags={'sql': 'SELECT * FROM t'})
+        span.set_tag('short', 'abcd')
+        span.log_kv({'body': b'0123456789', 'obj': 1234567})
+        span.log(event='0123456789')
+        span.finish()
+        try:
+            with tracer.start_span('xyz'):
+                raise RuntimeError('0123456789')
+        except RuntimeError:
+            pass
+        tracer.close()
+        spans = read_spans(traces_path)
+        self.assertEqual(len(spans), 2)
+        self.assertEqual(spans[0]['tags']['sql'], 'SELE<cut>')
+        self.assertEqual(spans[0]['tags']['short'], 'abcd')
+        logs = [dict((field['key'], field['value']) for field in log['fields'])
+                for log in spans[0]['logs']]
+        self.assertEqual(logs, [{'body': '0123<cut>', 'obj': '1234<cut>'},
+                                {'event': '0123<cut>'}])
+        error_fields = dict((field['key'], field['value'])
+                            for field in spans[1]['logs'][0]['fields'])
+        self.assertEqual(error_fields['message'], '0123<cut>')
+        self.assertEqual(error_fields['error.object'], '0123<cut>')
+        tracer, traces_path = make_mock_tracer(max_value_length=4)
+        tracer.start_span('abc', tags={'sql': 'SELECT * FROM t'}).finish()
+        tracer.close()
+        self.assertEqual(read_spans(traces_path)[0]['tags']['sql'], 'SELE...')
+
+    def test_live_spans(self):
+        tracer, traces_path = make_mock_tracer(track_live_spans=True)
+        span1 = tracer.start_span('abc', start_time=time.time() - 60)
+        span2 = tracer.start_span('xyz')
+        span2.set_operation_name('qrs')
+        span3 = tracer.start_span('def')
+        span3.finish()
+        live_spans = tracer.live_spans()
+        self.assertEqual([span['operation_name'] for span in live_spans],
+                         ['abc', 'qrs'])
+        self.assertGreaterEqual(live_spans[0]['age'], 60)
+        self.assertLess(live_spans[0]['age'], 90)
+        self.assertGreaterEqual(live_spans[1]['age'], 0)
+        self.assertLess(live_spans[1]['age'], 30)
+        time.sleep(0.1)
+        self.assertGreaterEqual(tracer.live_spans()[1]['age'],
+                                live_spans[1]['age'] + 0.09)
+        older_spans = tracer.live_spans(older_than=30)
+        self.assertEqual([span['operation_name'] for span in older_spans], ['abc'])
+        self.assertGreaterEqual(older_spans[0]['age'], 60)
+        self.assertEqual(tracer.live_spans(older_than=1e300), [])
+        for older_than in [-1.0, float('inf'), float('-inf'), float('nan')]:
+            with self.assertRaises(ValueError):
+                tracer.live_spans(older_than=older_than)
+        del span1
+        span2.finish()
+        self.assertEqual(tracer.live_spans(), [])
+        self.assertEqual(tracer.stats()['unfinished_spans_deallocated'], 1)
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,133 @@
+// Prints the spans recorded into a shared memory ring buffer as JSON lines.
+//
+// Usage: shm_ring_dump <path> [--follow]
+//
+// Without --follow the records currently in the ring are printed and the
+// program exits; with --follow it keeps polling for new records.
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <thread>
+
+#include "shm_ring/shm_ring_reader.h"
+
+using python_bridge_tracer::shm_ring::ShmRingReader;
+using python_bridge_tracer::shm_ring::SpanRecord;
+
+//--------------------------------------------------------------------------------------------------
+// appendJsonString
+//--------------------------------------------------------------------------------------------------
+static void appendJsonString(const char* data, size_t size, std::string& s) {
+  s.push_back('"');
+  for (size_t i = 0; i < size; ++i) {
+    auto c = static_cast<unsigned char>(data[i]);
+    if (c == '"' || c == '\\') {
+      s.push_back('\\');
+      s.push_back(static_cast<char>(c));
+    } else if (c < 0x20) {
+      char buffer[8];
+      std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      s.append(buffer);
+    } else {
+      s.push_back(static_cast<char>(c));
+    }
+  }
+  s.push_back('"');
+}
+
+//--------------------------------------------------------------------------------------------------
+// appendId
+//--------------------------------------------------------------------------------------------------
+static void appendId(uint64_t id, std::string& s) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "\"%016" PRIx64 "\"", id);
+  s.append(buffer);
+}
+
+//--------------------------------------------------------------------------------------------------
+// toJson
+//--------------------------------------------------------------------------------------------------
+static std::string toJson(const SpanRecord& record) {
+  using namespace python_bridge_tracer::shm_ring;
+  std::string result = "{\"trace_id\":";
+  appendId(record.trace_id, result);
+  result.append(",\"span_id\":");
+  appendId(record.span_id, result);
+  result.append(",\"parent_span_id\":");
+  if (record.parent_span_id == 0) {
+    result.append("null");
+  } else {
+    appendId(record.parent_span_id, result);
+  }
+  result.append(",\"operation_name\":");
+  appendJsonString(record.operation_name,
+                   std::min<size_t>(record.operation_name_length,
+                                    MaxOperationNameLength),
+                   result);
+  char buffer[128];
+  std::snprintf(buffer, sizeof(buffer),
+                ",\"start_timestamp\":%" PRId64 ",\"duration\":%" PRId64
+                ",\"error\":%s,\"truncated\":%s",
+                record.start_timestamp, record.duration,
+                (record.flags & ErrorFlag) != 0 ? "true" : "false",
+                (record.flags & (TruncatedOperationNameFlag | TruncatedTagsFlag)) != 0
+                    ? "true"
+                    : "false");
+  result.append(buffer);
+  result.append(",\"tags\":{");
+  size_t tags_length = std::min<size_t>(record.tags_length, MaxTagsLength);
+  size_t position = 0;
+  while (position + 2 <= tags_length) {
+    size_t key_length = static_cast<unsigned char>(record.tags[position]);
+    size_t value_length = static_cast<unsigned char>(record.tags[position + 1]);
+    auto key = record.tags + position + 2;
+    auto value = key + key_length;
+    position += 2 + key_length + value_length;
+    if (position > tags_length) {
+      break;
+    }
+    if (result.back() != '{') {
+      result.push_back(',');
+    }
+    appendJsonString(key, key_length, result);
+    result.push_back(':');
+    appendJsonString(value, value_length, result);
+  }
+  result.append("}}");
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[]) try {
+  if (argc < 2 || argc > 3 ||
+      (argc == 3 && std::strcmp(argv[2], "--follow") != 0)) {
+    std::fprintf(stderr, "Usage: %s <path> [--follow]\n", argv[0]);
+    return 1;
+  }
+  auto follow = argc == 3;
+  ShmRingReader reader{argv[1]};
+  SpanRecord record;
+  while (true) {
+    while (reader.read(record)) {
+      std::printf("%s\n", toJson(record).c_str());
+    }
+    if (!follow) {
+      break;
+    }
+    std::fflush(stdout);
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  }
+  if (reader.num_lost() > 0) {
+    std::fprintf(stderr, "lost %" PRIu64 " records\n", reader.num_lost());
+  }
+  return 0;
+} catch (const std::exception& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return 1;
+}